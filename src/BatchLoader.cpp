@@ -0,0 +1,143 @@
+#include "BatchLoader.h"
+#include "DecompressingDevice.h"
+#include "NativeMeshFormat.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+namespace
+{
+constexpr qint64 kParsedBytesPerFileByte = 2;
+// STL archives typically shrink 3-5x; assume the worst.
+constexpr qint64 kArchiveInflateRatio = 5;
+// A parsed vertex holds a position and a normal.
+constexpr qint64 kParsedBytesPerVertex = 2 * sizeof(QVector3D);
+
+// Peak memory a parse of `path` is likely to need, judged from its header
+// where the file size says little about it.
+qint64 estimateParsedBytes(const QString &path)
+{
+    QFile file(path);
+    const qint64 size = file.size();
+    if (!file.open(QIODevice::ReadOnly))
+        return size * kParsedBytesPerFileByte;
+
+    const QByteArray header = file.peek(NativeMeshFormat::kCountsHeaderSize);
+    quint32 vertexCount = 0;
+    quint32 indexCount = 0;
+    if (NativeMeshFormat::readCounts(header, &vertexCount, &indexCount))
+        return vertexCount * kParsedBytesPerVertex + indexCount * static_cast<qint64>(sizeof(unsigned int));
+    if (DecompressingDevice::detect(header) != DecompressingDevice::Codec::None)
+        return size * kArchiveInflateRatio * kParsedBytesPerFileByte;
+    return size * kParsedBytesPerFileByte;
+}
+}
+
+BatchLoader::BatchLoader(QObject *parent)
+    : QObject(parent)
+{
+    m_loader.setExtractFeatureEdges(true);
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+BatchLoader::~BatchLoader()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+QStringList BatchLoader::expandPaths(const QStringList &paths)
+{
+    const QStringList filters = MeshLoader::nameFilters();
+    QStringList files;
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        if (info.isDir()) {
+            QDirIterator it(path, filters, QDir::Files, QDirIterator::Subdirectories);
+            QStringList found;
+            while (it.hasNext())
+                found.append(it.next());
+            found.sort();
+            files.append(found);
+        } else if (info.isFile()) {
+            files.append(info.absoluteFilePath());
+        }
+    }
+    files.removeDuplicates();
+    return files;
+}
+
+void BatchLoader::start(const QStringList &paths)
+{
+    cancel();
+    ++m_generation;
+    m_total = paths.size();
+    m_finished = 0;
+    m_triangles = 0;
+
+    for (const QString &path : paths) {
+        Job job;
+        job.path = path;
+        job.estimatedBytes = estimateParsedBytes(path);
+        m_queue.append(job);
+    }
+
+    emit progressChanged(0, m_total, 0);
+    if (m_total == 0) {
+        emit finished();
+        return;
+    }
+    scheduleMore();
+}
+
+void BatchLoader::cancel()
+{
+    m_queue.clear();
+    m_pool.clear();
+    m_total = m_finished;
+    m_running = 0;
+    m_inFlightBytes = 0;
+    ++m_generation;
+}
+
+void BatchLoader::scheduleMore()
+{
+    while (!m_queue.isEmpty() && m_running < m_pool.maxThreadCount()) {
+        const Job &next = m_queue.first();
+        if (m_running > 0 && m_inFlightBytes + next.estimatedBytes > m_memoryBudget)
+            break;
+
+        const Job job = m_queue.takeFirst();
+        ++m_running;
+        m_inFlightBytes += job.estimatedBytes;
+
+        const int generation = m_generation;
+        m_pool.start([this, job, generation]() {
+            QString errorMessage;
+            MeshBuffer buffer = m_loader.load(job.path, &errorMessage);
+            QMetaObject::invokeMethod(this, [this, job, generation, buffer, errorMessage]() {
+                if (generation != m_generation)
+                    return;
+
+                --m_running;
+                m_inFlightBytes -= job.estimatedBytes;
+                ++m_finished;
+
+                if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
+                    emit loadFailed(job.path, errorMessage.isEmpty() ? tr("No geometry found in %1").arg(job.path) : errorMessage);
+                } else {
+                    m_triangles += static_cast<quint64>(buffer.indices.size()) / 3;
+                    emit meshLoaded(job.path, buffer);
+                }
+
+                emit progressChanged(m_finished, m_total, m_triangles);
+                scheduleMore();
+                if (m_finished == m_total)
+                    emit finished();
+            }, Qt::QueuedConnection);
+        });
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+class BatchLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchLoader(QObject *parent = nullptr);
+    ~BatchLoader() override;
+
+    void setMemoryBudget(qint64 bytes) { m_memoryBudget = qMax<qint64>(1, bytes); }
+    void start(const QStringList &paths);
+    void cancel();
+    bool isRunning() const { return m_finished < m_total; }
+
+    static QStringList expandPaths(const QStringList &paths);
+
+signals:
+    void meshLoaded(const QString &path, const MeshBuffer &buffer);
+    void loadFailed(const QString &path, const QString &message);
+    void progressChanged(int finished, int total, quint64 triangles);
+    void finished();
+
+private:
+    struct Job
+    {
+        QString path;
+        qint64 estimatedBytes = 0;
+    };
+
+    void scheduleMore();
+
+    MeshLoader m_loader;
+    QThreadPool m_pool;
+    QList<Job> m_queue;
+    int m_running = 0;
+    int m_total = 0;
+    int m_finished = 0;
+    int m_generation = 0;
+    qint64 m_inFlightBytes = 0;
+    qint64 m_memoryBudget = 2048ll * 1024 * 1024;
+    quint64 m_triangles = 0;
+};
@@ -0,0 +1,269 @@
+#include "BatchProcessor.h"
+#include "BatchLoader.h"
+#include "MeshLoader.h"
+#include "NormalHistogram.h"
+#include "ThumbnailRenderer.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+
+#include <cstdio>
+
+namespace
+{
+QJsonArray toJson(const QVector3D &v)
+{
+    return QJsonArray{v.x(), v.y(), v.z()};
+}
+
+QString csvField(const QString &value)
+{
+    if (!value.contains(QLatin1Char(',')) && !value.contains(QLatin1Char('"')) && !value.contains(QLatin1Char('\n')))
+        return value;
+    QString escaped = value;
+    escaped.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + escaped + QLatin1Char('"');
+}
+
+QStringList readListFile(const QString &path)
+{
+    QStringList paths;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return paths;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith(QLatin1Char('#')))
+            paths.append(line);
+    }
+    return paths;
+}
+} // namespace
+
+int BatchProcessor::exec(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Headless batch processing of mesh files."));
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("batch"), QStringLiteral("Run in headless batch mode.")});
+    parser.addOption({{QStringLiteral("o"), QStringLiteral("output")}, QStringLiteral("Write results to <file> instead of stdout."), QStringLiteral("file")});
+    parser.addOption({{QStringLiteral("f"), QStringLiteral("format")}, QStringLiteral("Output format: json or csv."), QStringLiteral("format"), QStringLiteral("json")});
+    parser.addOption({{QStringLiteral("j"), QStringLiteral("threads")}, QStringLiteral("Worker threads (default: all cores)."), QStringLiteral("count"), QStringLiteral("0")});
+    parser.addOption({QStringLiteral("thumbnails"), QStringLiteral("Render a PNG preview of every file into <dir>."), QStringLiteral("dir")});
+    parser.addOption({QStringLiteral("thumbnail-size"), QStringLiteral("Thumbnail edge length in pixels."), QStringLiteral("px"), QStringLiteral("256")});
+    parser.addOption({QStringLiteral("list"), QStringLiteral("Read input paths from <file>, one per line."), QStringLiteral("file")});
+    parser.addPositionalArgument(QStringLiteral("inputs"), QStringLiteral("Files or folders to process."), QStringLiteral("[inputs...]"));
+    parser.process(arguments);
+
+    Options options;
+    options.inputs = parser.positionalArguments();
+    if (parser.isSet(QStringLiteral("list")))
+        options.inputs.append(readListFile(parser.value(QStringLiteral("list"))));
+    options.outputPath = parser.value(QStringLiteral("output"));
+    options.threads = parser.value(QStringLiteral("threads")).toInt();
+    options.thumbnailDirectory = parser.value(QStringLiteral("thumbnails"));
+    options.thumbnailSize = qBound(16, parser.value(QStringLiteral("thumbnail-size")).toInt(), 4096);
+
+    const QString format = parser.value(QStringLiteral("format")).toLower();
+    if (format == QLatin1String("csv")) {
+        options.format = OutputFormat::Csv;
+    } else if (format != QLatin1String("json")) {
+        std::fprintf(stderr, "Unknown output format: %s\n", qPrintable(format));
+        return 2;
+    }
+
+    return run(options);
+}
+
+int BatchProcessor::run(const Options &options)
+{
+    const QStringList files = BatchLoader::expandPaths(options.inputs);
+    if (files.isEmpty()) {
+        std::fprintf(stderr, "No input files.\n");
+        return 2;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.threads > 0 ? options.threads : qMax(1, QThread::idealThreadCount()));
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    QVector<Result> results;
+    if (options.thumbnailDirectory.isEmpty()) {
+        results = QtConcurrent::blockingMapped<QVector<Result>>(&pool, files, &BatchProcessor::process);
+    } else {
+        QHash<QString, int> indexByPath;
+        for (int i = 0; i < files.size(); ++i)
+            indexByPath.insert(files.at(i), i);
+        results.resize(files.size());
+        Result *resultData = results.data();
+
+        ThumbnailRenderer::Options thumbnailOptions;
+        thumbnailOptions.size = QSize(options.thumbnailSize, options.thumbnailSize);
+        thumbnailOptions.outputDirectory = options.thumbnailDirectory;
+        thumbnailOptions.workerThreads = pool.maxThreadCount();
+
+        ThumbnailRenderer renderer;
+        QStringList errors;
+        renderer.renderFiles(files, thumbnailOptions, &errors, ThumbnailRenderer::ProgressFunction(),
+                             [&indexByPath, resultData](const QString &path, const MeshBuffer &buffer, double loadMs, const QString &error) {
+                                 resultData[indexByPath.value(path)] = analyze(path, buffer, loadMs, error);
+                             });
+        for (const QString &error : errors)
+            std::fprintf(stderr, "%s\n", qPrintable(error));
+    }
+    const double wallMs = wallTimer.nsecsElapsed() / 1.0e6;
+
+    QFile outputFile;
+    if (options.outputPath.isEmpty()) {
+        if (!outputFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text))
+            return 2;
+    } else {
+        outputFile.setFileName(options.outputPath);
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            std::fprintf(stderr, "Unable to write %s\n", qPrintable(options.outputPath));
+            return 2;
+        }
+    }
+
+    QTextStream out(&outputFile);
+    if (options.format == OutputFormat::Csv)
+        writeCsv(out, results);
+    else
+        writeJson(out, results, wallMs);
+    out.flush();
+
+    int failures = 0;
+    for (const Result &result : results) {
+        if (!result.ok)
+            ++failures;
+    }
+    std::fprintf(stderr, "Processed %lld files in %.1f ms (%d failed)\n", static_cast<long long>(results.size()), wallMs, failures);
+    return failures > 0 ? 1 : 0;
+}
+
+BatchProcessor::Result BatchProcessor::process(const QString &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QString error;
+    MeshLoader loader;
+    const MeshBuffer buffer = loader.load(path, &error);
+    return analyze(path, buffer, timer.nsecsElapsed() / 1.0e6, error);
+}
+
+BatchProcessor::Result BatchProcessor::analyze(const QString &path, const MeshBuffer &buffer, double loadMs, const QString &error)
+{
+    Result result;
+    result.path = path;
+    result.stats.fileName = QFileInfo(path).fileName();
+    result.error = error;
+    result.loadMs = loadMs;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
+        if (result.error.isEmpty())
+            result.error = QStringLiteral("No geometry found");
+        result.totalMs = loadMs;
+        return result;
+    }
+
+    QVector3D minBounds = buffer.positions.first();
+    QVector3D maxBounds = buffer.positions.first();
+    for (const QVector3D &p : buffer.positions) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minBounds[axis] = qMin(minBounds[axis], p[axis]);
+            maxBounds[axis] = qMax(maxBounds[axis], p[axis]);
+        }
+    }
+
+    result.ok = true;
+    result.error.clear();
+    result.vertexCount = static_cast<quint64>(buffer.positions.size());
+    result.stats.triangleCount = static_cast<quint64>(buffer.indices.size()) / 3;
+    result.stats.instanceCount = 1;
+    result.stats.sceneTriangleCount = result.stats.triangleCount;
+    result.stats.minBounds = minBounds;
+    result.stats.maxBounds = maxBounds;
+    result.stats.size = maxBounds - minBounds;
+    result.stats.hasNormals = buffer.hasNormals;
+    result.stats.mass = MassProperties::compute(buffer.positions, buffer.indices, (minBounds + maxBounds) * 0.5f);
+    NormalHistogram normals;
+    normals.build(buffer.positions, buffer.indices);
+    result.stats.overhangArea = normals.area(QMatrix3x3(), QVector3D(0.0f, -1.0f, 0.0f),
+                                             qSin(qDegreesToRadians(result.stats.overhangThreshold)));
+    result.totalMs = loadMs + timer.nsecsElapsed() / 1.0e6;
+    return result;
+}
+
+void BatchProcessor::writeJson(QTextStream &out, const QVector<Result> &results, double wallMs) const
+{
+    QJsonArray files;
+    for (const Result &result : results) {
+        QJsonObject entry;
+        entry.insert(QStringLiteral("path"), result.path);
+        entry.insert(QStringLiteral("ok"), result.ok);
+        if (!result.ok) {
+            entry.insert(QStringLiteral("error"), result.error);
+        } else {
+            entry.insert(QStringLiteral("triangles"), static_cast<qint64>(result.stats.triangleCount));
+            entry.insert(QStringLiteral("vertices"), static_cast<qint64>(result.vertexCount));
+            entry.insert(QStringLiteral("minBounds"), toJson(result.stats.minBounds));
+            entry.insert(QStringLiteral("maxBounds"), toJson(result.stats.maxBounds));
+            entry.insert(QStringLiteral("size"), toJson(result.stats.size));
+            entry.insert(QStringLiteral("hasNormals"), result.stats.hasNormals);
+            entry.insert(QStringLiteral("overhangArea"), result.stats.overhangArea);
+            const MassProperties &mass = result.stats.mass;
+            entry.insert(QStringLiteral("volume"), mass.volume);
+            entry.insert(QStringLiteral("surfaceArea"), mass.surfaceArea);
+            if (mass.valid) {
+                entry.insert(QStringLiteral("centroid"), toJson(mass.centroid));
+                entry.insert(QStringLiteral("inertia"), QJsonArray{QJsonArray{mass.ixx, mass.ixy, mass.ixz},
+                                                                   QJsonArray{mass.ixy, mass.iyy, mass.iyz},
+                                                                   QJsonArray{mass.ixz, mass.iyz, mass.izz}});
+            }
+        }
+        entry.insert(QStringLiteral("loadMs"), result.loadMs);
+        entry.insert(QStringLiteral("totalMs"), result.totalMs);
+        files.append(entry);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("files"), files);
+    root.insert(QStringLiteral("wallMs"), wallMs);
+    out << QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+void BatchProcessor::writeCsv(QTextStream &out, const QVector<Result> &results) const
+{
+    out << "path,ok,error,triangles,vertices,min_x,min_y,min_z,max_x,max_y,max_z,size_x,size_y,size_z,has_normals,"
+           "volume,surface_area,centroid_x,centroid_y,centroid_z,ixx,iyy,izz,ixy,iyz,ixz,overhang_area,load_ms,total_ms\n";
+    for (const Result &result : results) {
+        const MeshStatistics &s = result.stats;
+        out << csvField(result.path) << ',' << (result.ok ? 1 : 0) << ',' << csvField(result.error) << ','
+            << s.triangleCount << ',' << result.vertexCount << ','
+            << s.minBounds.x() << ',' << s.minBounds.y() << ',' << s.minBounds.z() << ','
+            << s.maxBounds.x() << ',' << s.maxBounds.y() << ',' << s.maxBounds.z() << ','
+            << s.size.x() << ',' << s.size.y() << ',' << s.size.z() << ','
+            << (s.hasNormals ? 1 : 0) << ','
+            << s.mass.volume << ',' << s.mass.surfaceArea << ','
+            << s.mass.centroid.x() << ',' << s.mass.centroid.y() << ',' << s.mass.centroid.z() << ','
+            << s.mass.ixx << ',' << s.mass.iyy << ',' << s.mass.izz << ','
+            << s.mass.ixy << ',' << s.mass.iyz << ',' << s.mass.ixz << ',' << s.overhangArea << ',' << result.loadMs << ',' << result.totalMs << '\n';
+    }
+}
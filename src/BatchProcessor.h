@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MeshLoader.h"
+#include "MeshStatistics.h"
+
+#include <QString>
+#include <QStringList>
+
+class QTextStream;
+
+class BatchProcessor
+{
+public:
+    enum class OutputFormat
+    {
+        Json = 0,
+        Csv
+    };
+
+    struct Options
+    {
+        QStringList inputs;
+        QString outputPath;
+        OutputFormat format = OutputFormat::Json;
+        int threads = 0;
+        QString thumbnailDirectory;
+        int thumbnailSize = 256;
+    };
+
+    struct Result
+    {
+        QString path;
+        bool ok = false;
+        QString error;
+        quint64 vertexCount = 0;
+        MeshStatistics stats;
+        double loadMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    BatchProcessor() = default;
+
+    int exec(const QStringList &arguments);
+    int run(const Options &options);
+
+private:
+    static Result process(const QString &path);
+    static Result analyze(const QString &path, const MeshBuffer &buffer, double loadMs, const QString &error);
+    void writeJson(QTextStream &out, const QVector<Result> &results, double wallMs) const;
+    void writeCsv(QTextStream &out, const QVector<Result> &results) const;
+};
@@ -0,0 +1,462 @@
+#include "Bvh.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kLeafSize = 4;
+constexpr qsizetype kMinParallelTriangles = 4096;
+constexpr int kMaxStackDepth = 64;
+
+int parallelDepth()
+{
+    int depth = 0;
+    for (int subtrees = 1; subtrees < qMax(1, QThread::idealThreadCount()) * 4; subtrees *= 2)
+        ++depth;
+    return depth;
+}
+
+// Ray in the sheared frame of the watertight test (Woop, Benthin and Wald):
+// the dominant direction axis becomes z and the ray becomes the z axis, so
+// neighbouring triangles evaluate their shared edge identically and a ray
+// through an edge or vertex cannot slip between them.
+struct RayFrame
+{
+    int kx = 0;
+    int ky = 1;
+    int kz = 2;
+    float sx = 0.0f;
+    float sy = 0.0f;
+    float sz = 1.0f;
+
+    explicit RayFrame(const QVector3D &direction)
+    {
+        if (std::abs(direction.x()) > std::abs(direction[kz]))
+            kz = 0;
+        if (std::abs(direction.y()) > std::abs(direction[kz]))
+            kz = 1;
+        kx = (kz + 1) % 3;
+        ky = (kx + 1) % 3;
+        if (direction[kz] < 0.0f)
+            std::swap(kx, ky);
+        sx = direction[kx] / direction[kz];
+        sy = direction[ky] / direction[kz];
+        sz = 1.0f / direction[kz];
+    }
+};
+
+// Returns the distance along the ray, or a negative value on a miss.
+float intersectTriangle(const RayFrame &frame, const QVector3D &origin, const QVector3D &a, const QVector3D &b, const QVector3D &c)
+{
+    const QVector3D pa = a - origin;
+    const QVector3D pb = b - origin;
+    const QVector3D pc = c - origin;
+    const float ax = pa[frame.kx] - frame.sx * pa[frame.kz];
+    const float ay = pa[frame.ky] - frame.sy * pa[frame.kz];
+    const float bx = pb[frame.kx] - frame.sx * pb[frame.kz];
+    const float by = pb[frame.ky] - frame.sy * pb[frame.kz];
+    const float cx = pc[frame.kx] - frame.sx * pc[frame.kz];
+    const float cy = pc[frame.ky] - frame.sy * pc[frame.kz];
+
+    float u = cx * by - cy * bx;
+    float v = ax * cy - ay * cx;
+    float w = bx * ay - by * ax;
+    if (u == 0.0f || v == 0.0f || w == 0.0f) {
+        u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+        v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+        w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+    }
+    if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+        return -1.0f;
+    const float det = u + v + w;
+    if (det == 0.0f)
+        return -1.0f;
+
+    const float t = u * frame.sz * pa[frame.kz] + v * frame.sz * pb[frame.kz] + w * frame.sz * pc[frame.kz];
+    return t / det;
+}
+
+// Closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5).
+// Also reports which feature of the triangle it lies on.
+QVector3D closestOnTriangle(const QVector3D &p, const QVector3D &a, const QVector3D &b, const QVector3D &c, Bvh::Feature *feature, int *corner)
+{
+    const QVector3D ab = b - a;
+    const QVector3D ac = c - a;
+    const QVector3D ap = p - a;
+    const float d1 = QVector3D::dotProduct(ab, ap);
+    const float d2 = QVector3D::dotProduct(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        *feature = Bvh::Feature::Vertex;
+        *corner = 0;
+        return a;
+    }
+
+    const QVector3D bp = p - b;
+    const float d3 = QVector3D::dotProduct(ab, bp);
+    const float d4 = QVector3D::dotProduct(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        *feature = Bvh::Feature::Vertex;
+        *corner = 1;
+        return b;
+    }
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        *feature = Bvh::Feature::Edge;
+        *corner = 0;
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    const QVector3D cp = p - c;
+    const float d5 = QVector3D::dotProduct(ab, cp);
+    const float d6 = QVector3D::dotProduct(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        *feature = Bvh::Feature::Vertex;
+        *corner = 2;
+        return c;
+    }
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        *feature = Bvh::Feature::Edge;
+        *corner = 2;
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        *feature = Bvh::Feature::Edge;
+        *corner = 1;
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    const float denominator = va + vb + vc;
+    if (denominator == 0.0f) {
+        *feature = Bvh::Feature::Vertex;
+        *corner = 0;
+        return a;
+    }
+    *feature = Bvh::Feature::Face;
+    *corner = 0;
+    return a + ab * (vb / denominator) + ac * (vc / denominator);
+}
+
+float boxDistanceSquared(const float min[3], const float max[3], const QVector3D &p)
+{
+    float distance = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = qMax(qMax(min[axis] - p[axis], p[axis] - max[axis]), 0.0f);
+        distance += d * d;
+    }
+    return distance;
+}
+
+bool rayHitsBox(const float min[3], const float max[3], const QVector3D &origin, const QVector3D &inverse, float tMin, float tMax)
+{
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (min[axis] - origin[axis]) * inverse[axis];
+        float t1 = (max[axis] - origin[axis]) * inverse[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        // Conservative far bound (Ize), so rounding cannot cull a box the
+        // ray only grazes.
+        t1 *= 1.0f + 2.0f * 3.0f * std::numeric_limits<float>::epsilon();
+        tMin = qMax(tMin, t0);
+        tMax = qMin(tMax, t1);
+        if (tMax < tMin)
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+struct Bvh::Builder
+{
+    struct Task
+    {
+        qsizetype node = 0;
+        qsizetype begin = 0;
+        qsizetype end = 0;
+    };
+
+    const QVector<QVector3D> &corners;
+    const QVector<QVector3D> &centroids;
+    quint32 *order = nullptr;
+    int splitDepth = 0;
+    QVector<Task> deferred;
+
+    void buildNode(QVector<Node> &nodes, qsizetype nodeIndex, qsizetype begin, qsizetype end, int depth, bool defer)
+    {
+        Node node;
+        QVector3D centroidMin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+        QVector3D centroidMax = -centroidMin;
+        for (int axis = 0; axis < 3; ++axis) {
+            node.min[axis] = std::numeric_limits<float>::max();
+            node.max[axis] = -std::numeric_limits<float>::max();
+        }
+        for (qsizetype i = begin; i < end; ++i) {
+            const quint32 triangle = order[i];
+            for (int corner = 0; corner < 3; ++corner) {
+                const QVector3D &p = corners.at(triangle * 3 + corner);
+                for (int axis = 0; axis < 3; ++axis) {
+                    node.min[axis] = qMin(node.min[axis], p[axis]);
+                    node.max[axis] = qMax(node.max[axis], p[axis]);
+                }
+            }
+            const QVector3D &c = centroids.at(triangle);
+            for (int axis = 0; axis < 3; ++axis) {
+                centroidMin[axis] = qMin(centroidMin[axis], c[axis]);
+                centroidMax[axis] = qMax(centroidMax[axis], c[axis]);
+            }
+        }
+
+        const QVector3D extent = centroidMax - centroidMin;
+        int axis = 0;
+        if (extent.y() > extent[axis])
+            axis = 1;
+        if (extent.z() > extent[axis])
+            axis = 2;
+
+        const qsizetype count = end - begin;
+        if (count <= kLeafSize || extent[axis] <= 0.0f) {
+            node.index = static_cast<quint32>(begin);
+            node.count = static_cast<quint32>(count);
+            nodes[nodeIndex] = node;
+            return;
+        }
+
+        if (defer && depth >= splitDepth && count >= kMinParallelTriangles) {
+            nodes[nodeIndex] = node;
+            deferred.append({nodeIndex, begin, end});
+            return;
+        }
+
+        const qsizetype mid = begin + count / 2;
+        const QVector<QVector3D> &points = centroids;
+        std::nth_element(order + begin, order + mid, order + end,
+                         [&points, axis](quint32 a, quint32 b) { return points.at(a)[axis] < points.at(b)[axis]; });
+
+        const qsizetype left = nodes.size();
+        nodes.append(Node());
+        nodes.append(Node());
+        node.index = static_cast<quint32>(left);
+        node.count = 0;
+        nodes[nodeIndex] = node;
+        buildNode(nodes, left, begin, mid, depth + 1, defer);
+        buildNode(nodes, left + 1, mid, end, depth + 1, defer);
+    }
+};
+
+void Bvh::build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices)
+{
+    clear();
+    const qsizetype triangleCount = indices.size() / 3;
+    if (positions.isEmpty() || triangleCount == 0)
+        return;
+
+    const auto vertexCount = static_cast<unsigned int>(positions.size());
+    QVector<QVector3D> corners(triangleCount * 3);
+    QVector<QVector3D> centroids(triangleCount);
+    QVector<char> valid(triangleCount, 0);
+    Parallel::forEach(triangleCount, [&](qsizetype t) {
+        const unsigned int i0 = indices.at(t * 3);
+        const unsigned int i1 = indices.at(t * 3 + 1);
+        const unsigned int i2 = indices.at(t * 3 + 2);
+        if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+            return;
+        corners[t * 3] = positions.at(i0);
+        corners[t * 3 + 1] = positions.at(i1);
+        corners[t * 3 + 2] = positions.at(i2);
+        centroids[t] = (positions.at(i0) + positions.at(i1) + positions.at(i2)) / 3.0f;
+        valid[t] = 1;
+    });
+
+    QVector<quint32> order;
+    order.reserve(triangleCount);
+    for (qsizetype t = 0; t < triangleCount; ++t) {
+        if (valid.at(t))
+            order.append(static_cast<quint32>(t));
+    }
+    if (order.isEmpty())
+        return;
+
+    Builder builder{corners, centroids, order.data(), parallelDepth(), {}};
+    m_nodes.reserve(order.size() / kLeafSize * 2 + 1);
+    m_nodes.append(Node());
+    builder.buildNode(m_nodes, 0, 0, order.size(), 0, true);
+
+    // Finish the deferred subtrees concurrently, each into its own array with
+    // the subtree root at index 0, then append them and rebase child links.
+    QVector<QVector<Node>> subtrees(builder.deferred.size());
+    Parallel::forEach(
+        builder.deferred.size(),
+        [&](qsizetype i) {
+            const Builder::Task &task = builder.deferred.at(i);
+            QVector<Node> &local = subtrees[i];
+            local.append(Node());
+            builder.buildNode(local, 0, task.begin, task.end, 0, false);
+        },
+        1);
+    for (qsizetype i = 0; i < subtrees.size(); ++i) {
+        const QVector<Node> &local = subtrees.at(i);
+        const auto base = static_cast<quint32>(m_nodes.size()) - 1;
+        for (qsizetype n = 0; n < local.size(); ++n) {
+            Node node = local.at(n);
+            if (node.count == 0)
+                node.index += base;
+            if (n == 0)
+                m_nodes[builder.deferred.at(i).node] = node;
+            else
+                m_nodes.append(node);
+        }
+    }
+
+    m_triangles = order;
+    m_vertices.resize(order.size() * 3);
+    Parallel::forEach(order.size(), [&](qsizetype i) {
+        for (int corner = 0; corner < 3; ++corner)
+            m_vertices[i * 3 + corner] = corners.at(order.at(i) * 3 + corner);
+    });
+
+    const Node &root = m_nodes.first();
+    m_minBounds = QVector3D(root.min[0], root.min[1], root.min[2]);
+    m_maxBounds = QVector3D(root.max[0], root.max[1], root.max[2]);
+}
+
+void Bvh::clear()
+{
+    m_nodes.clear();
+    m_vertices.clear();
+    m_triangles.clear();
+    m_minBounds = QVector3D();
+    m_maxBounds = QVector3D();
+}
+
+bool Bvh::intersect(const QVector3D &origin,
+                    const QVector3D &direction,
+                    float minDistance,
+                    float maxDistance,
+                    Hit *hit,
+                    bool backFacesOnly) const
+{
+    if (m_nodes.isEmpty())
+        return false;
+
+    QVector3D inverse;
+    for (int axis = 0; axis < 3; ++axis)
+        inverse[axis] = 1.0f / (direction[axis] != 0.0f ? direction[axis] : 1.0e-30f);
+
+    const RayFrame frame(direction);
+    float best = maxDistance;
+    qsizetype bestIndex = -1;
+    quint32 stack[kMaxStackDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node &node = m_nodes.at(stack[--stackSize]);
+        if (!rayHitsBox(node.min, node.max, origin, inverse, minDistance, best))
+            continue;
+
+        if (node.count == 0) {
+            // Visit the child nearer along the ray first so `best` shrinks early.
+            const Node &left = m_nodes.at(node.index);
+            const int axis = direction.x() * direction.x() > direction.y() * direction.y()
+                                 ? (direction.x() * direction.x() > direction.z() * direction.z() ? 0 : 2)
+                                 : (direction.y() * direction.y() > direction.z() * direction.z() ? 1 : 2);
+            const bool leftFirst = (left.min[axis] + left.max[axis] < m_nodes.at(node.index + 1).min[axis] + m_nodes.at(node.index + 1).max[axis]) ==
+                                   (direction[axis] >= 0.0f);
+            if (stackSize + 2 > kMaxStackDepth)
+                continue;
+            stack[stackSize++] = leftFirst ? node.index + 1 : node.index;
+            stack[stackSize++] = leftFirst ? node.index : node.index + 1;
+            continue;
+        }
+
+        for (quint32 i = node.index; i < node.index + node.count; ++i) {
+            const QVector3D &a = m_vertices.at(i * 3);
+            const QVector3D &b = m_vertices.at(i * 3 + 1);
+            const QVector3D &c = m_vertices.at(i * 3 + 2);
+            if (backFacesOnly && QVector3D::dotProduct(QVector3D::crossProduct(b - a, c - a), direction) <= 0.0f)
+                continue;
+            const float t = intersectTriangle(frame, origin, a, b, c);
+            if (t > minDistance && t < best) {
+                best = t;
+                bestIndex = i;
+            }
+        }
+    }
+
+    if (bestIndex < 0)
+        return false;
+    if (hit) {
+        hit->distance = best;
+        hit->triangle = m_triangles.at(bestIndex);
+    }
+    return true;
+}
+
+bool Bvh::closestPoint(const QVector3D &point, float maxDistance, Closest *closest) const
+{
+    if (m_nodes.isEmpty())
+        return false;
+
+    float best = maxDistance < std::numeric_limits<float>::max() ? maxDistance * maxDistance : std::numeric_limits<float>::max();
+    qsizetype bestIndex = -1;
+    QVector3D bestPoint;
+    Feature bestFeature = Feature::Face;
+    int bestCorner = 0;
+    quint32 stack[kMaxStackDepth];
+    int stackSize = 0;
+    if (boxDistanceSquared(m_nodes.first().min, m_nodes.first().max, point) <= best)
+        stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node &node = m_nodes.at(stack[--stackSize]);
+        if (boxDistanceSquared(node.min, node.max, point) > best)
+            continue;
+
+        if (node.count == 0) {
+            // Push the farther child first so the nearer one is searched next.
+            const float leftDistance = boxDistanceSquared(m_nodes.at(node.index).min, m_nodes.at(node.index).max, point);
+            const float rightDistance = boxDistanceSquared(m_nodes.at(node.index + 1).min, m_nodes.at(node.index + 1).max, point);
+            const quint32 nearer = leftDistance <= rightDistance ? node.index : node.index + 1;
+            const quint32 farther = leftDistance <= rightDistance ? node.index + 1 : node.index;
+            if (stackSize + 2 > kMaxStackDepth)
+                continue;
+            if (qMax(leftDistance, rightDistance) <= best)
+                stack[stackSize++] = farther;
+            if (qMin(leftDistance, rightDistance) <= best)
+                stack[stackSize++] = nearer;
+            continue;
+        }
+
+        for (quint32 i = node.index; i < node.index + node.count; ++i) {
+            Feature feature;
+            int corner;
+            const QVector3D candidate = closestOnTriangle(point, m_vertices.at(i * 3), m_vertices.at(i * 3 + 1), m_vertices.at(i * 3 + 2), &feature, &corner);
+            const float distance = (candidate - point).lengthSquared();
+            if (distance < best || (bestIndex < 0 && distance <= best)) {
+                best = distance;
+                bestIndex = i;
+                bestPoint = candidate;
+                bestFeature = feature;
+                bestCorner = corner;
+            }
+        }
+    }
+
+    if (bestIndex < 0)
+        return false;
+    if (closest) {
+        const QVector3D &a = m_vertices.at(bestIndex * 3);
+        closest->point = bestPoint;
+        closest->normal = QVector3D::crossProduct(m_vertices.at(bestIndex * 3 + 1) - a, m_vertices.at(bestIndex * 3 + 2) - a).normalized();
+        closest->distance = std::sqrt(best);
+        closest->triangle = m_triangles.at(bestIndex);
+        closest->feature = bestFeature;
+        closest->corner = bestCorner;
+    }
+    return true;
+}
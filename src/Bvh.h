@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QVector>
+#include <QVector3D>
+
+// Bounding volume hierarchy over a triangle mesh for ray and proximity
+// queries. Nodes are split at the centroid median of their widest axis; the
+// subtrees below the first few levels are built concurrently and spliced
+// into one flat array. Queries are const and safe to run from many threads.
+class Bvh
+{
+public:
+    struct Hit
+    {
+        float distance = 0.0f;
+        quint32 triangle = 0;
+    };
+
+    // Where on its triangle a closest point lies.
+    enum class Feature
+    {
+        Face,
+        Edge,  // the edge from `corner` to the next corner
+        Vertex // at `corner`
+    };
+
+    struct Closest
+    {
+        QVector3D point;
+        QVector3D normal; // unit counter-clockwise normal of the triangle
+        float distance = 0.0f;
+        quint32 triangle = 0;
+        Feature feature = Feature::Face;
+        int corner = 0;
+    };
+
+    Bvh() = default;
+
+    void build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices);
+    void clear();
+    bool isEmpty() const { return m_nodes.isEmpty(); }
+
+    const QVector3D &minBounds() const { return m_minBounds; }
+    const QVector3D &maxBounds() const { return m_maxBounds; }
+
+    // Nearest triangle hit with minDistance < t < maxDistance. With
+    // `backFacesOnly`, triangles whose counter-clockwise normal faces the
+    // ray origin are skipped. `direction` must be normalized.
+    bool intersect(const QVector3D &origin,
+                   const QVector3D &direction,
+                   float minDistance,
+                   float maxDistance,
+                   Hit *hit,
+                   bool backFacesOnly = false) const;
+    // Nearest point on the surface within maxDistance of `point`.
+    bool closestPoint(const QVector3D &point, float maxDistance, Closest *closest) const;
+
+private:
+    struct Node
+    {
+        float min[3];
+        quint32 index; // first triangle of a leaf, or the left child (right = left + 1)
+        float max[3];
+        quint32 count; // 0 for inner nodes
+    };
+
+    struct Builder;
+
+    QVector<Node> m_nodes;
+    QVector<QVector3D> m_vertices; // three per triangle, in leaf order
+    QVector<quint32> m_triangles;  // original triangle index, in leaf order
+    QVector3D m_minBounds;
+    QVector3D m_maxBounds;
+};
@@ -67,6 +67,23 @@ QMatrix4x4 Camera::projectionMatrix() const
     return projection;
 }
 
+QMatrix4x4 Camera::tileProjectionMatrix(const QSize &imageSize, const QRect &tile) const
+{
+    const float top = m_nearPlane * qTan(qDegreesToRadians(m_fovY) * 0.5f);
+    const float right = top * static_cast<float>(imageSize.width()) / qMax(1, imageSize.height());
+    const float width = static_cast<float>(qMax(1, imageSize.width()));
+    const float height = static_cast<float>(qMax(1, imageSize.height()));
+
+    const float tileLeft = -right + 2.0f * right * tile.left() / width;
+    const float tileRight = -right + 2.0f * right * (tile.left() + tile.width()) / width;
+    const float tileTop = top - 2.0f * top * tile.top() / height;
+    const float tileBottom = top - 2.0f * top * (tile.top() + tile.height()) / height;
+
+    QMatrix4x4 projection;
+    projection.frustum(tileLeft, tileRight, tileBottom, tileTop, m_nearPlane, m_farPlane);
+    return projection;
+}
+
 QVector3D Camera::position() const
 {
     const float yawRad = qDegreesToRadians(m_yaw);
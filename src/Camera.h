@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QMatrix4x4>
+#include <QRect>
+#include <QSize>
 #include <QVector2D>
 #include <QVector3D>
 
@@ -20,6 +22,7 @@ public:
 
     QMatrix4x4 viewMatrix() const;
     QMatrix4x4 projectionMatrix() const;
+    QMatrix4x4 tileProjectionMatrix(const QSize &imageSize, const QRect &tile) const;
 
     QVector3D position() const;
     QVector3D target() const { return m_target; }
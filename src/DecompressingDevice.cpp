@@ -0,0 +1,360 @@
+#include "DecompressingDevice.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QObject>
+#include <QThread>
+
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+constexpr qsizetype kInputChunkSize = 256 * 1024;
+constexpr qsizetype kBlockSize = 1 << 20;
+// Enough decompressed look-ahead to keep the parser busy without letting
+// a fast decompressor run away from a slow parser.
+constexpr qsizetype kQueueDepth = 4;
+}
+
+DecompressingDevice::Codec DecompressingDevice::detect(const QByteArray &header)
+{
+    const auto *bytes = reinterpret_cast<const uchar *>(header.constData());
+    if (header.size() >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+        return Codec::Gzip;
+    if (header.size() >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd)
+        return Codec::Zstd;
+    return Codec::None;
+}
+
+bool DecompressingDevice::isSupported(Codec codec)
+{
+    switch (codec) {
+    case Codec::Gzip:
+#ifdef HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Codec::Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case Codec::None:
+        break;
+    }
+    return false;
+}
+
+DecompressingDevice::DecompressingDevice(const QString &path, Codec codec)
+    : m_path(path)
+    , m_codec(codec)
+{
+}
+
+DecompressingDevice::~DecompressingDevice()
+{
+    stopWorker();
+}
+
+bool DecompressingDevice::open(OpenMode mode)
+{
+    if (isOpen() || (mode & WriteOnly)) {
+        setErrorString(QObject::tr("Compressed files can only be opened once for reading."));
+        return false;
+    }
+    if (!isSupported(m_codec)) {
+        setErrorString(m_codec == Codec::Zstd ? QObject::tr("This build has no zstd support.")
+                                              : QObject::tr("This build has no gzip support."));
+        return false;
+    }
+
+    m_blocks.clear();
+    m_blockOffset = 0;
+    m_finished = false;
+    m_cancelled = false;
+    m_failed = false;
+    m_error.clear();
+
+    if (!QIODevice::open(mode))
+        return false;
+    m_worker.reset(QThread::create([this]() { run(); }));
+    m_worker->start();
+    return true;
+}
+
+void DecompressingDevice::close()
+{
+    stopWorker();
+    m_blocks.clear();
+    m_blockOffset = 0;
+    QIODevice::close();
+}
+
+bool DecompressingDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 DecompressingDevice::bytesAvailable() const
+{
+    if (!m_worker)
+        return QIODevice::bytesAvailable();
+
+    // atEnd() on a sequential device means "no bytes available", so wait
+    // until the worker has either produced a block or run dry.
+    QMutexLocker locker(&m_mutex);
+    while (m_blocks.isEmpty() && !m_finished)
+        m_blockReady.wait(&m_mutex);
+    qint64 pending = -m_blockOffset;
+    for (const QByteArray &block : m_blocks)
+        pending += block.size();
+    return pending + QIODevice::bytesAvailable();
+}
+
+QString DecompressingDevice::error() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failed ? m_error : QString();
+}
+
+qint64 DecompressingDevice::readData(char *data, qint64 maxSize)
+{
+    // Fill the request completely unless the stream ends, so record-sized
+    // reads never come back short in the middle of a file.
+    qint64 copied = 0;
+    QMutexLocker locker(&m_mutex);
+    while (copied < maxSize) {
+        while (m_blocks.isEmpty() && !m_finished)
+            m_blockReady.wait(&m_mutex);
+        if (m_blocks.isEmpty())
+            break;
+
+        const QByteArray &block = m_blocks.head();
+        const qint64 count = qMin<qint64>(block.size() - m_blockOffset, maxSize - copied);
+        std::memcpy(data + copied, block.constData() + m_blockOffset, static_cast<size_t>(count));
+        copied += count;
+        m_blockOffset += count;
+        if (m_blockOffset == block.size()) {
+            m_blocks.dequeue();
+            m_blockOffset = 0;
+            m_spaceFree.wakeOne();
+        }
+    }
+
+    if (copied == 0 && m_failed) {
+        const QString message = m_error;
+        locker.unlock();
+        setErrorString(message);
+        return -1;
+    }
+    return copied;
+}
+
+qint64 DecompressingDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+void DecompressingDevice::run()
+{
+    QString errorMessage;
+    bool ok = false;
+    QFile input(m_path);
+    if (!input.open(QIODevice::ReadOnly)) {
+        errorMessage = QObject::tr("Unable to open file %1").arg(m_path);
+    } else if (m_codec == Codec::Gzip) {
+        ok = inflateGzip(input, &errorMessage);
+    } else if (m_codec == Codec::Zstd) {
+        ok = decompressZstd(input, &errorMessage);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!ok && !m_cancelled) {
+        m_failed = true;
+        m_error = errorMessage;
+    }
+    m_finished = true;
+    m_blockReady.wakeAll();
+}
+
+bool DecompressingDevice::push(QByteArray block)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_blocks.size() >= kQueueDepth && !m_cancelled)
+        m_spaceFree.wait(&m_mutex);
+    if (m_cancelled)
+        return false;
+    m_blocks.enqueue(std::move(block));
+    m_blockReady.wakeAll();
+    return true;
+}
+
+void DecompressingDevice::stopWorker()
+{
+    if (!m_worker)
+        return;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+        m_spaceFree.wakeAll();
+    }
+    m_worker->wait();
+    m_worker.reset();
+}
+
+bool DecompressingDevice::inflateGzip(QIODevice &input, QString *errorMessage)
+{
+#ifdef HAVE_ZLIB
+    z_stream stream = {};
+    // 16 + MAX_WBITS selects the gzip wrapper rather than raw zlib.
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        *errorMessage = QObject::tr("Unable to initialize gzip decompression.");
+        return false;
+    }
+
+    QByteArray in(kInputChunkSize, Qt::Uninitialized);
+    QByteArray out(kBlockSize, Qt::Uninitialized);
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    bool ok = true;
+    bool memberEnded = false;
+    bool outputFull = false;
+    for (;;) {
+        if (stream.avail_out == 0) {
+            if (!push(std::move(out))) {
+                ok = false;
+                break;
+            }
+            out = QByteArray(kBlockSize, Qt::Uninitialized);
+            stream.next_out = reinterpret_cast<Bytef *>(out.data());
+            stream.avail_out = static_cast<uInt>(out.size());
+        }
+        // A full output block may leave inflate holding pending bytes, so
+        // only go back to the file once it has stopped producing.
+        if (stream.avail_in == 0 && !outputFull) {
+            const qint64 read = input.read(in.data(), in.size());
+            if (read < 0) {
+                *errorMessage = QObject::tr("Unable to read %1").arg(m_path);
+                ok = false;
+                break;
+            }
+            if (read == 0)
+                break;
+            stream.next_in = reinterpret_cast<Bytef *>(in.data());
+            stream.avail_in = static_cast<uInt>(read);
+        }
+
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        outputFull = stream.avail_out == 0;
+        if (status == Z_STREAM_END) {
+            // Concatenated members (pigz, appended archives) are valid gzip.
+            memberEnded = true;
+            inflateReset(&stream);
+        } else if (status == Z_OK) {
+            memberEnded = false;
+        } else if (status == Z_DATA_ERROR && memberEnded) {
+            // Trailing garbage after a complete member; gunzip ignores it too.
+            break;
+        } else if (status != Z_BUF_ERROR) {
+            *errorMessage = QObject::tr("Corrupt gzip data: %1")
+                                .arg(QString::fromLatin1(stream.msg ? stream.msg : "unknown error"));
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok && !memberEnded) {
+        *errorMessage = QObject::tr("Unexpected end of gzip data.");
+        ok = false;
+    }
+    if (ok && stream.avail_out < static_cast<uInt>(out.size())) {
+        out.resize(out.size() - stream.avail_out);
+        ok = push(std::move(out));
+    }
+    inflateEnd(&stream);
+    return ok;
+#else
+    Q_UNUSED(input);
+    *errorMessage = QObject::tr("This build has no gzip support.");
+    return false;
+#endif
+}
+
+bool DecompressingDevice::decompressZstd(QIODevice &input, QString *errorMessage)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (!stream || ZSTD_isError(ZSTD_initDStream(stream))) {
+        ZSTD_freeDStream(stream);
+        *errorMessage = QObject::tr("Unable to initialize zstd decompression.");
+        return false;
+    }
+
+    QByteArray in(static_cast<qsizetype>(ZSTD_DStreamInSize()), Qt::Uninitialized);
+    QByteArray out(kBlockSize, Qt::Uninitialized);
+    ZSTD_inBuffer source = {in.constData(), 0, 0};
+    ZSTD_outBuffer target = {out.data(), static_cast<size_t>(out.size()), 0};
+
+    bool ok = true;
+    bool outputFull = false;
+    // ZSTD_decompressStream returns 0 exactly when a frame is complete.
+    size_t remaining = 0;
+    for (;;) {
+        if (target.pos == target.size) {
+            if (!push(std::move(out))) {
+                ok = false;
+                break;
+            }
+            out = QByteArray(kBlockSize, Qt::Uninitialized);
+            target = {out.data(), static_cast<size_t>(out.size()), 0};
+        }
+        if (source.pos == source.size && !outputFull) {
+            const qint64 read = input.read(in.data(), in.size());
+            if (read < 0) {
+                *errorMessage = QObject::tr("Unable to read %1").arg(m_path);
+                ok = false;
+                break;
+            }
+            if (read == 0)
+                break;
+            source = {in.constData(), static_cast<size_t>(read), 0};
+        }
+
+        remaining = ZSTD_decompressStream(stream, &target, &source);
+        if (ZSTD_isError(remaining)) {
+            *errorMessage = QObject::tr("Corrupt zstd data: %1").arg(QString::fromLatin1(ZSTD_getErrorName(remaining)));
+            ok = false;
+            break;
+        }
+        outputFull = target.pos == target.size;
+    }
+
+    if (ok && remaining != 0) {
+        *errorMessage = QObject::tr("Unexpected end of zstd data.");
+        ok = false;
+    }
+    if (ok && target.pos > 0) {
+        out.resize(static_cast<qsizetype>(target.pos));
+        ok = push(std::move(out));
+    }
+    ZSTD_freeDStream(stream);
+    return ok;
+#else
+    Q_UNUSED(input);
+    *errorMessage = QObject::tr("This build has no zstd support.");
+    return false;
+#endif
+}
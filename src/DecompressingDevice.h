@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QWaitCondition>
+
+#include <memory>
+
+class QThread;
+
+// Read-only sequential device that inflates a gzip or zstd file on a worker
+// thread. Decompressed blocks are handed to the reader through a small
+// bounded queue, so parsing one block overlaps with inflating the next and
+// memory stays flat no matter how large the archive is.
+class DecompressingDevice : public QIODevice
+{
+public:
+    enum class Codec
+    {
+        None,
+        Gzip,
+        Zstd
+    };
+
+    static Codec detect(const QByteArray &header);
+    static bool isSupported(Codec codec);
+
+    DecompressingDevice(const QString &path, Codec codec);
+    ~DecompressingDevice() override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+
+    // Empty unless the worker hit unreadable, corrupt or truncated input.
+    QString error() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void run();
+    bool inflateGzip(QIODevice &input, QString *errorMessage);
+    bool decompressZstd(QIODevice &input, QString *errorMessage);
+    bool push(QByteArray block);
+    void stopWorker();
+
+    QString m_path;
+    Codec m_codec = Codec::None;
+    std::unique_ptr<QThread> m_worker;
+
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_blockReady;
+    QWaitCondition m_spaceFree;
+    QQueue<QByteArray> m_blocks;
+    qsizetype m_blockOffset = 0;
+    bool m_finished = false;
+    bool m_cancelled = false;
+    bool m_failed = false;
+    QString m_error;
+};
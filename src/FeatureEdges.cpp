@@ -0,0 +1,54 @@
+#include "FeatureEdges.h"
+#include "MeshTopology.h"
+
+#include <QtMath>
+
+#include <cmath>
+
+QVector<unsigned int> FeatureEdges::extract(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices, float angleDegrees)
+{
+    const MeshTopology topology = MeshTopology::build(positions, indices);
+    if (topology.isEmpty())
+        return {};
+
+    const QVector<unsigned int> &corners = topology.indices();
+    const qsizetype triangleCount = static_cast<qsizetype>(topology.triangleCount());
+    QVector<QVector3D> faceNormals(triangleCount);
+    Parallel::forEach(triangleCount, [&](qsizetype t) {
+        const QVector3D &a = positions.at(corners.at(t * 3));
+        const QVector3D &b = positions.at(corners.at(t * 3 + 1));
+        const QVector3D &c = positions.at(corners.at(t * 3 + 2));
+        faceNormals[t] = QVector3D::crossProduct(b - a, c - a).normalized();
+    });
+
+    const float cosLimit = std::cos(qDegreesToRadians(angleDegrees));
+    const QVector<Parallel::Range> ranges = topology.edgeRanges();
+    QVector<QVector<unsigned int>> lines(ranges.size());
+    topology.forEachEdge(ranges, [&](const Parallel::Range &range, quint32 v0, quint32, const MeshTopology::HalfEdge *halfEdges, int count) {
+        bool feature = count != 2;
+        if (!feature) {
+            const QVector3D &n0 = faceNormals.at(halfEdges[0].id / 3);
+            QVector3D n1 = faceNormals.at(halfEdges[1].id / 3);
+            // Faces wound against each other run the edge the same way;
+            // that is a winding defect, not a crease.
+            if ((topology.weldedCorner(halfEdges[0].id) == v0) == (topology.weldedCorner(halfEdges[1].id) == v0))
+                n1 = -n1;
+            // Slivers have no usable normal and do not make an edge sharp.
+            feature = !n0.isNull() && !n1.isNull() && QVector3D::dotProduct(n0, n1) < cosLimit;
+        }
+        if (feature) {
+            const quint32 id = halfEdges[0].id;
+            lines[range.index].append(corners.at(id));
+            lines[range.index].append(corners.at(topology.nextCorner(id)));
+        }
+    });
+
+    qsizetype total = 0;
+    for (const QVector<unsigned int> &part : lines)
+        total += part.size();
+    QVector<unsigned int> result;
+    result.reserve(total);
+    for (const QVector<unsigned int> &part : lines)
+        result += part;
+    return result;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QVector>
+#include <QVector3D>
+
+// Edges that carry the shape of a CAD part: open boundaries, non-manifold
+// edges, and edges whose two faces meet at more than a dihedral angle
+// threshold. Unlike a full wireframe they do not depend on the view, so
+// they are extracted once at load time and drawn as a plain line list.
+class FeatureEdges
+{
+public:
+    static constexpr float kDefaultAngle = 30.0f; // degrees
+
+    // Returns a GL_LINES index list into `positions`, two indices per edge,
+    // built from the welded topology of `indices` in parallel.
+    static QVector<unsigned int> extract(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices,
+                                         float angleDegrees = kDefaultAngle);
+};
@@ -0,0 +1,146 @@
+#include "FileReloadWatcher.h"
+#include "Parallel.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+
+namespace
+{
+constexpr int kDebounceMs = 300;
+constexpr qsizetype kHashChunkSize = 8 * 1024 * 1024;
+constexpr QCryptographicHash::Algorithm kHashAlgorithm = QCryptographicHash::Md5;
+}
+
+FileReloadWatcher::FileReloadWatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kDebounceMs);
+    connect(&m_debounce, &QTimer::timeout, this, &FileReloadWatcher::checkFile);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &FileReloadWatcher::scheduleCheck);
+    // Saving by rename drops the file from the watcher; the directory
+    // notification is how we notice it coming back.
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileReloadWatcher::scheduleCheck);
+    // One worker keeps digests arriving in the order they were requested,
+    // so the baseline always lands before the first check.
+    m_pool.setMaxThreadCount(1);
+}
+
+FileReloadWatcher::~FileReloadWatcher()
+{
+    stop();
+    m_pool.waitForDone();
+}
+
+void FileReloadWatcher::watch(const QString &path)
+{
+    stop();
+    if (path.isEmpty())
+        return;
+
+    const QFileInfo info(path);
+    m_path = path;
+    m_size = info.size();
+    m_modified = info.lastModified();
+    m_watcher.addPath(path);
+    m_watcher.addPath(QFileInfo(path).absolutePath());
+    hashFile(false);
+}
+
+void FileReloadWatcher::stop()
+{
+    m_debounce.stop();
+    m_pool.clear();
+    ++m_generation;
+    if (!m_watcher.files().isEmpty())
+        m_watcher.removePaths(m_watcher.files());
+    if (!m_watcher.directories().isEmpty())
+        m_watcher.removePaths(m_watcher.directories());
+    m_path.clear();
+    m_hash.clear();
+    m_size = -1;
+    m_modified = QDateTime();
+    m_pendingSize = -1;
+    m_pendingModified = QDateTime();
+}
+
+QByteArray FileReloadWatcher::contentHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    const qint64 size = file.size();
+    QByteArray contents;
+    const char *data = reinterpret_cast<const char *>(size > 0 ? file.map(0, size) : nullptr);
+    if (!data && size > 0) {
+        contents = file.readAll();
+        if (contents.size() != size)
+            return {};
+        data = contents.constData();
+    }
+
+    // Chunk digests are computed concurrently and then hashed together, so
+    // checking a large export costs little more than reading it.
+    const qsizetype chunkCount = qMax<qsizetype>(1, (size + kHashChunkSize - 1) / kHashChunkSize);
+    const int digestSize = QCryptographicHash::hashLength(kHashAlgorithm);
+    QByteArray digests(chunkCount * digestSize, Qt::Uninitialized);
+    Parallel::forEach(chunkCount, [&](qsizetype chunk) {
+        const qsizetype begin = chunk * kHashChunkSize;
+        const qsizetype length = qMin<qsizetype>(kHashChunkSize, size - begin);
+        const QByteArray digest = QCryptographicHash::hash(QByteArrayView(data + begin, length), kHashAlgorithm);
+        std::memcpy(digests.data() + chunk * digestSize, digest.constData(), digestSize);
+    }, 1);
+    return QCryptographicHash::hash(digests, kHashAlgorithm);
+}
+
+void FileReloadWatcher::scheduleCheck()
+{
+    if (m_path.isEmpty())
+        return;
+    m_pendingSize = -1;
+    m_debounce.start();
+}
+
+void FileReloadWatcher::checkFile()
+{
+    const QFileInfo info(m_path);
+    if (!info.exists())
+        return;
+    if (!m_watcher.files().contains(m_path))
+        m_watcher.addPath(m_path);
+    // Directory notifications also fire for neighbouring files.
+    if (info.size() == m_size && info.lastModified() == m_modified)
+        return;
+
+    // Wait until the writer has gone quiet for a whole interval.
+    if (info.size() != m_pendingSize || info.lastModified() != m_pendingModified) {
+        m_pendingSize = info.size();
+        m_pendingModified = info.lastModified();
+        m_debounce.start();
+        return;
+    }
+
+    m_size = m_pendingSize;
+    m_modified = m_pendingModified;
+    hashFile(true);
+}
+
+void FileReloadWatcher::hashFile(bool reportChange)
+{
+    const QString path = m_path;
+    const int generation = m_generation;
+    m_pool.start([this, path, generation, reportChange]() {
+        const QByteArray hash = contentHash(path);
+        QMetaObject::invokeMethod(this, [this, path, generation, reportChange, hash]() {
+            if (generation != m_generation || hash.isEmpty() || hash == m_hash)
+                return;
+            m_hash = hash;
+            if (reportChange)
+                emit fileChanged(path);
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+// Watches the file shown in the viewport and reports when it has really
+// changed. CAD exports arrive as bursts of writes or as delete-and-rename,
+// so a change is only reported once size and modification time have held
+// still for a debounce interval, and only if the content hash differs from
+// the version last reported or watched. Hashing runs on a worker thread
+// and its result is applied on the watcher's thread.
+class FileReloadWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileReloadWatcher(QObject *parent = nullptr);
+    ~FileReloadWatcher() override;
+
+    // Starts watching `path`, taking its current contents as the baseline.
+    void watch(const QString &path);
+    void stop();
+    QString path() const { return m_path; }
+
+    // Digest of the file contents, hashed in parallel chunks. Empty if the
+    // file cannot be read.
+    static QByteArray contentHash(const QString &path);
+
+signals:
+    void fileChanged(const QString &path);
+
+private:
+    void scheduleCheck();
+    void checkFile();
+    // Hashes m_path on m_pool; `reportChange` emits fileChanged if the
+    // digest differs from m_hash, otherwise it only becomes the baseline.
+    void hashFile(bool reportChange);
+
+    QFileSystemWatcher m_watcher;
+    QThreadPool m_pool;
+    int m_generation = 0;
+    QTimer m_debounce;
+    QString m_path;
+    QByteArray m_hash;
+    qint64 m_size = -1;
+    QDateTime m_modified;
+    qint64 m_pendingSize = -1;
+    QDateTime m_pendingModified;
+};
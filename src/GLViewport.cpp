@@ -1,19 +1,30 @@
 #include "GLViewport.h"
+#include "NativeMeshFormat.h"
+#include "PngStreamWriter.h"
+#include "Shaders.h"
 
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QFileInfo>
+#include <QFuture>
 #include <QGuiApplication>
 #include <QImage>
 #include <QKeyEvent>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QOpenGLFramebufferObject>
+#include <QPainter>
+#include <QThread>
 #include <QVector2D>
 #include <QVector>
 #include <QUrl>
 #include <QWheelEvent>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtMath>
 
+#include <cmath>
+#include <memory>
+
 namespace
 {
 constexpr float kOrbitSpeed = 0.35f;
@@ -21,14 +32,41 @@ constexpr float kPanSpeed = 0.2f;
 constexpr float kDollySpeed = 0.5f;
 constexpr float kFlySpeed = 150.0f;
 constexpr float kGamma = 2.2f;
+constexpr int kMaxTileSize = 2048;
+constexpr float kReferenceOpacity = 0.35f;
+constexpr float kWireWidth = 1.0f; // pixels
+constexpr unsigned long kWorkerPollMs = 15;
+const QVector3D kRampColors[4] = {QVector3D(0.35f, 0.75f, 0.4f), QVector3D(0.95f, 0.8f, 0.25f),
+                                  QVector3D(0.9f, 0.2f, 0.15f), QVector3D(0.3f, 0.5f, 0.9f)};
+
+// Angles in degrees such that Rx * Ry * Rz reproduces the rotation part of
+// `m`, matching the order of ModelTransform::matrix().
+QVector3D eulerAngles(const QMatrix4x4 &m)
+{
+    const float sy = qBound(-1.0f, m(0, 2), 1.0f);
+    float x = 0.0f;
+    float z = 0.0f;
+    if (std::abs(sy) < 0.99999f) {
+        x = std::atan2(-m(1, 2), m(2, 2));
+        z = std::atan2(-m(0, 1), m(0, 0));
+    } else {
+        // Gimbal lock: only x + z (or x - z) is defined, so put it all in x.
+        x = std::atan2(m(2, 1), m(1, 1));
+    }
+    return QVector3D(qRadiansToDegrees(x), qRadiansToDegrees(std::asin(sy)), qRadiansToDegrees(z));
+}
 } // namespace
 
 GLViewport::GLViewport(QWidget *parent)
     : QOpenGLWidget(parent)
     , m_bboxVbo(QOpenGLBuffer::VertexBuffer)
+    , m_defectVbo(QOpenGLBuffer::VertexBuffer)
+    , m_sliceVbo(QOpenGLBuffer::VertexBuffer)
 {
     setFocusPolicy(Qt::StrongFocus);
     setAcceptDrops(true);
+    m_loader.setExtractFeatureEdges(true);
+    m_reloadPool.setMaxThreadCount(1);
     updateLightDirection();
     m_updateTimer.setInterval(16);
     connect(&m_updateTimer, &QTimer::timeout, this, [this]() {
@@ -44,11 +82,23 @@ GLViewport::GLViewport(QWidget *parent)
 
 GLViewport::~GLViewport()
 {
+    m_reloadPool.clear();
+    m_reloadPool.waitForDone();
     makeCurrent();
+    m_scene.clear();
+    m_referenceMesh.clear();
     m_bboxVbo.destroy();
     m_bboxVao.destroy();
+    m_defectVbo.destroy();
+    m_defectVao.destroy();
+    m_sliceVbo.destroy();
+    m_sliceVao.destroy();
     m_phongProgram.removeAllShaders();
+    m_phongWireframeProgram.removeAllShaders();
     m_colorProgram.removeAllShaders();
+    m_wireProgram.removeAllShaders();
+    m_capProgram.removeAllShaders();
+    m_capVao.destroy();
     doneCurrent();
 }
 
@@ -59,82 +109,38 @@ void GLViewport::initializeGL()
     glEnable(GL_MULTISAMPLE);
     glClearColor(0.1f, 0.12f, 0.15f, 1.0f);
 
-    const char *phongVertex = R"(
-        #version 410 core
-        layout(location = 0) in vec3 aPosition;
-        layout(location = 1) in vec3 aNormal;
-        uniform mat4 uModel;
-        uniform mat4 uView;
-        uniform mat4 uProjection;
-        uniform mat3 uNormalMatrix;
-        out vec3 vNormal;
-        out vec3 vWorldPos;
-        void main() {
-            vec4 worldPos = uModel * vec4(aPosition, 1.0);
-            vWorldPos = worldPos.xyz;
-            vNormal = uNormalMatrix * aNormal;
-            gl_Position = uProjection * uView * worldPos;
-        }
-    )";
-
-    const char *phongFragment = R"(
-        #version 410 core
-        in vec3 vNormal;
-        in vec3 vWorldPos;
-        uniform vec3 uLightDirection;
-        uniform vec3 uCameraPos;
-        uniform vec3 uBaseColor;
-        uniform int uUseFaceNormals;
-        uniform float uGamma;
-        out vec4 fragColor;
-        void main() {
-            vec3 normal = normalize(vNormal);
-            if (uUseFaceNormals == 1) {
-                vec3 d1 = dFdx(vWorldPos);
-                vec3 d2 = dFdy(vWorldPos);
-                normal = normalize(cross(d1, d2));
-            }
-            vec3 lightDir = normalize(-uLightDirection);
-            float diff = max(dot(normal, lightDir), 0.0);
-            vec3 viewDir = normalize(uCameraPos - vWorldPos);
-            vec3 reflectDir = reflect(-lightDir, normal);
-            float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-            vec3 color = uBaseColor * (0.15 + diff) + vec3(0.4) * spec;
-            color = pow(max(color, vec3(0.0)), vec3(1.0 / max(uGamma, 0.0001)));
-            fragColor = vec4(color, 1.0);
-        }
-    )";
-
-    const char *colorVertex = R"(
-        #version 410 core
-        layout(location = 0) in vec3 aPosition;
-        uniform mat4 uMvp;
-        void main() {
-            gl_Position = uMvp * vec4(aPosition, 1.0);
-        }
-    )";
-
-    const char *colorFragment = R"(
-        #version 410 core
-        uniform vec3 uColor;
-        out vec4 fragColor;
-        void main() {
-            fragColor = vec4(uColor, 1.0);
-        }
-    )";
-
-    if (!m_phongProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, phongVertex) ||
-        !m_phongProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, phongFragment) ||
+    if (!m_phongProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, Shaders::phongVertex) ||
+        !m_phongProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, Shaders::phongFragment) ||
         !m_phongProgram.link()) {
         emit loadFailed(tr("Failed to compile Phong shader: %1").arg(m_phongProgram.log()));
     }
 
-    if (!m_colorProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, colorVertex) ||
-        !m_colorProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, colorFragment) ||
+    if (!m_phongWireframeProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, Shaders::phongVertex) ||
+        !m_phongWireframeProgram.addShaderFromSourceCode(QOpenGLShader::Geometry, Shaders::phongWireframeGeometry) ||
+        !m_phongWireframeProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, Shaders::phongFragment) ||
+        !m_phongWireframeProgram.link()) {
+        emit loadFailed(tr("Failed to compile wireframe shading shader: %1").arg(m_phongWireframeProgram.log()));
+    }
+
+    if (!m_colorProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, Shaders::colorVertex) ||
+        !m_colorProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, Shaders::colorFragment) ||
         !m_colorProgram.link()) {
         emit loadFailed(tr("Failed to compile color shader: %1").arg(m_colorProgram.log()));
     }
 
+    if (!m_wireProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, Shaders::wireVertex) ||
+        !m_wireProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, Shaders::colorFragment) ||
+        !m_wireProgram.link()) {
+        emit loadFailed(tr("Failed to compile wireframe shader: %1").arg(m_wireProgram.log()));
+    }
+
+    if (!m_capProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, Shaders::capVertex) ||
+        !m_capProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, Shaders::colorFragment) ||
+        !m_capProgram.link()) {
+        emit loadFailed(tr("Failed to compile section cap shader: %1").arg(m_capProgram.log()));
+    }
+    m_capVao.create();
+
     m_grid.initialize(this);
     m_bboxVao.create();
     m_bboxVbo.create();
@@ -150,55 +156,116 @@ void GLViewport::resizeGL(int w, int h)
 
 void GLViewport::paintGL()
 {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    renderScene(m_camera.viewMatrix(), m_camera.projectionMatrix());
+    updateFps();
+}
 
+void GLViewport::renderScene(const QMatrix4x4 &view, const QMatrix4x4 &projection)
+{
     if (m_backfaceCulling)
         glEnable(GL_CULL_FACE);
     else
         glDisable(GL_CULL_FACE);
 
-    QMatrix4x4 model;
-    model.translate(m_translation);
-    model.rotate(m_rotation.x(), 1.0f, 0.0f, 0.0f);
-    model.rotate(m_rotation.y(), 0.0f, 1.0f, 0.0f);
-    model.rotate(m_rotation.z(), 0.0f, 0.0f, 1.0f);
-    model.scale(m_scale);
+    const QMatrix4x4 model = activeTransform().matrix();
+
+    m_scene.uploadInstances(this);
+
+    if (!m_scene.isEmpty() && m_phongProgram.isLinked()) {
+        setClipDistancesEnabled(true);
+        // Wireframe modes run the same pass through a geometry shader that
+        // hands every fragment its distance to the triangle's edges.
+        const bool wireframe = m_shadingMode == ShadingMode::Wireframe || m_shadingMode == ShadingMode::ShadedWireframe;
+        QOpenGLShaderProgram &program = wireframe ? m_phongWireframeProgram : m_phongProgram;
+        if (program.isLinked()) {
+            program.bind();
+            updateCameraUniforms(program, QMatrix4x4(), view, projection);
+            setClipUniforms(program);
+            program.setUniformValue("uLightDirection", m_lightDirection.normalized());
+            program.setUniformValue("uCameraPos", m_camera.position());
+            program.setUniformValue("uBaseColor", QVector3D(0.7f, 0.72f, 0.75f));
+            program.setUniformValue("uFaceColors", Mesh::kFaceColorTextureUnit);
+            program.setUniformValue("uUseFaceNormals", m_faceNormals ? 1 : 0);
+            program.setUniformValue("uGamma", kGamma);
+            program.setUniformValue("uAnalysisMode", static_cast<int>(m_analysisMode));
+            program.setUniformValue("uBuildDirection", QVector3D(0.0f, 1.0f, 0.0f));
+            program.setUniformValue("uAnalysisThreshold", m_analysisMode == AnalysisMode::Draft ? m_draftThreshold : m_overhangThreshold);
+            program.setUniformValueArray("uRampColors", kRampColors, 4);
+            program.setUniformValue("uScalarMode", static_cast<int>(m_scalarView));
+            // One color scale for every part on show, so equal colors mean
+            // equal values across parts.
+            if (m_scalarView == ScalarView::Deviation) {
+                program.setUniformValue("uScalarThreshold", m_deviationTolerance);
+                program.setUniformValue("uScalarMax", qMax(scalarMax(), m_deviationTolerance * 2.0f));
+            } else {
+                const float maximum = scalarMax();
+                program.setUniformValue("uScalarThreshold", m_thicknessThreshold);
+                program.setUniformValue("uScalarMax", maximum > 0.0f ? maximum : m_thicknessThreshold);
+            }
+            program.setUniformValue("uWireframe", m_shadingMode == ShadingMode::Wireframe ? 2 : (wireframe ? 1 : 0));
+            if (wireframe) {
+                // Tiled screenshots render into a framebuffer of their own
+                // size, so the pixel scale comes from the current viewport.
+                GLint viewport[4] = {0, 0, 1, 1};
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                program.setUniformValue("uViewportSize", QVector2D(viewport[2], viewport[3]));
+                program.setUniformValue("uWireColor", QVector3D(0.05f, 0.9f, 0.9f));
+                program.setUniformValue("uWireWidth", kWireWidth);
+            }
 
-    const QMatrix4x4 view = m_camera.viewMatrix();
-    const QMatrix4x4 projection = m_camera.projectionMatrix();
-
-    if (m_mesh.isValid() && m_phongProgram.isLinked()) {
-        if (m_shadingMode == ShadingMode::Shaded || m_shadingMode == ShadingMode::ShadedWireframe) {
-            m_phongProgram.bind();
-            updateCameraUniforms(m_phongProgram, model, view, projection);
-            m_phongProgram.setUniformValue("uLightDirection", m_lightDirection.normalized());
-            m_phongProgram.setUniformValue("uCameraPos", m_camera.position());
-            m_phongProgram.setUniformValue("uBaseColor", QVector3D(0.7f, 0.72f, 0.75f));
-            m_phongProgram.setUniformValue("uUseFaceNormals", m_faceNormals ? 1 : 0);
-            m_phongProgram.setUniformValue("uGamma", kGamma);
-            m_mesh.draw(this);
-            m_phongProgram.release();
+            // Edges only: hidden edges stay visible as before, and the
+            // anti-aliased rims are blended over what is behind them. Rims
+            // must not write depth, or the nearer ones would cut gaps into
+            // edges drawn after them.
+            if (m_shadingMode == ShadingMode::Wireframe) {
+                glDisable(GL_CULL_FACE);
+                glDepthMask(GL_FALSE);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+            // Feature edges lie exactly on the faces; pushing the faces back
+            // a little keeps the lines from z-fighting with them.
+            if (m_shadingMode == ShadingMode::ShadedFeatureEdges) {
+                glEnable(GL_POLYGON_OFFSET_FILL);
+                glPolygonOffset(1.0f, 1.0f);
+            }
+            const QMatrix4x4 viewProjection = projection * view;
+            m_scene.draw(this, &viewProjection);
+            if (m_shadingMode == ShadingMode::Wireframe) {
+                glDisable(GL_BLEND);
+                glDepthMask(GL_TRUE);
+                if (m_backfaceCulling)
+                    glEnable(GL_CULL_FACE);
+            }
+            if (m_shadingMode == ShadingMode::ShadedFeatureEdges)
+                glDisable(GL_POLYGON_OFFSET_FILL);
+            program.release();
         }
 
-        if (m_shadingMode == ShadingMode::Wireframe || m_shadingMode == ShadingMode::ShadedWireframe) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glDisable(GL_CULL_FACE);
-            m_colorProgram.bind();
-            m_colorProgram.setUniformValue("uMvp", projection * view * model);
-            m_colorProgram.setUniformValue("uColor", QVector3D(0.05f, 0.9f, 0.9f));
-            m_mesh.draw(this);
-            m_colorProgram.release();
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            if (m_backfaceCulling)
-                glEnable(GL_CULL_FACE);
+        if (m_shadingMode == ShadingMode::ShadedFeatureEdges && m_wireProgram.isLinked()) {
+            m_wireProgram.bind();
+            m_wireProgram.setUniformValue("uViewProjection", projection * view);
+            m_wireProgram.setUniformValue("uColor", QVector3D(0.05f, 0.05f, 0.06f));
+            setClipUniforms(m_wireProgram);
+            m_scene.drawFeatureEdges(this);
+            m_wireProgram.release();
         }
 
+        if (m_sectionCaps && m_shadingMode != ShadingMode::Wireframe && anyClipPlaneEnabled())
+            drawSectionCaps(projection * view);
+        if (m_referenceVisible && m_referenceMesh.isValid())
+            drawReference(view, projection);
+        setClipDistancesEnabled(false);
+
         if (m_shadingMode == ShadingMode::Shaded && m_backfaceCulling)
             glEnable(GL_CULL_FACE);
 
-        if (m_bboxVertexCount > 0 && m_colorProgram.isLinked()) {
+        if (m_activeInstance >= 0 && m_bboxVertexCount > 0 && m_colorProgram.isLinked()) {
             m_colorProgram.bind();
             drawBoundingBox(projection * view * model, QVector3D(0.85f, 0.35f, 0.1f));
+            drawDefectHighlight(projection * view * model);
+            drawSlice(projection * view * model);
             m_colorProgram.release();
         }
     }
@@ -231,43 +298,269 @@ void GLViewport::paintGL()
         });
         m_colorProgram.release();
     }
-
-    updateFps();
 }
 
 bool GLViewport::loadMesh(const QString &path, QString *errorMessage)
 {
-    MeshBuffer buffer = m_loader.load(path, errorMessage);
+    const MeshBuffer buffer = m_loader.load(path, errorMessage);
+    return loadMeshBuffer(path, buffer, errorMessage);
+}
+
+bool GLViewport::loadMeshBuffer(const QString &path, const MeshBuffer &buffer, QString *errorMessage)
+{
     if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
         if (errorMessage && errorMessage->isEmpty())
             *errorMessage = tr("No geometry found in %1").arg(path);
         return false;
     }
 
-    m_mesh.clear();
-    m_mesh.setData(buffer.positions, buffer.normals, buffer.indices, buffer.hasNormals);
-    if (m_recomputeNormals || !buffer.hasNormals)
-        m_mesh.computeSmoothNormals();
-    else
-        m_mesh.restoreOriginalNormals();
+    makeCurrent();
+    clearDefectHighlight();
+    m_scene.clear();
+    m_activeInstance = -1;
+    m_slicer.clear();
+    m_slicerResource = -1;
+    m_sliceVertexCount = 0;
+    doneCurrent();
+
+    const int resource = addMeshResource(path, buffer);
+    m_activeInstance = m_scene.addInstance(resource);
 
     makeCurrent();
-    m_mesh.upload(this);
     updateBoundingBoxBuffer();
+    updateSliceBuffer();
     doneCurrent();
 
     updateStatistics(path);
+    focusCameraOnActive();
+    resetModelTransform();
+    emit sceneChanged(m_scene.instanceCount(), m_activeInstance);
+    update();
+    return true;
+}
 
-    const QVector3D center = (m_mesh.minBounds() + m_mesh.maxBounds()) * 0.5f;
-    const float radius = m_mesh.size().length() * 0.5f;
-    m_camera.focus(center, qMax(radius, 1.0f));
-    emit cameraDistanceChanged(m_camera.distance());
+bool GLViewport::addMesh(const QString &path, QString *errorMessage)
+{
+    const MeshBuffer buffer = m_loader.load(path, errorMessage);
+    return addMeshBuffer(path, buffer, errorMessage);
+}
 
-    resetModelTransform();
+bool GLViewport::addMeshBuffer(const QString &path, const MeshBuffer &buffer, QString *errorMessage)
+{
+    if (m_scene.isEmpty())
+        return loadMeshBuffer(path, buffer, errorMessage);
+
+    if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
+        if (errorMessage && errorMessage->isEmpty())
+            *errorMessage = tr("No geometry found in %1").arg(path);
+        return false;
+    }
+
+    const int resource = addMeshResource(path, buffer);
+    m_scene.addInstance(resource);
+    setActiveInstance(m_scene.instanceCount() - 1);
+    return true;
+}
+
+int GLViewport::addMeshResource(const QString &path, const MeshBuffer &buffer)
+{
+    const int resource = m_scene.addResource(path);
+    makeCurrent();
+    setResourceGeometry(resource, buffer);
+    doneCurrent();
+    return resource;
+}
+
+void GLViewport::setResourceGeometry(int resource, const MeshBuffer &buffer)
+{
+    SceneResource &entry = m_scene.resource(resource);
+    Mesh &mesh = entry.mesh;
+    mesh.setData(buffer.positions, buffer.normals, buffer.indices, buffer.hasNormals);
+    mesh.setColors(buffer.colors);
+    mesh.setFaceColors(buffer.faceColors);
+    mesh.setRanges(buffer.ranges);
+    // Buffers from the cache or the batch loader may have been extracted
+    // at another angle, or not at all.
+    mesh.setFeatureEdges(buffer.featureAngle == m_featureEdgeAngle
+                             ? buffer.featureEdges
+                             : FeatureEdges::extract(buffer.positions, buffer.indices, m_featureEdgeAngle));
+    entry.mass = MassProperties::compute(mesh.positions(), mesh.indices(), (mesh.minBounds() + mesh.maxBounds()) * 0.5f);
+    entry.normals.build(mesh.positions(), mesh.indices());
+    entry.acmrBefore = buffer.acmrBefore;
+    entry.acmrAfter = buffer.acmrAfter;
+    if (m_recomputeNormals || !buffer.hasNormals)
+        mesh.computeSmoothNormals();
+    else
+        mesh.restoreOriginalNormals();
+
+    // Everything derived from the previous geometry is stale.
+    entry.bvh.clear();
+    entry.thickness = WallThicknessField();
+    entry.deviation = DeviationField();
+    mesh.clearScalarField(this);
+    mesh.upload(this);
+}
+
+void GLViewport::reloadMesh(const QString &path)
+{
+    // The worker parses with its own copy of the loader, so feature angle
+    // changes made meanwhile do not race with it.
+    m_reloadPool.clear();
+    const int generation = ++m_reloadGeneration;
+    m_reloadPool.start([this, loader = m_loader, path, generation]() {
+        QString errorMessage;
+        const MeshBuffer buffer = loader.load(path, &errorMessage);
+        QMetaObject::invokeMethod(this, [this, path, generation, buffer, errorMessage]() mutable {
+            if (generation != m_reloadGeneration)
+                return;
+            if (applyReload(path, buffer, &errorMessage))
+                errorMessage.clear();
+            else if (errorMessage.isEmpty())
+                errorMessage = tr("%1 is no longer loaded").arg(path);
+            emit meshReloaded(path, errorMessage);
+        }, Qt::QueuedConnection);
+    });
+}
+
+bool GLViewport::applyReload(const QString &path, const MeshBuffer &buffer, QString *errorMessage)
+{
+    if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
+        if (errorMessage && errorMessage->isEmpty())
+            *errorMessage = tr("No geometry found in %1").arg(path);
+        return false;
+    }
+
+    bool reloaded = false;
+    makeCurrent();
+    for (int i = 0; i < m_scene.resourceCount(); ++i) {
+        if (m_scene.resource(i).path != path)
+            continue;
+        setResourceGeometry(i, buffer);
+        if (m_slicerResource == i)
+            m_slicerResource = -1;
+        if (m_defectResource == i)
+            clearDefectHighlight();
+        reloaded = true;
+    }
+    if (reloaded) {
+        updateBoundingBoxBuffer();
+        updateSliceBuffer();
+    }
+    doneCurrent();
+    if (!reloaded)
+        return false;
+
+    applyScalarView();
+    updateStatistics(m_loadedFilePath);
     update();
     return true;
 }
 
+void GLViewport::addInstanceCopies(int count)
+{
+    if (m_activeInstance < 0 || count <= 0)
+        return;
+
+    const SceneInstance source = m_scene.instance(m_activeInstance);
+    const Mesh &mesh = m_scene.resource(source.resource).mesh;
+    const QVector3D footprint = mesh.size() * source.transform.scale;
+    const float spacingX = qMax(footprint.x(), 1.0f) * 1.1f;
+    const float spacingZ = qMax(footprint.z(), 1.0f) * 1.1f;
+    const int total = m_scene.instanceCount(source.resource) + count;
+    const int columns = qMax(1, qCeil(qSqrt(static_cast<qreal>(total))));
+
+    int placed = m_scene.instanceCount(source.resource);
+    for (int i = 0; i < count; ++i, ++placed) {
+        ModelTransform transform = source.transform;
+        transform.translation += QVector3D((placed % columns) * spacingX, 0.0f, (placed / columns) * spacingZ);
+        m_scene.addInstance(source.resource, transform);
+    }
+
+    updateStatistics(m_loadedFilePath);
+    emit sceneChanged(m_scene.instanceCount(), m_activeInstance);
+    update();
+}
+
+void GLViewport::clearScene()
+{
+    makeCurrent();
+    clearDefectHighlight();
+    m_scene.clear();
+    m_activeInstance = -1;
+    m_bboxVertexCount = 0;
+    m_slicer.clear();
+    m_slicerResource = -1;
+    m_sliceVertexCount = 0;
+    doneCurrent();
+    m_loadedFilePath.clear();
+    m_stats = MeshStatistics();
+    emit meshInfoChanged(m_stats);
+    emit sceneChanged(0, -1);
+    update();
+}
+
+void GLViewport::frameScene()
+{
+    QVector3D min;
+    QVector3D max;
+    if (!m_scene.bounds(&min, &max))
+        return;
+    m_camera.focus((min + max) * 0.5f, qMax((max - min).length() * 0.5f, 1.0f));
+    emit cameraDistanceChanged(m_camera.distance());
+    update();
+}
+
+void GLViewport::setActiveInstance(int index)
+{
+    if (index < 0 || index >= m_scene.instanceCount())
+        return;
+
+    const bool changed = index != m_activeInstance;
+    m_activeInstance = index;
+    makeCurrent();
+    updateBoundingBoxBuffer();
+    updateSliceBuffer();
+    doneCurrent();
+    applyScalarView();
+    updateStatistics(m_scene.resource(m_scene.instance(index).resource).path);
+    syncTransformToUi();
+    if (changed)
+        emit sceneChanged(m_scene.instanceCount(), m_activeInstance);
+    update();
+}
+
+Mesh *GLViewport::activeMesh()
+{
+    if (m_activeInstance < 0 || m_activeInstance >= m_scene.instanceCount())
+        return nullptr;
+    return &m_scene.resource(m_scene.instance(m_activeInstance).resource).mesh;
+}
+
+const Mesh *GLViewport::activeMesh() const
+{
+    if (m_activeInstance < 0 || m_activeInstance >= m_scene.instanceCount())
+        return nullptr;
+    return &m_scene.resource(m_scene.instance(m_activeInstance).resource).mesh;
+}
+
+ModelTransform GLViewport::activeTransform() const
+{
+    if (m_activeInstance < 0 || m_activeInstance >= m_scene.instanceCount())
+        return ModelTransform();
+    return m_scene.instance(m_activeInstance).transform;
+}
+
+void GLViewport::focusCameraOnActive()
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh)
+        return;
+    const QVector3D center = (mesh->minBounds() + mesh->maxBounds()) * 0.5f;
+    const float radius = mesh->size().length() * 0.5f;
+    m_camera.focus(center, qMax(radius, 1.0f));
+    emit cameraDistanceChanged(m_camera.distance());
+}
+
 bool GLViewport::saveScreenshot(const QString &path)
 {
     const QImage image = grabFramebuffer();
@@ -276,6 +569,106 @@ bool GLViewport::saveScreenshot(const QString &path)
     return image.save(path, "PNG");
 }
 
+bool GLViewport::saveHighResolutionScreenshot(const QString &path, const QSize &size, QString *errorMessage)
+{
+    if (size.isEmpty()) {
+        if (errorMessage)
+            *errorMessage = tr("Invalid image size.");
+        return false;
+    }
+
+    makeCurrent();
+
+    GLint maxRenderbufferSize = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+    const int tileEdge = qBound(256, maxRenderbufferSize, kMaxTileSize);
+    const QSize tileSize(qMin(tileEdge, size.width()), qMin(tileEdge, size.height()));
+
+    QOpenGLFramebufferObjectFormat format;
+    format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    format.setSamples(4);
+    QOpenGLFramebufferObject fbo(tileSize, format);
+    if (!fbo.isValid()) {
+        doneCurrent();
+        if (errorMessage)
+            *errorMessage = tr("Unable to create an offscreen framebuffer.");
+        return false;
+    }
+
+    PngStreamWriter writer;
+    if (!writer.open(path, size, errorMessage)) {
+        doneCurrent();
+        return false;
+    }
+
+    const QMatrix4x4 view = m_camera.viewMatrix();
+    bool ok = true;
+    for (int y = 0; y < size.height() && ok; y += tileSize.height()) {
+        const int rows = qMin(tileSize.height(), size.height() - y);
+        QImage strip(size.width(), rows, QImage::Format_RGB32);
+        QPainter painter(&strip);
+        for (int x = 0; x < size.width(); x += tileSize.width()) {
+            const int columns = qMin(tileSize.width(), size.width() - x);
+            const QRect tile(x, y, columns, rows);
+
+            fbo.bind();
+            glViewport(0, 0, columns, rows);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            renderScene(view, m_camera.tileProjectionMatrix(size, tile));
+            fbo.release();
+
+            const QImage tileImage = fbo.toImage();
+            painter.drawImage(QPoint(x, 0), tileImage, QRect(0, tileSize.height() - rows, columns, rows));
+        }
+        painter.end();
+        ok = writer.writeRows(strip, errorMessage);
+    }
+
+    glViewport(0, 0, static_cast<int>(width() * devicePixelRatioF()), static_cast<int>(height() * devicePixelRatioF()));
+    doneCurrent();
+
+    if (!ok)
+        return false;
+    return writer.close(errorMessage);
+}
+
+bool GLViewport::exportNativeMesh(const QString &path, QString *errorMessage) const
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid()) {
+        if (errorMessage)
+            *errorMessage = tr("No model loaded.");
+        return false;
+    }
+
+    MeshBuffer buffer;
+    buffer.positions = mesh->positions();
+    buffer.normals = mesh->normals();
+    buffer.indices = mesh->indices();
+    buffer.hasNormals = mesh->hasSourceNormals() && !m_recomputeNormals;
+
+    NativeMeshFormat format;
+    return format.write(path, buffer, errorMessage);
+}
+
+bool GLViewport::exportStl(const QString &path, STLWriter::Format format, QString *errorMessage, const STLWriter::ProgressFunction &progress) const
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid()) {
+        if (errorMessage)
+            *errorMessage = tr("No model loaded.");
+        return false;
+    }
+
+    MeshBuffer buffer;
+    buffer.positions = mesh->positions();
+    buffer.indices = mesh->indices();
+    buffer.faceColors = mesh->faceColors();
+
+    STLWriter writer;
+    return writer.write(path, buffer, activeTransform().matrix(), format, errorMessage, progress);
+}
+
 void GLViewport::setGridVisible(bool visible)
 {
     if (m_gridVisible == visible)
@@ -305,14 +698,23 @@ void GLViewport::setRecomputeNormals(bool enabled)
     if (m_recomputeNormals == enabled)
         return;
     m_recomputeNormals = enabled;
-    if (m_mesh.isValid()) {
-        if (enabled)
-            m_mesh.computeSmoothNormals();
-        else
-            m_mesh.restoreOriginalNormals();
+    if (!m_scene.isEmpty()) {
         makeCurrent();
-        m_mesh.upload(this);
+        for (int i = 0; i < m_scene.resourceCount(); ++i) {
+            Mesh &mesh = m_scene.resource(i).mesh;
+            if (!mesh.isValid())
+                continue;
+            if (enabled)
+                mesh.computeSmoothNormals();
+            else
+                mesh.restoreOriginalNormals();
+            mesh.upload(this);
+            // Thickness rays follow the normals, so the old result is stale.
+            mesh.clearScalarField(this);
+            m_scene.resource(i).thickness = WallThicknessField();
+        }
         doneCurrent();
+        applyScalarView();
         updateStatistics(m_loadedFilePath);
         update();
     }
@@ -336,25 +738,254 @@ void GLViewport::setShadingMode(ShadingMode mode)
 
 void GLViewport::setModelTransform(const QVector3D &translation, const QVector3D &rotation, const QVector3D &scale)
 {
-    m_translation = translation;
-    m_rotation = rotation;
-    m_scale = QVector3D(qMax(scale.x(), 0.0001f), qMax(scale.y(), 0.0001f), qMax(scale.z(), 0.0001f));
+    if (m_activeInstance < 0)
+        return;
+    ModelTransform transform;
+    transform.translation = translation;
+    transform.rotation = rotation;
+    transform.scale = QVector3D(qMax(scale.x(), 0.0001f), qMax(scale.y(), 0.0001f), qMax(scale.z(), 0.0001f));
+    m_scene.setInstanceTransform(m_activeInstance, transform);
+    invalidateDeviation();
     syncTransformToUi();
+    updateOverhangArea();
     update();
 }
 
 void GLViewport::resetModelTransform()
 {
-    m_translation = QVector3D(0, 0, 0);
-    m_rotation = QVector3D(0, 0, 0);
-    m_scale = QVector3D(1, 1, 1);
+    if (m_activeInstance >= 0) {
+        m_scene.setInstanceTransform(m_activeInstance, ModelTransform());
+        invalidateDeviation();
+    }
     syncTransformToUi();
+    updateOverhangArea();
+    update();
+}
+
+void GLViewport::setAnalysisMode(AnalysisMode mode)
+{
+    if (m_analysisMode == mode)
+        return;
+    m_analysisMode = mode;
+    update();
+}
+
+void GLViewport::setOverhangThreshold(float degrees)
+{
+    m_overhangThreshold = qBound(0.0f, degrees, 90.0f);
+    updateOverhangArea();
+    update();
+}
+
+void GLViewport::setDraftThreshold(float degrees)
+{
+    m_draftThreshold = qBound(0.0f, degrees, 90.0f);
+    update();
+}
+
+void GLViewport::setFeatureEdgeAngle(float degrees)
+{
+    degrees = qBound(0.0f, degrees, 180.0f);
+    if (degrees == m_featureEdgeAngle)
+        return;
+    m_featureEdgeAngle = degrees;
+    m_loader.setFeatureAngle(degrees);
+
+    makeCurrent();
+    for (int i = 0; i < m_scene.resourceCount(); ++i) {
+        Mesh &mesh = m_scene.resource(i).mesh;
+        if (mesh.isValid())
+            mesh.updateFeatureEdges(this, FeatureEdges::extract(mesh.positions(), mesh.indices(), degrees));
+    }
+    doneCurrent();
+    update();
+}
+
+void GLViewport::setClipPlaneEnabled(int axis, bool enabled)
+{
+    if (axis < 0 || axis > 2)
+        return;
+    ClipPlane &plane = m_clipPlanes[axis];
+    plane.enabled = enabled;
+    if (enabled) {
+        m_activeClipPlane = axis;
+        QVector3D min;
+        QVector3D max;
+        if (!plane.placed && m_scene.bounds(&min, &max)) {
+            plane.offset = (min[axis] + max[axis]) * 0.5f;
+            plane.placed = true;
+            emit clipPlaneMoved(axis, plane.offset);
+        }
+    } else if (m_activeClipPlane == axis) {
+        m_activeClipPlane = -1;
+        for (int i = 0; i < 3; ++i) {
+            if (m_clipPlanes[i].enabled)
+                m_activeClipPlane = i;
+        }
+    }
+    update();
+}
+
+void GLViewport::setClipPlaneFlipped(int axis, bool flipped)
+{
+    if (axis < 0 || axis > 2)
+        return;
+    m_clipPlanes[axis].flipped = flipped;
+    update();
+}
+
+void GLViewport::setClipPlaneOffset(int axis, float offset)
+{
+    if (axis < 0 || axis > 2)
+        return;
+    m_clipPlanes[axis].offset = offset;
+    m_clipPlanes[axis].placed = true;
+    if (m_clipPlanes[axis].enabled)
+        m_activeClipPlane = axis;
+    update();
+}
+
+void GLViewport::setSectionCapsEnabled(bool enabled)
+{
+    m_sectionCaps = enabled;
     update();
 }
 
+bool GLViewport::anyClipPlaneEnabled() const
+{
+    return m_clipPlanes[0].enabled || m_clipPlanes[1].enabled || m_clipPlanes[2].enabled;
+}
+
+QVector4D GLViewport::clipPlaneEquation(int axis) const
+{
+    const ClipPlane &plane = m_clipPlanes[axis];
+    if (!plane.enabled)
+        return QVector4D(0.0f, 0.0f, 0.0f, 1.0f);
+    // Distance is positive on the kept side: sign * (offset - p[axis]).
+    const float sign = plane.flipped ? -1.0f : 1.0f;
+    QVector4D equation(0.0f, 0.0f, 0.0f, sign * plane.offset);
+    equation[axis] = -sign;
+    return equation;
+}
+
+void GLViewport::setClipUniforms(QOpenGLShaderProgram &program)
+{
+    const QVector4D planes[3] = {clipPlaneEquation(0), clipPlaneEquation(1), clipPlaneEquation(2)};
+    program.setUniformValueArray("uClipPlanes", planes, 3);
+}
+
+void GLViewport::setClipDistancesEnabled(bool enabled)
+{
+    for (int i = 0; i < 3; ++i) {
+        if (enabled && m_clipPlanes[i].enabled)
+            glEnable(GL_CLIP_DISTANCE0 + i);
+        else
+            glDisable(GL_CLIP_DISTANCE0 + i);
+    }
+}
+
+void GLViewport::drawSectionCaps(const QMatrix4x4 &viewProjection)
+{
+    QVector3D min;
+    QVector3D max;
+    if (!m_capProgram.isLinked() || !m_wireProgram.isLinked() || !m_scene.bounds(&min, &max))
+        return;
+    const QVector3D center = (min + max) * 0.5f;
+    const float extent = qMax((max - min).length(), 1.0f);
+
+    // For each plane, count how often each pixel's view ray crosses the
+    // clipped surface (stencil invert = parity); odd counts lie inside the
+    // solid, so the plane quad is filled only there.
+    glEnable(GL_STENCIL_TEST);
+    glDisable(GL_CULL_FACE);
+    for (int axis = 0; axis < 3; ++axis) {
+        if (!m_clipPlanes[axis].enabled)
+            continue;
+
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_DEPTH_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+        m_wireProgram.bind();
+        m_wireProgram.setUniformValue("uViewProjection", viewProjection);
+        setClipUniforms(m_wireProgram);
+        m_scene.draw(this, &viewProjection);
+        m_wireProgram.release();
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_DEPTH_TEST);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+        QVector3D origin = center;
+        origin[axis] = m_clipPlanes[axis].offset;
+        QVector3D u;
+        QVector3D v;
+        u[(axis + 1) % 3] = extent;
+        v[(axis + 2) % 3] = extent;
+
+        // The quad lies on its own plane, so only the other planes clip it.
+        glDisable(GL_CLIP_DISTANCE0 + axis);
+        m_capProgram.bind();
+        m_capProgram.setUniformValue("uViewProjection", viewProjection);
+        m_capProgram.setUniformValue("uCapOrigin", origin);
+        m_capProgram.setUniformValue("uCapU", u);
+        m_capProgram.setUniformValue("uCapV", v);
+        m_capProgram.setUniformValue("uColor", QVector3D(0.78f, 0.28f, 0.22f));
+        setClipUniforms(m_capProgram);
+        {
+            QOpenGLVertexArrayObject::Binder vaoBinder(&m_capVao);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+        m_capProgram.release();
+        glEnable(GL_CLIP_DISTANCE0 + axis);
+    }
+    glDisable(GL_STENCIL_TEST);
+    if (m_backfaceCulling)
+        glEnable(GL_CULL_FACE);
+}
+
+void GLViewport::dragClipPlane(const QPoint &delta)
+{
+    ClipPlane &plane = m_clipPlanes[m_activeClipPlane];
+    QVector3D min;
+    QVector3D max;
+    if (!m_scene.bounds(&min, &max))
+        return;
+
+    // Move along the plane normal by the mouse motion projected onto the
+    // normal's on-screen direction, so dragging tracks the cursor.
+    const float unit = qMax((max - min).length() * 0.1f, 0.001f);
+    QVector3D origin = (min + max) * 0.5f;
+    origin[m_activeClipPlane] = plane.offset;
+    QVector3D tip = origin;
+    tip[m_activeClipPlane] += unit;
+
+    const QMatrix4x4 viewProjection = m_camera.projectionMatrix() * m_camera.viewMatrix();
+    auto toScreen = [this, &viewProjection](const QVector3D &p) {
+        const QVector3D ndc = viewProjection.map(p);
+        return QVector2D((ndc.x() * 0.5f + 0.5f) * width(), (0.5f - ndc.y() * 0.5f) * height());
+    };
+    const QVector2D axisOnScreen = toScreen(tip) - toScreen(origin);
+    const QVector2D mouse(delta);
+    if (axisOnScreen.lengthSquared() < 4.0f)
+        plane.offset -= mouse.y() * unit * 0.02f;
+    else
+        plane.offset += unit * QVector2D::dotProduct(mouse, axisOnScreen) / axisOnScreen.lengthSquared();
+    emit clipPlaneMoved(m_activeClipPlane, plane.offset);
+}
+
 void GLViewport::mousePressEvent(QMouseEvent *event)
 {
     m_lastMousePos = event->pos();
+    if (event->button() == Qt::LeftButton && (event->modifiers() & Qt::ControlModifier) && m_activeClipPlane >= 0) {
+        m_draggingClipPlane = true;
+        setFocus();
+        return;
+    }
     if (event->button() == Qt::LeftButton)
         m_leftButton = true;
     if (event->button() == Qt::MiddleButton)
@@ -367,7 +998,9 @@ void GLViewport::mousePressEvent(QMouseEvent *event)
 void GLViewport::mouseMoveEvent(QMouseEvent *event)
 {
     const QPoint delta = event->pos() - m_lastMousePos;
-    if (m_leftButton) {
+    if (m_draggingClipPlane) {
+        dragClipPlane(delta);
+    } else if (m_leftButton) {
         m_camera.orbit(delta.x() * kOrbitSpeed, -delta.y() * kOrbitSpeed);
         emit cameraDistanceChanged(m_camera.distance());
     } else if (m_middleButton) {
@@ -385,8 +1018,10 @@ void GLViewport::mouseMoveEvent(QMouseEvent *event)
 
 void GLViewport::mouseReleaseEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton)
+    if (event->button() == Qt::LeftButton) {
         m_leftButton = false;
+        m_draggingClipPlane = false;
+    }
     if (event->button() == Qt::MiddleButton)
         m_middleButton = false;
     if (event->button() == Qt::RightButton)
@@ -466,9 +1101,9 @@ void GLViewport::dragEnterEvent(QDragEnterEvent *event)
 {
     if (event->mimeData()->hasUrls()) {
         const QList<QUrl> urls = event->mimeData()->urls();
-        if (!urls.isEmpty()) {
-            const QString path = urls.first().toLocalFile();
-            if (path.endsWith(QLatin1String(".stl"), Qt::CaseInsensitive)) {
+        for (const QUrl &url : urls) {
+            const QString path = url.toLocalFile();
+            if (QFileInfo(path).isDir() || MeshLoader::canLoad(path)) {
                 event->acceptProposedAction();
                 return;
             }
@@ -488,10 +1123,18 @@ void GLViewport::dropEvent(QDropEvent *event)
         event->ignore();
         return;
     }
-    const QString path = urls.first().toLocalFile();
-    QString error;
-    if (!loadMesh(path, &error) && !error.isEmpty())
-        emit loadFailed(error);
+    QStringList paths;
+    for (const QUrl &url : urls) {
+        if (url.isLocalFile())
+            paths.append(url.toLocalFile());
+    }
+    if (paths.size() == 1 && !QFileInfo(paths.first()).isDir()) {
+        QString error;
+        if (!loadMesh(paths.first(), &error) && !error.isEmpty())
+            emit loadFailed(error);
+    } else if (!paths.isEmpty()) {
+        emit filesDropped(paths);
+    }
     event->acceptProposedAction();
 }
 
@@ -505,13 +1148,14 @@ void GLViewport::updateCameraUniforms(QOpenGLShaderProgram &program, const QMatr
 
 void GLViewport::updateBoundingBoxBuffer()
 {
-    if (!m_mesh.isValid()) {
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid()) {
         m_bboxVertexCount = 0;
         return;
     }
 
-    const QVector3D min = m_mesh.minBounds();
-    const QVector3D max = m_mesh.maxBounds();
+    const QVector3D min = mesh->minBounds();
+    const QVector3D max = mesh->maxBounds();
 
     QVector<QVector3D> vertices = {
         {min.x(), min.y(), min.z()}, {max.x(), min.y(), min.z()},
@@ -556,6 +1200,427 @@ void GLViewport::drawBoundingBox(const QMatrix4x4 &mvp, const QVector3D &color)
     glDrawArrays(GL_LINES, 0, m_bboxVertexCount);
 }
 
+MeshValidityReport GLViewport::checkMeshValidity()
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid())
+        return MeshValidityReport();
+
+    const MeshValidityReport report = MeshValidity().analyze(mesh->positions(), mesh->indices());
+    m_defectResource = m_scene.instance(m_activeInstance).resource;
+    makeCurrent();
+    uploadDefectHighlight(report);
+    doneCurrent();
+    update();
+    return report;
+}
+
+void GLViewport::setDefectHighlightVisible(bool visible)
+{
+    m_defectsVisible = visible;
+    update();
+}
+
+void GLViewport::uploadDefectHighlight(const MeshValidityReport &report)
+{
+    const QVector<QVector3D> *groups[] = {&report.boundaryLines, &report.nonManifoldLines, &report.windingLines, &report.faceLines};
+    QVector<QVector3D> vertices;
+    m_defectRangeSizes.clear();
+    for (const QVector<QVector3D> *group : groups) {
+        vertices += *group;
+        m_defectRangeSizes.append(group->size());
+    }
+
+    if (!m_defectVao.isCreated())
+        m_defectVao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_defectVao);
+
+    if (!m_defectVbo.isCreated())
+        m_defectVbo.create();
+    m_defectVbo.bind();
+    m_defectVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_defectVbo.allocate(vertices.constData(), static_cast<int>(vertices.size() * sizeof(QVector3D)));
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), nullptr);
+}
+
+void GLViewport::clearDefectHighlight()
+{
+    m_defectRangeSizes.clear();
+    m_defectResource = -1;
+    if (m_defectVbo.isCreated())
+        m_defectVbo.destroy();
+}
+
+void GLViewport::drawDefectHighlight(const QMatrix4x4 &mvp)
+{
+    if (!m_defectsVisible || m_defectRangeSizes.isEmpty() || m_scene.instance(m_activeInstance).resource != m_defectResource)
+        return;
+
+    // Boundary, non-manifold, winding, degenerate/duplicate faces.
+    static const QVector3D colors[] = {{1.0f, 0.15f, 0.15f}, {1.0f, 0.2f, 1.0f}, {1.0f, 0.9f, 0.1f}, {1.0f, 0.55f, 0.0f}};
+
+    glDisable(GL_DEPTH_TEST);
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_defectVao);
+    m_colorProgram.setUniformValue("uMvp", mvp);
+    int first = 0;
+    for (int i = 0; i < m_defectRangeSizes.size(); ++i) {
+        if (m_defectRangeSizes.at(i) > 0) {
+            m_colorProgram.setUniformValue("uColor", colors[i]);
+            glDrawArrays(GL_LINES, first, m_defectRangeSizes.at(i));
+        }
+        first += m_defectRangeSizes.at(i);
+    }
+    glEnable(GL_DEPTH_TEST);
+}
+
+void GLViewport::setSliceVisible(bool visible)
+{
+    m_sliceVisible = visible;
+    makeCurrent();
+    updateSliceBuffer();
+    doneCurrent();
+    update();
+}
+
+void GLViewport::setSliceHeight(float z)
+{
+    m_sliceHeight = z;
+    if (!m_sliceVisible)
+        return;
+    makeCurrent();
+    updateSliceBuffer();
+    doneCurrent();
+    update();
+}
+
+bool GLViewport::exportSlices(const QString &path, float layerHeight, QString *errorMessage, const MeshSlicer::ProgressFunction &progress)
+{
+    const MeshSlicer *slicer = activeSlicer();
+    if (!slicer) {
+        if (errorMessage)
+            *errorMessage = tr("No mesh loaded.");
+        return false;
+    }
+    return slicer->writeCli(path, layerHeight, errorMessage, progress);
+}
+
+bool GLViewport::computeWallThickness(const WallThickness::ProgressFunction &progress)
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid())
+        return false;
+
+    const int resourceIndex = m_scene.instance(m_activeInstance).resource;
+    if (m_scene.resource(resourceIndex).bvh.isEmpty()) {
+        // The first measurement of a part spends most of its time here, so
+        // the tree is built on a worker while `progress` keeps the caller
+        // responsive and able to cancel. A cancelled build finishes on its
+        // own copies and is dropped.
+        const QVector<QVector3D> positions = mesh->positions();
+        const QVector<unsigned int> indices = mesh->indices();
+        const auto built = std::make_shared<Bvh>();
+        const QFuture<void> future = QtConcurrent::run([built, positions, indices]() { built->build(positions, indices); });
+        while (!future.isFinished()) {
+            if (progress && !progress(0, 0))
+                return false;
+            QThread::msleep(kWorkerPollMs);
+        }
+        // The callback runs the event loop, which may have replaced the part.
+        mesh = activeMesh();
+        if (!mesh || m_scene.instance(m_activeInstance).resource != resourceIndex || mesh->positions().constData() != positions.constData())
+            return false;
+        m_scene.resource(resourceIndex).bvh = std::move(*built);
+    }
+
+    SceneResource &resource = m_scene.resource(resourceIndex);
+    if (resource.bvh.isEmpty())
+        return false;
+    WallThicknessField field;
+    if (!WallThickness::compute(resource.bvh, resource.mesh.positions(), resource.mesh.normals(), &field, progress))
+        return false;
+
+    resource.thickness = std::move(field);
+    m_scalarView = ScalarView::Thickness;
+    applyScalarView();
+    update();
+    return true;
+}
+
+const WallThicknessField *GLViewport::wallThickness() const
+{
+    if (m_activeInstance < 0)
+        return nullptr;
+    const WallThicknessField &field = m_scene.resource(m_scene.instance(m_activeInstance).resource).thickness;
+    return field.isEmpty() ? nullptr : &field;
+}
+
+void GLViewport::setWallThicknessVisible(bool visible)
+{
+    if (visible)
+        m_scalarView = ScalarView::Thickness;
+    else if (m_scalarView == ScalarView::Thickness)
+        m_scalarView = ScalarView::None;
+    applyScalarView();
+    update();
+}
+
+void GLViewport::setWallThicknessThreshold(float thickness)
+{
+    m_thicknessThreshold = qMax(0.0f, thickness);
+    update();
+}
+
+bool GLViewport::loadReferenceMesh(const QString &path, QString *errorMessage)
+{
+    const MeshBuffer buffer = m_loader.load(path, errorMessage);
+    if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
+        if (errorMessage && errorMessage->isEmpty())
+            *errorMessage = tr("No geometry found in %1").arg(path);
+        return false;
+    }
+
+    makeCurrent();
+    m_referenceMesh.clear();
+    m_referenceMesh.setData(buffer.positions, buffer.normals, buffer.indices, buffer.hasNormals);
+    m_referenceMesh.upload(this);
+    doneCurrent();
+    m_referenceBvh.build(m_referenceMesh.positions(), m_referenceMesh.indices());
+    m_referenceNormals.build(m_referenceMesh.positions(), m_referenceMesh.indices());
+    update();
+    return true;
+}
+
+void GLViewport::clearReferenceMesh()
+{
+    makeCurrent();
+    m_referenceMesh.clear();
+    doneCurrent();
+    m_referenceBvh.clear();
+    m_referenceNormals.clear();
+    // Deviation fields only mean something against their reference.
+    for (int i = 0; i < m_scene.resourceCount(); ++i)
+        m_scene.resource(i).deviation = DeviationField();
+    if (m_scalarView == ScalarView::Deviation)
+        m_scalarView = ScalarView::None;
+    applyScalarView();
+    update();
+}
+
+void GLViewport::setReferenceVisible(bool visible)
+{
+    m_referenceVisible = visible;
+    update();
+}
+
+bool GLViewport::computeDeviation(const MeshDeviation::ProgressFunction &progress)
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid() || m_referenceBvh.isEmpty())
+        return false;
+
+    SceneResource &resource = m_scene.resource(m_scene.instance(m_activeInstance).resource);
+    DeviationField field;
+    if (!MeshDeviation::compute(m_referenceBvh, m_referenceNormals, mesh->positions(), activeTransform().matrix(), &field, progress))
+        return false;
+
+    resource.deviation = std::move(field);
+    m_scalarView = ScalarView::Deviation;
+    applyScalarView();
+    update();
+    return true;
+}
+
+const DeviationField *GLViewport::deviation() const
+{
+    if (m_activeInstance < 0)
+        return nullptr;
+    const DeviationField &field = m_scene.resource(m_scene.instance(m_activeInstance).resource).deviation;
+    return field.isEmpty() ? nullptr : &field;
+}
+
+void GLViewport::setDeviationVisible(bool visible)
+{
+    if (visible)
+        m_scalarView = ScalarView::Deviation;
+    else if (m_scalarView == ScalarView::Deviation)
+        m_scalarView = ScalarView::None;
+    applyScalarView();
+    update();
+}
+
+void GLViewport::setDeviationTolerance(float tolerance)
+{
+    m_deviationTolerance = qMax(0.0f, tolerance);
+    update();
+}
+
+bool GLViewport::alignToReference(AlignmentResult *result)
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid() || m_referenceBvh.isEmpty())
+        return false;
+
+    const ModelTransform current = activeTransform();
+    const AlignmentResult alignment =
+        IcpAlignment::align(m_referenceBvh, m_referenceMesh.positions(), mesh->positions(), current.matrix());
+    if (result)
+        *result = alignment;
+    if (!alignment.valid)
+        return false;
+
+    // correction * T * R * S = (correction * T * R) * S, so the scale stays
+    // innermost and only translation and rotation change.
+    QMatrix4x4 rigid;
+    rigid.translate(current.translation);
+    rigid.rotate(current.rotation.x(), 1.0f, 0.0f, 0.0f);
+    rigid.rotate(current.rotation.y(), 0.0f, 1.0f, 0.0f);
+    rigid.rotate(current.rotation.z(), 0.0f, 0.0f, 1.0f);
+    rigid = alignment.correction * rigid;
+    setModelTransform(rigid.column(3).toVector3D(), eulerAngles(rigid), current.scale);
+    return true;
+}
+
+void GLViewport::applyScalarView()
+{
+    if (m_scene.isEmpty())
+        return;
+
+    // Both analyses share vertex attribute 9; every mesh gets its own field
+    // for the view on show, or none, so no mesh is colored by a field of
+    // the other kind.
+    makeCurrent();
+    for (int i = 0; i < m_scene.resourceCount(); ++i) {
+        SceneResource &resource = m_scene.resource(i);
+        if (!resource.mesh.isValid())
+            continue;
+        const QVector<float> *values = nullptr;
+        if (m_scalarView == ScalarView::Thickness && !resource.thickness.isEmpty())
+            values = &resource.thickness.values;
+        else if (m_scalarView == ScalarView::Deviation && !resource.deviation.isEmpty())
+            values = &resource.deviation.values;
+
+        if (values)
+            resource.mesh.setScalarField(this, *values);
+        else
+            resource.mesh.clearScalarField(this);
+    }
+    doneCurrent();
+}
+
+// The deviation field was measured at the active part's pose; once the part
+// moves it no longer describes anything.
+void GLViewport::invalidateDeviation()
+{
+    if (m_activeInstance < 0)
+        return;
+    SceneResource &resource = m_scene.resource(m_scene.instance(m_activeInstance).resource);
+    if (resource.deviation.isEmpty())
+        return;
+    resource.deviation = DeviationField();
+    applyScalarView();
+}
+
+void GLViewport::drawReference(const QMatrix4x4 &view, const QMatrix4x4 &projection)
+{
+    m_phongProgram.bind();
+    updateCameraUniforms(m_phongProgram, QMatrix4x4(), view, projection);
+    setClipUniforms(m_phongProgram);
+    m_phongProgram.setUniformValue("uLightDirection", m_lightDirection.normalized());
+    m_phongProgram.setUniformValue("uCameraPos", m_camera.position());
+    m_phongProgram.setUniformValue("uBaseColor", QVector3D(0.45f, 0.6f, 0.85f));
+    m_phongProgram.setUniformValue("uUseFaceNormals", m_faceNormals ? 1 : 0);
+    m_phongProgram.setUniformValue("uGamma", kGamma);
+    m_phongProgram.setUniformValue("uAnalysisMode", 0);
+    m_phongProgram.setUniformValue("uScalarMode", 0);
+
+    // Translucent overlay: constant-alpha blending and no depth writes, so the
+    // part stays visible through the reference.
+    glEnable(GL_BLEND);
+    glBlendColor(0.0f, 0.0f, 0.0f, kReferenceOpacity);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    glDepthMask(GL_FALSE);
+    m_referenceMesh.draw(this);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    m_phongProgram.release();
+}
+
+float GLViewport::scalarMax() const
+{
+    float maximum = 0.0f;
+    for (int i = 0; i < m_scene.resourceCount(); ++i) {
+        const SceneResource &resource = m_scene.resource(i);
+        if (m_scalarView == ScalarView::Deviation && !resource.deviation.isEmpty())
+            maximum = qMax(maximum, resource.deviation.p99);
+        else if (m_scalarView == ScalarView::Thickness && !resource.thickness.isEmpty())
+            maximum = qMax(maximum, resource.thickness.maximum);
+    }
+    return maximum;
+}
+
+const MeshSlicer *GLViewport::activeSlicer()
+{
+    const Mesh *mesh = activeMesh();
+    if (!mesh || !mesh->isValid())
+        return nullptr;
+
+    // Built lazily and kept for the active part, so scrubbing only pays
+    // for the per-plane query.
+    const int resource = m_scene.instance(m_activeInstance).resource;
+    if (m_slicerResource != resource) {
+        m_slicer.build(mesh->positions(), mesh->indices());
+        m_slicerResource = resource;
+    }
+    return &m_slicer;
+}
+
+void GLViewport::updateSliceBuffer()
+{
+    m_sliceVertexCount = 0;
+    if (!m_sliceVisible)
+        return;
+    const MeshSlicer *slicer = activeSlicer();
+    if (!slicer)
+        return;
+
+    const SliceLayer layer = slicer->slice(m_sliceHeight);
+    QVector<QVector3D> vertices;
+    for (const SliceContour &contour : layer.contours) {
+        for (qsizetype i = 0; i + 1 < contour.points.size(); ++i) {
+            vertices.append(QVector3D(contour.points.at(i), layer.z));
+            vertices.append(QVector3D(contour.points.at(i + 1), layer.z));
+        }
+    }
+    m_sliceVertexCount = static_cast<int>(vertices.size());
+
+    if (!m_sliceVao.isCreated())
+        m_sliceVao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_sliceVao);
+
+    if (!m_sliceVbo.isCreated())
+        m_sliceVbo.create();
+    m_sliceVbo.bind();
+    m_sliceVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_sliceVbo.allocate(vertices.constData(), static_cast<int>(vertices.size() * sizeof(QVector3D)));
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), nullptr);
+}
+
+void GLViewport::drawSlice(const QMatrix4x4 &mvp)
+{
+    if (!m_sliceVisible || m_sliceVertexCount <= 0)
+        return;
+    glDisable(GL_DEPTH_TEST);
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_sliceVao);
+    m_colorProgram.setUniformValue("uMvp", mvp);
+    m_colorProgram.setUniformValue("uColor", QVector3D(0.2f, 1.0f, 0.4f));
+    glDrawArrays(GL_LINES, 0, m_sliceVertexCount);
+    glEnable(GL_DEPTH_TEST);
+}
+
 void GLViewport::updateFps()
 {
     ++m_frameCounter;
@@ -569,19 +1634,44 @@ void GLViewport::updateFps()
 
 void GLViewport::updateStatistics(const QString &filePath)
 {
+    const Mesh *mesh = activeMesh();
+    if (!mesh)
+        return;
+
     m_loadedFilePath = filePath;
     m_stats.fileName = QFileInfo(filePath).fileName();
-    m_stats.triangleCount = m_mesh.triangleCount();
-    m_stats.minBounds = m_mesh.minBounds();
-    m_stats.maxBounds = m_mesh.maxBounds();
-    m_stats.size = m_mesh.size();
-    m_stats.hasNormals = m_mesh.hasSourceNormals() && !m_recomputeNormals;
+    m_stats.triangleCount = mesh->triangleCount();
+    m_stats.instanceCount = m_scene.instanceCount();
+    m_stats.sceneTriangleCount = m_scene.triangleCount();
+    m_stats.minBounds = mesh->minBounds();
+    m_stats.maxBounds = mesh->maxBounds();
+    m_stats.size = mesh->size();
+    m_stats.hasNormals = mesh->hasSourceNormals() && !m_recomputeNormals;
+    const SceneResource &resource = m_scene.resource(m_scene.instance(m_activeInstance).resource);
+    m_stats.mass = resource.mass;
+    m_stats.acmrBefore = resource.acmrBefore;
+    m_stats.acmrAfter = resource.acmrAfter;
+    updateOverhangArea();
+}
+
+void GLViewport::updateOverhangArea()
+{
+    if (m_activeInstance < 0 || m_stats.fileName.isEmpty())
+        return;
+
+    // Only the histogram bins are re-oriented, so this stays cheap enough to
+    // run on every spin box step.
+    const NormalHistogram &normals = m_scene.resource(m_scene.instance(m_activeInstance).resource).normals;
+    m_stats.overhangThreshold = m_overhangThreshold;
+    m_stats.overhangArea = normals.area(activeTransform().matrix().normalMatrix(), QVector3D(0.0f, -1.0f, 0.0f),
+                                        qSin(qDegreesToRadians(m_overhangThreshold)));
     emit meshInfoChanged(m_stats);
 }
 
 void GLViewport::syncTransformToUi()
 {
-    emit transformChanged(m_translation, m_rotation, m_scale);
+    const ModelTransform transform = activeTransform();
+    emit transformChanged(transform.translation, transform.rotation, transform.scale);
 }
 
 void GLViewport::handleFlyMode(float deltaSeconds)
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "Camera.h"
+#include "FeatureEdges.h"
 #include "GridGizmo.h"
+#include "IcpAlignment.h"
 #include "Mesh.h"
 #include "MeshLoader.h"
 #include "MeshStatistics.h"
+#include "MeshSlicer.h"
+#include "MeshValidity.h"
+#include "STLWriter.h"
+#include "Scene.h"
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
@@ -13,7 +19,9 @@
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLWidget>
 #include <QPointer>
+#include <QThreadPool>
 #include <QTimer>
+#include <QVector4D>
 
 class GLViewport : public QOpenGLWidget, protected QOpenGLFunctions_4_1_Core
 {
@@ -24,14 +32,68 @@ public:
     {
         Shaded = 0,
         Wireframe,
-        ShadedWireframe
+        ShadedWireframe,
+        ShadedFeatureEdges
+    };
+
+    enum class AnalysisMode
+    {
+        None = 0,
+        Overhang,
+        Draft
     };
 
     explicit GLViewport(QWidget *parent = nullptr);
     ~GLViewport() override;
 
     bool loadMesh(const QString &path, QString *errorMessage);
+    bool loadMeshBuffer(const QString &path, const MeshBuffer &buffer, QString *errorMessage);
+    bool addMesh(const QString &path, QString *errorMessage);
+    bool addMeshBuffer(const QString &path, const MeshBuffer &buffer, QString *errorMessage);
+    // Re-reads `path` on a worker thread into every resource loaded from it,
+    // keeping the camera, the instances and their transforms, and reports
+    // through meshReloaded. Analysis results are dropped. A newer reload
+    // supersedes one still in flight.
+    void reloadMesh(const QString &path);
+    void addInstanceCopies(int count);
+    void clearScene();
+    void frameScene();
+    void setActiveInstance(int index);
+    int activeInstance() const { return m_activeInstance; }
+    int instanceCount() const { return m_scene.instanceCount(); }
     bool saveScreenshot(const QString &path);
+    bool saveHighResolutionScreenshot(const QString &path, const QSize &size, QString *errorMessage);
+    bool exportNativeMesh(const QString &path, QString *errorMessage) const;
+    // Writes the active instance as STL with its model transform applied.
+    bool exportStl(const QString &path, STLWriter::Format format, QString *errorMessage, const STLWriter::ProgressFunction &progress) const;
+    MeshValidityReport checkMeshValidity();
+    void setDefectHighlightVisible(bool visible);
+    void setSliceVisible(bool visible);
+    void setSliceHeight(float z);
+    bool exportSlices(const QString &path, float layerHeight, QString *errorMessage, const MeshSlicer::ProgressFunction &progress);
+    // Casts an inward ray from every vertex of the active part and shows the
+    // result as a heatmap. Returns false if `progress` cancelled.
+    bool computeWallThickness(const WallThickness::ProgressFunction &progress);
+    const WallThicknessField *wallThickness() const;
+    void setWallThicknessVisible(bool visible);
+    void setWallThicknessThreshold(float thickness);
+
+    // Reference surface (e.g. nominal CAD) kept in world space beside the
+    // scene, drawn translucent and used for deviation measurements.
+    bool loadReferenceMesh(const QString &path, QString *errorMessage);
+    void clearReferenceMesh();
+    bool hasReferenceMesh() const { return m_referenceMesh.isValid(); }
+    void setReferenceVisible(bool visible);
+    // Signed distance from every vertex of the active instance to the
+    // reference. Returns false if there is nothing to compare or `progress`
+    // cancelled.
+    bool computeDeviation(const MeshDeviation::ProgressFunction &progress);
+    const DeviationField *deviation() const;
+    void setDeviationVisible(bool visible);
+    void setDeviationTolerance(float tolerance);
+    // Registers the active instance to the reference by ICP and writes the
+    // rigid correction into its model transform; scale is left untouched.
+    bool alignToReference(AlignmentResult *result);
 
     void setGridVisible(bool visible);
     void setAxesVisible(bool visible);
@@ -39,16 +101,37 @@ public:
     void setRecomputeNormals(bool enabled);
     void setFaceNormalsEnabled(bool enabled);
     void setShadingMode(ShadingMode mode);
+    // Dihedral angle in degrees above which an edge is drawn in
+    // ShadedFeatureEdges mode; re-extracts the edges of every loaded mesh.
+    void setFeatureEdgeAngle(float degrees);
+
+    // Surface colormaps relative to the build direction (world +Y). Both
+    // thresholds are in degrees; they only touch shader uniforms.
+    void setAnalysisMode(AnalysisMode mode);
+    void setOverhangThreshold(float degrees);
+    void setDraftThreshold(float degrees);
 
     void setModelTransform(const QVector3D &translation, const QVector3D &rotation, const QVector3D &scale);
     void resetModelTransform();
 
+    // Axis-aligned world-space section planes (0 = X, 1 = Y, 2 = Z). Geometry
+    // beyond the offset along the axis is cut away, or before it if flipped.
+    void setClipPlaneEnabled(int axis, bool enabled);
+    void setClipPlaneFlipped(int axis, bool flipped);
+    void setClipPlaneOffset(int axis, float offset);
+    void setSectionCapsEnabled(bool enabled);
+
 signals:
     void meshInfoChanged(const MeshStatistics &stats);
     void loadFailed(const QString &message);
     void cameraDistanceChanged(float distance);
     void fpsChanged(float fps);
     void transformChanged(const QVector3D &translation, const QVector3D &rotation, const QVector3D &scale);
+    void sceneChanged(int instanceCount, int activeInstance);
+    void filesDropped(const QStringList &paths);
+    void clipPlaneMoved(int axis, float offset);
+    // `errorMessage` is empty when the reload succeeded.
+    void meshReloaded(const QString &path, const QString &errorMessage);
 
 protected:
     void initializeGL() override;
@@ -65,17 +148,46 @@ protected:
     void dropEvent(QDropEvent *event) override;
 
 private:
+    void renderScene(const QMatrix4x4 &view, const QMatrix4x4 &projection);
+    Mesh *activeMesh();
+    const Mesh *activeMesh() const;
+    ModelTransform activeTransform() const;
+    int addMeshResource(const QString &path, const MeshBuffer &buffer);
+    void setResourceGeometry(int resource, const MeshBuffer &buffer);
+    bool applyReload(const QString &path, const MeshBuffer &buffer, QString *errorMessage);
+    void focusCameraOnActive();
     void updateCameraUniforms(QOpenGLShaderProgram &program, const QMatrix4x4 &modelMatrix, const QMatrix4x4 &view, const QMatrix4x4 &projection);
     void updateBoundingBoxBuffer();
     void drawBoundingBox(const QMatrix4x4 &mvp, const QVector3D &color);
+    void uploadDefectHighlight(const MeshValidityReport &report);
+    void clearDefectHighlight();
+    void drawDefectHighlight(const QMatrix4x4 &mvp);
+    bool anyClipPlaneEnabled() const;
+    QVector4D clipPlaneEquation(int axis) const;
+    void setClipUniforms(QOpenGLShaderProgram &program);
+    void setClipDistancesEnabled(bool enabled);
+    void drawSectionCaps(const QMatrix4x4 &viewProjection);
+    void dragClipPlane(const QPoint &delta);
+    const MeshSlicer *activeSlicer();
+    // Largest value of the shown scalar view over all parts.
+    float scalarMax() const;
+    void applyScalarView();
+    void invalidateDeviation();
+    void drawReference(const QMatrix4x4 &view, const QMatrix4x4 &projection);
+    void updateSliceBuffer();
+    void drawSlice(const QMatrix4x4 &mvp);
     void updateFps();
     void updateStatistics(const QString &filePath);
+    void updateOverhangArea();
     void syncTransformToUi();
     void handleFlyMode(float deltaSeconds);
     void updateLightDirection();
 
     MeshLoader m_loader;
-    Mesh m_mesh;
+    QThreadPool m_reloadPool;
+    int m_reloadGeneration = 0;
+    Scene m_scene;
+    int m_activeInstance = -1;
     MeshStatistics m_stats;
     QString m_loadedFilePath;
 
@@ -88,18 +200,63 @@ private:
     bool m_recomputeNormals = false;
     bool m_faceNormals = false;
     ShadingMode m_shadingMode = ShadingMode::Shaded;
+    float m_featureEdgeAngle = FeatureEdges::kDefaultAngle;
+    AnalysisMode m_analysisMode = AnalysisMode::None;
+    float m_overhangThreshold = 45.0f;
+    float m_draftThreshold = 3.0f;
+    // Matches uScalarMode in the Phong shader.
+    enum class ScalarView
+    {
+        None = 0,
+        Thickness,
+        Deviation
+    };
+    ScalarView m_scalarView = ScalarView::None;
+    float m_thicknessThreshold = 1.0f;
+    float m_deviationTolerance = 0.1f;
 
-    QVector3D m_translation = QVector3D(0, 0, 0);
-    QVector3D m_rotation = QVector3D(0, 0, 0);
-    QVector3D m_scale = QVector3D(1, 1, 1);
+    Mesh m_referenceMesh;
+    Bvh m_referenceBvh;
+    PseudoNormals m_referenceNormals;
+    bool m_referenceVisible = true;
 
     QOpenGLShaderProgram m_phongProgram;
+    QOpenGLShaderProgram m_phongWireframeProgram; // Phong plus the edge distance geometry shader
     QOpenGLShaderProgram m_colorProgram;
+    QOpenGLShaderProgram m_wireProgram;
+    QOpenGLShaderProgram m_capProgram;
 
     QOpenGLBuffer m_bboxVbo;
     QOpenGLVertexArrayObject m_bboxVao;
     int m_bboxVertexCount = 0;
 
+    QOpenGLBuffer m_defectVbo;
+    QOpenGLVertexArrayObject m_defectVao;
+    QVector<int> m_defectRangeSizes;
+    int m_defectResource = -1;
+    bool m_defectsVisible = true;
+
+    struct ClipPlane
+    {
+        bool enabled = false;
+        bool flipped = false;
+        bool placed = false;
+        float offset = 0.0f;
+    };
+    ClipPlane m_clipPlanes[3];
+    int m_activeClipPlane = -1;
+    bool m_sectionCaps = true;
+    bool m_draggingClipPlane = false;
+    QOpenGLVertexArrayObject m_capVao;
+
+    MeshSlicer m_slicer;
+    int m_slicerResource = -1;
+    bool m_sliceVisible = false;
+    float m_sliceHeight = 0.0f;
+    QOpenGLBuffer m_sliceVbo;
+    QOpenGLVertexArrayObject m_sliceVao;
+    int m_sliceVertexCount = 0;
+
     QTimer m_updateTimer;
     QElapsedTimer m_elapsedTimer;
     QElapsedTimer m_fpsTimer;
@@ -0,0 +1,366 @@
+#include "IcpAlignment.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+constexpr int kCoarseSamples = 2000;
+constexpr int kCoarseIterations = 10;
+
+struct Rigid
+{
+    double r[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    double t[3] = {0, 0, 0};
+
+    QVector3D map(const QVector3D &p) const
+    {
+        QVector3D out;
+        for (int row = 0; row < 3; ++row)
+            out[row] = static_cast<float>(r[row][0] * p.x() + r[row][1] * p.y() + r[row][2] * p.z() + t[row]);
+        return out;
+    }
+
+    // this ∘ other
+    Rigid after(const Rigid &other) const
+    {
+        Rigid out;
+        for (int row = 0; row < 3; ++row) {
+            for (int column = 0; column < 3; ++column)
+                out.r[row][column] = r[row][0] * other.r[0][column] + r[row][1] * other.r[1][column] + r[row][2] * other.r[2][column];
+            out.t[row] = r[row][0] * other.t[0] + r[row][1] * other.t[1] + r[row][2] * other.t[2] + t[row];
+        }
+        return out;
+    }
+
+    QMatrix4x4 matrix() const
+    {
+        return QMatrix4x4(static_cast<float>(r[0][0]), static_cast<float>(r[0][1]), static_cast<float>(r[0][2]), static_cast<float>(t[0]),
+                          static_cast<float>(r[1][0]), static_cast<float>(r[1][1]), static_cast<float>(r[1][2]), static_cast<float>(t[1]),
+                          static_cast<float>(r[2][0]), static_cast<float>(r[2][1]), static_cast<float>(r[2][2]), static_cast<float>(t[2]),
+                          0.0f, 0.0f, 0.0f, 1.0f);
+    }
+};
+
+// Cyclic Jacobi rotations for a small symmetric matrix. On return `a` is
+// (nearly) diagonal and the columns of `v` are the eigenvectors.
+template <int N>
+void jacobiEigen(double a[N][N], double v[N][N])
+{
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j)
+            v[i][j] = i == j ? 1.0 : 0.0;
+    }
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double offDiagonal = 0.0;
+        for (int p = 0; p < N; ++p) {
+            for (int q = p + 1; q < N; ++q)
+                offDiagonal += a[p][q] * a[p][q];
+        }
+        if (offDiagonal < 1.0e-30)
+            return;
+
+        for (int p = 0; p < N; ++p) {
+            for (int q = p + 1; q < N; ++q) {
+                if (std::abs(a[p][q]) < 1.0e-300)
+                    continue;
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (int k = 0; k < N; ++k) {
+                    const double akp = a[k][p];
+                    const double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < N; ++k) {
+                    const double apk = a[p][k];
+                    const double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < N; ++k) {
+                    const double vkp = v[k][p];
+                    const double vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+struct Moments
+{
+    double centroid[3] = {0, 0, 0};
+    double covariance[3][3] = {};
+};
+
+Moments moments(const QVector<QVector3D> &points)
+{
+    Moments m;
+    if (points.isEmpty())
+        return m;
+    for (const QVector3D &p : points) {
+        for (int i = 0; i < 3; ++i)
+            m.centroid[i] += p[i];
+    }
+    for (double &c : m.centroid)
+        c /= points.size();
+    for (const QVector3D &p : points) {
+        const double d[3] = {p.x() - m.centroid[0], p.y() - m.centroid[1], p.z() - m.centroid[2]};
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j)
+                m.covariance[i][j] += d[i] * d[j];
+        }
+    }
+    return m;
+}
+
+// Principal axes as matrix columns, sorted by decreasing variance.
+void principalAxes(const Moments &m, double axes[3][3])
+{
+    double a[3][3];
+    double v[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j)
+            a[i][j] = m.covariance[i][j];
+    }
+    jacobiEigen<3>(a, v);
+    int order[3] = {0, 1, 2};
+    std::sort(order, order + 3, [&a](int x, int y) { return a[x][x] > a[y][y]; });
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column)
+            axes[row][column] = v[row][order[column]];
+    }
+    // Keep a right-handed frame.
+    const double det = axes[0][0] * (axes[1][1] * axes[2][2] - axes[1][2] * axes[2][1]) -
+                       axes[0][1] * (axes[1][0] * axes[2][2] - axes[1][2] * axes[2][0]) +
+                       axes[0][2] * (axes[1][0] * axes[2][1] - axes[1][1] * axes[2][0]);
+    if (det < 0.0) {
+        for (int row = 0; row < 3; ++row)
+            axes[row][2] = -axes[row][2];
+    }
+}
+
+// Cholesky solve of a 6x6 system given by its lower triangle. Fails when
+// the system is degenerate (e.g. all samples on one plane).
+bool solveSymmetric(double a[6][6], const double b[6], double x[6])
+{
+    double l[6][6] = {};
+    for (int r = 0; r < 6; ++r) {
+        for (int c = 0; c <= r; ++c) {
+            double sum = a[r][c];
+            for (int k = 0; k < c; ++k)
+                sum -= l[r][k] * l[c][k];
+            if (r == c) {
+                if (sum <= 1.0e-12 * qMax(a[r][r], 1.0e-300))
+                    return false;
+                l[r][r] = std::sqrt(sum);
+            } else {
+                l[r][c] = sum / l[c][c];
+            }
+        }
+    }
+    double y[6];
+    for (int r = 0; r < 6; ++r) {
+        double sum = b[r];
+        for (int k = 0; k < r; ++k)
+            sum -= l[r][k] * y[k];
+        y[r] = sum / l[r][r];
+    }
+    for (int r = 5; r >= 0; --r) {
+        double sum = y[r];
+        for (int k = r + 1; k < 6; ++k)
+            sum -= l[k][r] * x[k];
+        x[r] = sum / l[r][r];
+    }
+    return true;
+}
+
+// Exact rotation for the rotation vector (x, y, z), so the pose stays
+// orthonormal however large the linearized step was.
+Rigid rotation(double x, double y, double z)
+{
+    Rigid out;
+    const double angle = std::sqrt(x * x + y * y + z * z);
+    if (angle < 1.0e-15)
+        return out;
+    const double axis[3] = {x / angle, y / angle, z / angle};
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    const double t = 1.0 - c;
+    out.r[0][0] = c + axis[0] * axis[0] * t;
+    out.r[0][1] = axis[0] * axis[1] * t - axis[2] * s;
+    out.r[0][2] = axis[0] * axis[2] * t + axis[1] * s;
+    out.r[1][0] = axis[1] * axis[0] * t + axis[2] * s;
+    out.r[1][1] = c + axis[1] * axis[1] * t;
+    out.r[1][2] = axis[1] * axis[2] * t - axis[0] * s;
+    out.r[2][0] = axis[2] * axis[0] * t - axis[1] * s;
+    out.r[2][1] = axis[2] * axis[1] * t + axis[0] * s;
+    out.r[2][2] = c + axis[2] * axis[2] * t;
+    return out;
+}
+
+QVector<QVector3D> subsample(const QVector<QVector3D> &positions, const QMatrix4x4 &transform, int count)
+{
+    const qsizetype total = positions.size();
+    const qsizetype samples = qMin<qsizetype>(total, qMax(count, 1));
+    QVector<QVector3D> points(samples);
+    Parallel::forEach(samples, [&](qsizetype i) { points[i] = transform.map(positions.at(i * total / samples)); });
+    return points;
+}
+
+// Runs ICP on `points` starting from `*pose`. Returns the RMS of the
+// accepted pairs at the final pose.
+double refine(const Bvh &reference, const QVector<QVector3D> &points, Rigid *pose, int maxIterations, double tolerance, int *iterations, bool *converged)
+{
+    // Below this the residual is float noise and its changes mean nothing.
+    const double noiseFloor = 1.0e-6 * (reference.maxBounds() - reference.minBounds()).length();
+    const qsizetype count = points.size();
+    QVector<QVector3D> moved(count);
+    QVector<QVector3D> targets(count);
+    QVector<QVector3D> normals(count);
+    QVector<float> distances(count);
+    double previousRms = std::numeric_limits<double>::max();
+    double rms = previousRms;
+    *converged = false;
+
+    for (int iteration = 0; iteration < maxIterations; ++iteration) {
+        *iterations = iteration + 1;
+        Parallel::forEach(
+            count,
+            [&](qsizetype i) {
+                moved[i] = pose->map(points.at(i));
+                Bvh::Closest closest;
+                if (reference.closestPoint(moved.at(i), std::numeric_limits<float>::max(), &closest)) {
+                    targets[i] = closest.point;
+                    normals[i] = closest.normal;
+                    distances[i] = closest.distance;
+                } else {
+                    distances[i] = -1.0f;
+                }
+            },
+            256);
+
+        QVector<float> sorted = distances;
+        const qsizetype middle = sorted.size() / 2;
+        std::nth_element(sorted.begin(), sorted.begin() + middle, sorted.end());
+        const float cutoff = qMax(sorted.at(middle) * 3.0f, 1.0e-12f);
+
+        qsizetype accepted = 0;
+        double sumSquares = 0.0;
+        double center[3] = {0, 0, 0};
+        for (qsizetype i = 0; i < count; ++i) {
+            if (distances.at(i) < 0.0f || distances.at(i) > cutoff)
+                continue;
+            for (int k = 0; k < 3; ++k)
+                center[k] += moved.at(i)[k];
+            sumSquares += static_cast<double>(distances.at(i)) * distances.at(i);
+            ++accepted;
+        }
+        if (accepted < 6)
+            return rms;
+        rms = std::sqrt(sumSquares / accepted);
+        if (rms <= noiseFloor || std::abs(previousRms - rms) <= tolerance * previousRms) {
+            *converged = true;
+            return rms;
+        }
+        previousRms = rms;
+        for (double &c : center)
+            c /= accepted;
+
+        // Point-to-plane step, linearized for a small rotation w about the
+        // centroid plus a translation: minimize sum ((w x p + t + p - q) . n)^2.
+        double ata[6][6] = {};
+        double atb[6] = {};
+        for (qsizetype i = 0; i < count; ++i) {
+            if (distances.at(i) < 0.0f || distances.at(i) > cutoff)
+                continue;
+            const QVector3D &normal = normals.at(i);
+            const double p[3] = {moved.at(i).x() - center[0], moved.at(i).y() - center[1], moved.at(i).z() - center[2]};
+            const double n[3] = {normal.x(), normal.y(), normal.z()};
+            const double row[6] = {p[1] * n[2] - p[2] * n[1], p[2] * n[0] - p[0] * n[2], p[0] * n[1] - p[1] * n[0], n[0], n[1], n[2]};
+            const double residual = -QVector3D::dotProduct(moved.at(i) - targets.at(i), normal);
+            for (int r = 0; r < 6; ++r) {
+                for (int c = 0; c <= r; ++c)
+                    ata[r][c] += row[r] * row[c];
+                atb[r] += row[r] * residual;
+            }
+        }
+        double x[6];
+        if (!solveSymmetric(ata, atb, x))
+            return rms;
+
+        Rigid step = rotation(x[0], x[1], x[2]);
+        for (int row = 0; row < 3; ++row)
+            step.t[row] = center[row] + x[3 + row] - (step.r[row][0] * center[0] + step.r[row][1] * center[1] + step.r[row][2] * center[2]);
+        *pose = step.after(*pose);
+    }
+    return rms;
+}
+} // namespace
+
+AlignmentResult IcpAlignment::align(const Bvh &reference,
+                                 const QVector<QVector3D> &referencePositions,
+                                 const QVector<QVector3D> &positions,
+                                 const QMatrix4x4 &initial,
+                                 const AlignmentOptions &options)
+{
+    AlignmentResult result;
+    if (reference.isEmpty() || positions.size() < 3)
+        return result;
+
+    const QVector<QVector3D> points = subsample(positions, initial, options.sampleCount);
+    Rigid pose;
+
+    if (options.coarseAlign && referencePositions.size() >= 3) {
+        // Map the part's principal frame onto the reference's; the axes'
+        // signs are ambiguous, so each proper combination gets a short ICP
+        // run on a smaller subsample and the best one is kept. The incoming
+        // pose competes too: a part already placed by hand must not be
+        // flipped onto a symmetric twin that only ties it.
+        const Moments source = moments(points);
+        const Moments target = moments(subsample(referencePositions, QMatrix4x4(), options.sampleCount));
+        double sourceAxes[3][3];
+        double targetAxes[3][3];
+        principalAxes(source, sourceAxes);
+        principalAxes(target, targetAxes);
+
+        const QVector<QVector3D> coarsePoints = subsample(points, QMatrix4x4(), kCoarseSamples);
+        static const int kSigns[4][3] = {{1, 1, 1}, {-1, -1, 1}, {-1, 1, -1}, {1, -1, -1}};
+        int coarseIterations = 0;
+        bool coarseConverged = false;
+        double bestRms = refine(reference, coarsePoints, &pose, kCoarseIterations, options.tolerance, &coarseIterations, &coarseConverged);
+        for (const auto &signs : kSigns) {
+            Rigid candidate;
+            for (int row = 0; row < 3; ++row) {
+                for (int column = 0; column < 3; ++column) {
+                    double value = 0.0;
+                    for (int k = 0; k < 3; ++k)
+                        value += targetAxes[row][k] * signs[k] * sourceAxes[column][k];
+                    candidate.r[row][column] = value;
+                }
+            }
+            for (int row = 0; row < 3; ++row) {
+                candidate.t[row] = target.centroid[row] - (candidate.r[row][0] * source.centroid[0] + candidate.r[row][1] * source.centroid[1] +
+                                                           candidate.r[row][2] * source.centroid[2]);
+            }
+            int iterations = 0;
+            bool converged = false;
+            const double rms = refine(reference, coarsePoints, &candidate, kCoarseIterations, options.tolerance, &iterations, &converged);
+            if (rms < bestRms) {
+                bestRms = rms;
+                pose = candidate;
+            }
+        }
+    }
+
+    result.rms = refine(reference, points, &pose, qMax(1, options.maxIterations), options.tolerance, &result.iterations, &result.converged);
+    result.correction = pose.matrix();
+    result.valid = true;
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Bvh.h"
+
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+
+struct AlignmentOptions
+{
+    int sampleCount = 10000;
+    int maxIterations = 40;
+    double tolerance = 1.0e-4; // relative RMS change that counts as converged
+    bool coarseAlign = true;
+};
+
+struct AlignmentResult
+{
+    bool valid = false;
+    QMatrix4x4 correction; // rigid world-space transform applied after the initial one
+    double rms = 0.0;
+    int iterations = 0;
+    bool converged = false;
+};
+
+// Rigid point-to-surface registration by iterative closest point. A
+// subsample of the part's vertices is matched to the closest reference
+// points (BVH queries in parallel), the pairs beyond three times the median
+// distance are rejected, and each step solves the linearized point-to-plane
+// problem, which converges in far fewer iterations than point-to-point. An
+// optional coarse stage first aligns centroids and principal axes, trying
+// each proper sign combination against the incoming pose.
+class IcpAlignment
+{
+public:
+    // `initial` places `positions` in the reference frame. The reference
+    // vertices are only used for the coarse stage.
+    static AlignmentResult align(const Bvh &reference,
+                                 const QVector<QVector3D> &referencePositions,
+                                 const QVector<QVector3D> &positions,
+                                 const QMatrix4x4 &initial,
+                                 const AlignmentOptions &options = AlignmentOptions());
+};
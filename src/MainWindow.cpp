@@ -1,5 +1,10 @@
 #include "MainWindow.h"
+#include "BatchLoader.h"
+#include "FeatureEdges.h"
+#include "FileReloadWatcher.h"
 #include "GLViewport.h"
+#include "RecentFilePrefetcher.h"
+#include "ThumbnailRenderer.h"
 
 #include <QAction>
 #include <QAbstractItemView>
@@ -13,6 +18,8 @@
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFormLayout>
+#include <QGridLayout>
+#include <QInputDialog>
 #include <QLabel>
 #include <QLayout>
 #include <QListWidget>
@@ -21,8 +28,11 @@
 #include <QProgressDialog>
 #include <QPushButton>
 #include <QSettings>
+#include <QSlider>
+#include <QSpinBox>
 #include <QStatusBar>
 #include <QStringList>
+#include <QTimer>
 #include <QToolBar>
 #include <QVBoxLayout>
 #include <QObject>
@@ -30,6 +40,11 @@
 namespace
 {
 constexpr int kMaxRecentFiles = 5;
+constexpr int kPrefetchStartupDelayMs = 1500;
+constexpr int kDefaultPrefetchBudgetMb = 512;
+constexpr int kDefaultBatchBudgetMb = 2048;
+constexpr int kSliceSliderSteps = 1000;
+constexpr int kThicknessSliderSteps = 1000;
 
 QDoubleSpinBox *createSpinBox(double min, double max, double step)
 {
@@ -46,15 +61,22 @@ QDoubleSpinBox *createSpinBox(double min, double max, double step)
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
+    m_prefetcher = new RecentFilePrefetcher(&m_meshCache, this);
+    m_batchLoader = new BatchLoader(this);
+    m_reloadWatcher = new FileReloadWatcher(this);
+    connect(m_reloadWatcher, &FileReloadWatcher::fileChanged, this, &MainWindow::reloadChangedFile);
     createUi();
     readSettings();
     populateRecentFiles();
     statusBar()->showMessage(tr("LMB orbit • MMB pan • Wheel zoom • F toggles fly mode"));
+    QTimer::singleShot(kPrefetchStartupDelayMs, this, [this]() { prefetchRecentFiles(); });
 }
 
 MainWindow::~MainWindow()
 {
     writeSettings();
+    delete m_prefetcher;
+    m_prefetcher = nullptr;
 }
 
 void MainWindow::createUi()
@@ -77,6 +99,20 @@ void MainWindow::createUi()
     connect(m_viewport, &GLViewport::cameraDistanceChanged, this, &MainWindow::updateCameraStatus);
     connect(m_viewport, &GLViewport::fpsChanged, this, &MainWindow::updateFps);
     connect(m_viewport, &GLViewport::loadFailed, this, &MainWindow::handleLoadFailure);
+    connect(m_viewport, &GLViewport::sceneChanged, this, &MainWindow::updateSceneControls);
+    connect(m_viewport, &GLViewport::filesDropped, this, &MainWindow::loadFiles);
+    connect(m_viewport, &GLViewport::meshReloaded, this, &MainWindow::meshReloaded);
+
+    connect(m_batchLoader, &BatchLoader::meshLoaded, this, [this](const QString &path, const MeshBuffer &buffer) {
+        QString errorMessage;
+        if (!m_viewport->addMeshBuffer(path, buffer, &errorMessage))
+            m_batchErrors.append(tr("%1: %2").arg(QFileInfo(path).fileName(), errorMessage));
+    });
+    connect(m_batchLoader, &BatchLoader::loadFailed, this, [this](const QString &path, const QString &message) {
+        m_batchErrors.append(tr("%1: %2").arg(QFileInfo(path).fileName(), message));
+    });
+    connect(m_batchLoader, &BatchLoader::progressChanged, this, &MainWindow::updateBatchProgress);
+    connect(m_batchLoader, &BatchLoader::finished, this, &MainWindow::finishBatchLoad);
     connect(m_viewport, &GLViewport::transformChanged, this, [this](const QVector3D &t, const QVector3D &r, const QVector3D &s) {
         m_ignoreTransformSignal = true;
         for (int i = 0; i < 3; ++i) {
@@ -135,10 +171,174 @@ void MainWindow::createDock()
     }
 
     m_shadingCombo = new QComboBox;
-    m_shadingCombo->addItems({tr("Shaded"), tr("Wireframe"), tr("Shaded + Wireframe")});
+    m_shadingCombo->addItems({tr("Shaded"), tr("Wireframe"), tr("Shaded + Wireframe"), tr("Shaded + Feature Edges")});
     layout->addWidget(m_shadingCombo);
     connect(m_shadingCombo, qOverload<int>(&QComboBox::currentIndexChanged), this, &MainWindow::toggleShadingMode);
 
+    auto *edgeWidget = new QWidget;
+    auto *edgeForm = new QFormLayout(edgeWidget);
+    edgeForm->setLabelAlignment(Qt::AlignLeft);
+    m_featureAngleSpin = createSpinBox(1.0, 179.0, 5.0);
+    m_featureAngleSpin->setDecimals(1);
+    m_featureAngleSpin->setValue(FeatureEdges::kDefaultAngle);
+    edgeForm->addRow(tr("Feature edge angle (°)"), m_featureAngleSpin);
+    layout->addWidget(edgeWidget);
+    connect(m_featureAngleSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+        m_viewport->setFeatureEdgeAngle(static_cast<float>(value));
+    });
+
+    auto *analysisLabel = new QLabel(tr("Surface Analysis"));
+    analysisLabel->setStyleSheet("font-weight: bold");
+    layout->addWidget(analysisLabel);
+
+    auto *analysisWidget = new QWidget;
+    auto *analysisForm = new QFormLayout(analysisWidget);
+    analysisForm->setLabelAlignment(Qt::AlignLeft);
+    m_analysisCombo = new QComboBox;
+    m_analysisCombo->addItems({tr("Off"), tr("Overhang"), tr("Draft Angle")});
+    analysisForm->addRow(tr("Colormap"), m_analysisCombo);
+    m_overhangSpin = createSpinBox(0.0, 89.0, 1.0);
+    m_overhangSpin->setValue(45.0);
+    analysisForm->addRow(tr("Overhang (°)"), m_overhangSpin);
+    m_draftSpin = createSpinBox(0.0, 45.0, 0.5);
+    m_draftSpin->setValue(3.0);
+    analysisForm->addRow(tr("Min draft (°)"), m_draftSpin);
+    layout->addWidget(analysisWidget);
+    connect(m_analysisCombo, qOverload<int>(&QComboBox::currentIndexChanged), this, [this](int index) {
+        m_viewport->setAnalysisMode(static_cast<GLViewport::AnalysisMode>(index));
+    });
+    connect(m_overhangSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+        m_viewport->setOverhangThreshold(static_cast<float>(value));
+    });
+    connect(m_draftSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+        m_viewport->setDraftThreshold(static_cast<float>(value));
+    });
+
+    auto *sceneLabel = new QLabel(tr("Scene"));
+    sceneLabel->setStyleSheet("font-weight: bold");
+    layout->addWidget(sceneLabel);
+
+    auto *sceneWidget = new QWidget;
+    auto *sceneForm = new QFormLayout(sceneWidget);
+    sceneForm->setLabelAlignment(Qt::AlignLeft);
+    m_instanceSpin = new QSpinBox;
+    m_instanceSpin->setRange(0, 0);
+    m_instanceSpin->setEnabled(false);
+    sceneForm->addRow(tr("Active instance"), m_instanceSpin);
+    connect(m_instanceSpin, qOverload<int>(&QSpinBox::valueChanged), m_viewport, &GLViewport::setActiveInstance);
+    layout->addWidget(sceneWidget);
+
+    m_copiesButton = new QPushButton(tr("Add Copies…"));
+    m_copiesButton->setEnabled(false);
+    layout->addWidget(m_copiesButton);
+    connect(m_copiesButton, &QPushButton::clicked, this, &MainWindow::addInstanceCopies);
+
+    auto *sliceTitle = new QLabel(tr("Cross-Section"));
+    sliceTitle->setStyleSheet("font-weight: bold");
+    layout->addWidget(sliceTitle);
+
+    m_sliceCheck = new QCheckBox(tr("Show Z Slice"));
+    layout->addWidget(m_sliceCheck);
+    m_sliceSlider = new QSlider(Qt::Horizontal);
+    m_sliceSlider->setRange(0, kSliceSliderSteps);
+    m_sliceSlider->setValue(kSliceSliderSteps / 2);
+    m_sliceSlider->setEnabled(false);
+    layout->addWidget(m_sliceSlider);
+    m_sliceLabel = new QLabel;
+    layout->addWidget(m_sliceLabel);
+    connect(m_sliceCheck, &QCheckBox::toggled, this, [this](bool checked) {
+        m_sliceSlider->setEnabled(checked);
+        m_viewport->setSliceVisible(checked);
+        updateSliceHeight();
+    });
+    connect(m_sliceSlider, &QSlider::valueChanged, this, &MainWindow::updateSliceHeight);
+
+    auto *thicknessTitle = new QLabel(tr("Wall Thickness"));
+    thicknessTitle->setStyleSheet("font-weight: bold");
+    layout->addWidget(thicknessTitle);
+
+    m_thicknessCheck = new QCheckBox(tr("Show Thickness Map"));
+    m_thicknessCheck->setEnabled(false);
+    layout->addWidget(m_thicknessCheck);
+    m_thicknessSlider = new QSlider(Qt::Horizontal);
+    m_thicknessSlider->setRange(0, kThicknessSliderSteps);
+    m_thicknessSlider->setValue(kThicknessSliderSteps / 10);
+    m_thicknessSlider->setEnabled(false);
+    layout->addWidget(m_thicknessSlider);
+    m_thicknessLabel = new QLabel;
+    m_thicknessLabel->setWordWrap(true);
+    layout->addWidget(m_thicknessLabel);
+    connect(m_thicknessCheck, &QCheckBox::toggled, m_viewport, &GLViewport::setWallThicknessVisible);
+    connect(m_thicknessSlider, &QSlider::valueChanged, this, &MainWindow::updateThicknessThreshold);
+
+    auto *deviationTitle = new QLabel(tr("Deviation"));
+    deviationTitle->setStyleSheet("font-weight: bold");
+    layout->addWidget(deviationTitle);
+
+    m_referenceCheck = new QCheckBox(tr("Show Reference"));
+    m_referenceCheck->setChecked(true);
+    m_referenceCheck->setEnabled(false);
+    layout->addWidget(m_referenceCheck);
+    m_deviationCheck = new QCheckBox(tr("Show Deviation Map"));
+    m_deviationCheck->setEnabled(false);
+    layout->addWidget(m_deviationCheck);
+    auto *toleranceWidget = new QWidget;
+    auto *toleranceForm = new QFormLayout(toleranceWidget);
+    toleranceForm->setLabelAlignment(Qt::AlignLeft);
+    m_toleranceSpin = createSpinBox(0.0, 1000.0, 0.01);
+    m_toleranceSpin->setValue(0.1);
+    toleranceForm->addRow(tr("Tolerance (mm)"), m_toleranceSpin);
+    layout->addWidget(toleranceWidget);
+    m_deviationLabel = new QLabel;
+    m_deviationLabel->setWordWrap(true);
+    m_deviationLabel->setTextFormat(Qt::RichText);
+    layout->addWidget(m_deviationLabel);
+    connect(m_referenceCheck, &QCheckBox::toggled, m_viewport, &GLViewport::setReferenceVisible);
+    connect(m_deviationCheck, &QCheckBox::toggled, m_viewport, &GLViewport::setDeviationVisible);
+    connect(m_toleranceSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+        m_viewport->setDeviationTolerance(static_cast<float>(value));
+    });
+    // Both maps share one vertex attribute, so only one can be shown.
+    connect(m_thicknessCheck, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked)
+            m_deviationCheck->setChecked(false);
+    });
+    connect(m_deviationCheck, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked)
+            m_thicknessCheck->setChecked(false);
+    });
+
+    auto *sectionLabel = new QLabel(tr("Section View"));
+    sectionLabel->setStyleSheet("font-weight: bold");
+    layout->addWidget(sectionLabel);
+
+    auto *sectionWidget = new QWidget;
+    auto *sectionGrid = new QGridLayout(sectionWidget);
+    sectionGrid->setContentsMargins(0, 0, 0, 0);
+    const QString clipAxes[3] = {tr("X"), tr("Y"), tr("Z")};
+    for (int axis = 0; axis < 3; ++axis) {
+        m_clipCheck[axis] = new QCheckBox(tr("Clip %1").arg(clipAxes[axis]));
+        m_clipOffset[axis] = createSpinBox(-10000.0, 10000.0, 1.0);
+        m_clipFlip[axis] = new QCheckBox(tr("Flip"));
+        sectionGrid->addWidget(m_clipCheck[axis], axis, 0);
+        sectionGrid->addWidget(m_clipOffset[axis], axis, 1);
+        sectionGrid->addWidget(m_clipFlip[axis], axis, 2);
+        connect(m_clipCheck[axis], &QCheckBox::toggled, this, [this, axis](bool checked) { m_viewport->setClipPlaneEnabled(axis, checked); });
+        connect(m_clipFlip[axis], &QCheckBox::toggled, this, [this, axis](bool checked) { m_viewport->setClipPlaneFlipped(axis, checked); });
+        connect(m_clipOffset[axis], qOverload<double>(&QDoubleSpinBox::valueChanged), this, [this, axis](double value) {
+            m_viewport->setClipPlaneOffset(axis, static_cast<float>(value));
+        });
+    }
+    layout->addWidget(sectionWidget);
+    m_capsCheck = new QCheckBox(tr("Fill Section Caps"));
+    m_capsCheck->setChecked(true);
+    layout->addWidget(m_capsCheck);
+    connect(m_capsCheck, &QCheckBox::toggled, m_viewport, &GLViewport::setSectionCapsEnabled);
+    connect(m_viewport, &GLViewport::clipPlaneMoved, this, [this](int axis, float offset) {
+        const QSignalBlocker blocker(m_clipOffset[axis]);
+        m_clipOffset[axis]->setValue(offset);
+    });
+
     auto *transformLabel = new QLabel(tr("Transform"));
     transformLabel->setStyleSheet("font-weight: bold");
     layout->addWidget(transformLabel);
@@ -182,6 +382,8 @@ void MainWindow::createMenus()
     auto *fileMenu = menuBar()->addMenu(tr("&File"));
 
     m_openAction = fileMenu->addAction(tr("&Open…"), this, &MainWindow::openFileDialog, QKeySequence::Open);
+    fileMenu->addAction(tr("Open &Folder…"), this, &MainWindow::openFolderDialog);
+    fileMenu->addAction(tr("&Add to Scene…"), this, &MainWindow::addToSceneDialog);
     m_recentMenu = fileMenu->addMenu(tr("Recent Files"));
     for (int i = 0; i < kMaxRecentFiles; ++i) {
         auto *action = new QAction(this);
@@ -193,21 +395,158 @@ void MainWindow::createMenus()
     fileMenu->addSeparator();
 
     m_screenshotAction = fileMenu->addAction(tr("Save Screenshot"), this, &MainWindow::saveScreenshot);
+    fileMenu->addAction(tr("Save High-Resolution Screenshot…"), this, &MainWindow::saveHighResolutionScreenshot);
+    fileMenu->addAction(tr("Export &STL…"), this, &MainWindow::exportStl);
+    m_exportNativeAction = fileMenu->addAction(tr("Export Compressed Mesh…"), this, &MainWindow::exportNativeMesh);
+    fileMenu->addAction(tr("Generate Thumbnails…"), this, &MainWindow::generateThumbnails);
+
+    fileMenu->addSeparator();
+    m_prefetchAction = fileMenu->addAction(tr("Prefetch Recent Files"));
+    m_prefetchAction->setCheckable(true);
+    connect(m_prefetchAction, &QAction::toggled, this, &MainWindow::setPrefetchEnabled);
+    m_autoReloadAction = fileMenu->addAction(tr("Auto-&Reload on Change"));
+    m_autoReloadAction->setCheckable(true);
+    connect(m_autoReloadAction, &QAction::toggled, this, &MainWindow::setAutoReloadEnabled);
 
     fileMenu->addSeparator();
     fileMenu->addAction(tr("E&xit"), this, &QWidget::close, QKeySequence::Quit);
+
+    auto *analyzeMenu = menuBar()->addMenu(tr("&Analyze"));
+    analyzeMenu->addAction(tr("Check Mesh &Validity"), this, &MainWindow::checkMeshValidity);
+    m_highlightDefectsAction = analyzeMenu->addAction(tr("Highlight Defects"));
+    m_highlightDefectsAction->setCheckable(true);
+    m_highlightDefectsAction->setChecked(true);
+    connect(m_highlightDefectsAction, &QAction::toggled, m_viewport, &GLViewport::setDefectHighlightVisible);
+    analyzeMenu->addAction(tr("Compute Wall &Thickness"), this, &MainWindow::computeWallThickness);
+    analyzeMenu->addSeparator();
+    analyzeMenu->addAction(tr("Load &Reference Mesh…"), this, &MainWindow::loadReferenceMesh);
+    m_compareAction = analyzeMenu->addAction(tr("&Compare with Reference"), this, &MainWindow::computeDeviation);
+    m_compareAction->setEnabled(false);
+    m_alignAction = analyzeMenu->addAction(tr("&Align to Reference"), this, &MainWindow::alignToReference);
+    m_alignAction->setEnabled(false);
+    m_clearReferenceAction = analyzeMenu->addAction(tr("Clear Reference"), this, &MainWindow::clearReferenceMesh);
+    m_clearReferenceAction->setEnabled(false);
+    analyzeMenu->addSeparator();
+    analyzeMenu->addAction(tr("Export &Slices…"), this, &MainWindow::exportSlices);
 }
 
 void MainWindow::openFileDialog()
 {
     QSettings settings;
     const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
-    const QString path = QFileDialog::getOpenFileName(this, tr("Open STL"), dir, tr("STL Files (*.stl)"));
+    const QStringList paths = QFileDialog::getOpenFileNames(this, tr("Open STL"), dir, MeshLoader::fileDialogFilter());
+    if (paths.isEmpty())
+        return;
+
+    settings.setValue("lastDirectory", QFileInfo(paths.first()).absolutePath());
+    if (paths.size() == 1)
+        loadFile(paths.first());
+    else
+        loadFiles(paths);
+}
+
+void MainWindow::openFolderDialog()
+{
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString folder = QFileDialog::getExistingDirectory(this, tr("Open Folder"), dir);
+    if (folder.isEmpty())
+        return;
+
+    settings.setValue("lastDirectory", folder);
+    loadFiles({folder});
+}
+
+void MainWindow::loadFiles(const QStringList &paths)
+{
+    const QStringList files = BatchLoader::expandPaths(paths);
+    if (files.isEmpty()) {
+        handleLoadFailure(tr("No mesh files found."));
+        return;
+    }
+
+    m_batchErrors.clear();
+    m_viewport->clearScene();
+    m_currentFilePath.clear();
+    m_reloadWatcher->stop();
+
+    if (!m_batchProgress) {
+        m_batchProgress = new QProgressDialog(this);
+        m_batchProgress->setWindowTitle(tr("Loading Files"));
+        m_batchProgress->setAutoClose(false);
+        m_batchProgress->setAutoReset(false);
+        m_batchProgress->setMinimumDuration(0);
+        connect(m_batchProgress, &QProgressDialog::canceled, this, [this]() {
+            m_batchLoader->cancel();
+            finishBatchLoad();
+        });
+    }
+    m_batchProgress->setRange(0, files.size());
+    m_batchProgress->setValue(0);
+    m_batchProgress->show();
+
+    QSettings settings;
+    m_batchLoader->setMemoryBudget(settings.value("batch/memoryBudgetMB", kDefaultBatchBudgetMb).toLongLong() * 1024 * 1024);
+    m_batchLoader->start(files);
+}
+
+void MainWindow::updateBatchProgress(int finished, int total, quint64 triangles)
+{
+    if (!m_batchProgress)
+        return;
+    m_batchProgress->setMaximum(qMax(1, total));
+    m_batchProgress->setValue(finished);
+    m_batchProgress->setLabelText(tr("Loaded %1 of %2 files\n%3 triangles").arg(finished).arg(total).arg(triangles));
+}
+
+void MainWindow::finishBatchLoad()
+{
+    if (m_batchProgress)
+        m_batchProgress->hide();
+
+    m_viewport->frameScene();
+    setWindowFilePath(QString());
+    statusBar()->showMessage(tr("Loaded %1 models").arg(m_viewport->instanceCount()), 5000);
+
+    if (!m_batchErrors.isEmpty()) {
+        QMessageBox::warning(this, tr("Some files failed to load"), m_batchErrors.join(QLatin1Char('\n')));
+        m_batchErrors.clear();
+    }
+}
+
+void MainWindow::addToSceneDialog()
+{
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString path = QFileDialog::getOpenFileName(this, tr("Add to Scene"), dir, MeshLoader::fileDialogFilter());
     if (path.isEmpty())
         return;
 
     settings.setValue("lastDirectory", QFileInfo(path).absolutePath());
-    loadFile(path);
+    QString errorMessage;
+    if (!m_viewport->addMesh(path, &errorMessage)) {
+        if (!errorMessage.isEmpty())
+            handleLoadFailure(errorMessage);
+        return;
+    }
+    addRecentFile(path);
+}
+
+void MainWindow::addInstanceCopies()
+{
+    bool ok = false;
+    const int count = QInputDialog::getInt(this, tr("Add Copies"), tr("Number of copies:"), 1, 1, 1000, 1, &ok);
+    if (ok)
+        m_viewport->addInstanceCopies(count);
+}
+
+void MainWindow::updateSceneControls(int instanceCount, int activeInstance)
+{
+    const QSignalBlocker blocker(m_instanceSpin);
+    m_instanceSpin->setRange(0, qMax(0, instanceCount - 1));
+    m_instanceSpin->setValue(qMax(0, activeInstance));
+    m_instanceSpin->setEnabled(instanceCount > 1);
+    m_copiesButton->setEnabled(instanceCount > 0);
 }
 
 void MainWindow::openRecentFile()
@@ -232,7 +571,10 @@ void MainWindow::loadFile(const QString &path)
     QApplication::processEvents();
 
     QString errorMessage;
-    if (!m_viewport->loadMesh(path, &errorMessage)) {
+    MeshBuffer cached;
+    const bool loaded = m_meshCache.lookup(path, &cached) ? m_viewport->loadMeshBuffer(path, cached, &errorMessage)
+                                                         : m_viewport->loadMesh(path, &errorMessage);
+    if (!loaded) {
         progress.close();
         if (!errorMessage.isEmpty())
             handleLoadFailure(errorMessage);
@@ -244,12 +586,212 @@ void MainWindow::loadFile(const QString &path)
     m_currentFilePath = path;
     addRecentFile(path);
     refreshModelDetails();
+    if (m_autoReloadAction->isChecked())
+        m_reloadWatcher->watch(path);
 }
 
 void MainWindow::updateMeshInfo(const MeshStatistics &stats)
 {
     m_currentStats = stats;
     refreshModelDetails();
+    updateSliceHeight();
+    updateThicknessThreshold();
+    updateDeviationInfo();
+}
+
+void MainWindow::updateSliceHeight()
+{
+    const float minZ = m_currentStats.minBounds.z();
+    const float maxZ = m_currentStats.maxBounds.z();
+    const float z = minZ + (maxZ - minZ) * static_cast<float>(m_sliceSlider->value()) / kSliceSliderSteps;
+    m_sliceLabel->setText(m_currentStats.fileName.isEmpty() ? QString() : tr("Z: %1 mm").arg(z, 0, 'f', 3));
+    m_viewport->setSliceHeight(z);
+}
+
+void MainWindow::computeWallThickness()
+{
+    if (m_viewport->activeInstance() < 0)
+        return;
+
+    QProgressDialog progress(tr("Measuring wall thickness…"), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.setMinimumDuration(0);
+
+    const bool computed = m_viewport->computeWallThickness([&progress](int done, int total) {
+        progress.setMaximum(total);
+        progress.setValue(done);
+        QApplication::processEvents();
+        return !progress.wasCanceled();
+    });
+    progress.close();
+
+    if (!computed)
+        return;
+    updateThicknessThreshold();
+    m_thicknessCheck->setChecked(true);
+}
+
+void MainWindow::updateThicknessThreshold()
+{
+    const WallThicknessField *field = m_viewport->wallThickness();
+    m_thicknessCheck->setEnabled(field != nullptr);
+    m_thicknessSlider->setEnabled(field != nullptr);
+    if (!field) {
+        m_thicknessLabel->setText(m_currentStats.fileName.isEmpty() ? QString() : tr("Not computed (Analyze → Compute Wall Thickness)"));
+        return;
+    }
+
+    const float threshold = field->maximum * static_cast<float>(m_thicknessSlider->value()) / kThicknessSliderSteps;
+    m_viewport->setWallThicknessThreshold(threshold);
+    m_thicknessLabel->setText(tr("Thinner than %1 mm in red (min %2 mm, %3 rays missed)")
+                                  .arg(threshold, 0, 'f', 3)
+                                  .arg(field->minimum, 0, 'f', 3)
+                                  .arg(field->missCount));
+}
+
+void MainWindow::loadReferenceMesh()
+{
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString path = QFileDialog::getOpenFileName(this, tr("Load Reference Mesh"), dir, MeshLoader::fileDialogFilter());
+    if (path.isEmpty())
+        return;
+
+    QString errorMessage;
+    if (!m_viewport->loadReferenceMesh(path, &errorMessage)) {
+        QMessageBox::warning(this, tr("Load Reference Mesh"), errorMessage);
+        return;
+    }
+    m_referencePath = path;
+    m_referenceCheck->setEnabled(true);
+    m_referenceCheck->setChecked(true);
+    m_compareAction->setEnabled(true);
+    m_alignAction->setEnabled(true);
+    m_clearReferenceAction->setEnabled(true);
+    updateDeviationInfo();
+}
+
+void MainWindow::clearReferenceMesh()
+{
+    m_viewport->clearReferenceMesh();
+    m_referencePath.clear();
+    m_referenceCheck->setEnabled(false);
+    m_compareAction->setEnabled(false);
+    m_alignAction->setEnabled(false);
+    m_clearReferenceAction->setEnabled(false);
+    updateDeviationInfo();
+}
+
+void MainWindow::computeDeviation()
+{
+    if (m_viewport->activeInstance() < 0 || !m_viewport->hasReferenceMesh())
+        return;
+
+    QProgressDialog progress(tr("Comparing with reference…"), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.setMinimumDuration(0);
+
+    const bool computed = m_viewport->computeDeviation([&progress](int done, int total) {
+        progress.setMaximum(total);
+        progress.setValue(done);
+        QApplication::processEvents();
+        return !progress.wasCanceled();
+    });
+    progress.close();
+
+    if (!computed)
+        return;
+    updateDeviationInfo();
+    m_deviationCheck->setChecked(true);
+}
+
+void MainWindow::alignToReference()
+{
+    if (m_viewport->activeInstance() < 0 || !m_viewport->hasReferenceMesh())
+        return;
+
+    const bool hadDeviation = m_viewport->deviation() != nullptr;
+    AlignmentResult result;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool aligned = m_viewport->alignToReference(&result);
+    QApplication::restoreOverrideCursor();
+    if (!aligned) {
+        QMessageBox::warning(this, tr("Align to Reference"), tr("Not enough overlap with the reference to align."));
+        return;
+    }
+    statusBar()->showMessage(tr("Aligned to reference: RMS %1 mm after %2 iterations%3")
+                                 .arg(QString::number(result.rms, 'f', 4))
+                                 .arg(result.iterations)
+                                 .arg(result.converged ? QString() : tr(" (not converged)")),
+                             5000);
+    // The old field was measured at the previous pose.
+    if (hadDeviation)
+        computeDeviation();
+}
+
+void MainWindow::updateDeviationInfo()
+{
+    const DeviationField *field = m_viewport->deviation();
+    m_deviationCheck->setEnabled(field != nullptr);
+    if (!field) {
+        // Without a reference no part can have a field left to show.
+        if (!m_viewport->hasReferenceMesh())
+            m_deviationCheck->setChecked(false);
+        m_deviationLabel->setText(m_viewport->hasReferenceMesh()
+                                      ? tr("Reference: %1<br/>Not compared (Analyze → Compare with Reference)")
+                                            .arg(QFileInfo(m_referencePath).fileName().toHtmlEscaped())
+                                      : QString());
+        return;
+    }
+
+    m_deviationLabel->setText(tr("Reference: %1<br/>Mean: %2 mm (|d| %3 mm)<br/>Min / max: %4 / %5 mm<br/>RMS: %6 mm<br/>"
+                                 "|d| P50 / P90 / P95 / P99: %7 / %8 / %9 / %10 mm")
+                                  .arg(QFileInfo(m_referencePath).fileName().toHtmlEscaped())
+                                  .arg(QString::number(field->mean, 'f', 4))
+                                  .arg(QString::number(field->meanAbsolute, 'f', 4))
+                                  .arg(QString::number(field->minimum, 'f', 4))
+                                  .arg(QString::number(field->maximum, 'f', 4))
+                                  .arg(QString::number(field->rms, 'f', 4))
+                                  .arg(QString::number(field->p50, 'f', 4))
+                                  .arg(QString::number(field->p90, 'f', 4))
+                                  .arg(QString::number(field->p95, 'f', 4))
+                                  .arg(QString::number(field->p99, 'f', 4)));
+}
+
+void MainWindow::exportSlices()
+{
+    if (m_viewport->activeInstance() < 0)
+        return;
+
+    bool ok = false;
+    const double layerHeight = QInputDialog::getDouble(this, tr("Export Slices"), tr("Layer height (mm):"), 0.2, 0.001, 100.0, 3, &ok);
+    if (!ok)
+        return;
+
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString suggested = QDir(dir).filePath(QFileInfo(m_currentFilePath).completeBaseName() + QStringLiteral(".cli"));
+    const QString path = QFileDialog::getSaveFileName(this, tr("Export Slices"), suggested, tr("Common Layer Interface (*.cli)"));
+    if (path.isEmpty())
+        return;
+
+    QProgressDialog progress(tr("Slicing…"), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.setMinimumDuration(0);
+
+    QString errorMessage;
+    const bool exported = m_viewport->exportSlices(path, static_cast<float>(layerHeight), &errorMessage, [&progress](int done, int total) {
+        progress.setMaximum(total);
+        progress.setValue(done);
+        QApplication::processEvents();
+        return !progress.wasCanceled();
+    });
+    progress.close();
+
+    if (exported)
+        statusBar()->showMessage(tr("Exported slices to %1").arg(QDir::toNativeSeparators(path)), 5000);
+    else if (!progress.wasCanceled())
+        QMessageBox::warning(this, tr("Export Slices"), errorMessage);
 }
 
 void MainWindow::refreshModelDetails()
@@ -262,9 +804,12 @@ void MainWindow::refreshModelDetails()
     const QVector3D min = m_currentStats.minBounds;
     const QVector3D max = m_currentStats.maxBounds;
     const QVector3D size = m_currentStats.size;
+    const MassProperties &mass = m_currentStats.mass;
 
-    const QString info = tr(
-        "<b>%1</b><br/>Triangles: %2<br/>Bounds min: (%3, %4, %5) mm<br/>Bounds max: (%6, %7, %8) mm<br/>Size: (%9, %10, %11) mm<br/>Normals: %12")
+    QString info = tr(
+        "<b>%1</b><br/>Triangles: %2<br/>Bounds min: (%3, %4, %5) mm<br/>Bounds max: (%6, %7, %8) mm<br/>Size: (%9, %10, %11) mm<br/>Normals: %12<br/>Scene: %13 instances, %14 triangles<br/>"
+        "Volume: %15 mm³<br/>Surface area: %16 mm²<br/>Centroid: (%17, %18, %19) mm<br/>Inertia (Ixx, Iyy, Izz): (%20, %21, %22) mm⁵<br/>"
+        "Overhang area (&gt; %23°): %24 mm²")
                               .arg(m_currentStats.fileName.toHtmlEscaped())
                               .arg(QString::number(m_currentStats.triangleCount))
                               .arg(QString::number(min.x(), 'f', 2))
@@ -276,7 +821,24 @@ void MainWindow::refreshModelDetails()
                               .arg(QString::number(size.x(), 'f', 2))
                               .arg(QString::number(size.y(), 'f', 2))
                               .arg(QString::number(size.z(), 'f', 2))
-                              .arg(m_currentStats.hasNormals ? tr("Provided") : tr("Generated"));
+                              .arg(m_currentStats.hasNormals ? tr("Provided") : tr("Generated"))
+                              .arg(QString::number(m_currentStats.instanceCount))
+                              .arg(QString::number(m_currentStats.sceneTriangleCount))
+                              .arg(QString::number(mass.volume, 'f', 2) + (mass.volume < 0.0 ? tr(" (inverted)") : QString()))
+                              .arg(QString::number(mass.surfaceArea, 'f', 2))
+                              .arg(mass.valid ? QString::number(mass.centroid.x(), 'f', 2) : QStringLiteral("-"))
+                              .arg(mass.valid ? QString::number(mass.centroid.y(), 'f', 2) : QStringLiteral("-"))
+                              .arg(mass.valid ? QString::number(mass.centroid.z(), 'f', 2) : QStringLiteral("-"))
+                              .arg(QString::number(mass.ixx, 'g', 4))
+                              .arg(QString::number(mass.iyy, 'g', 4))
+                              .arg(QString::number(mass.izz, 'g', 4))
+                              .arg(QString::number(m_currentStats.overhangThreshold, 'f', 1))
+                              .arg(QString::number(m_currentStats.overhangArea, 'f', 2));
+    if (m_currentStats.acmrAfter > 0.0f) {
+        info += tr("<br/>Vertex cache misses per triangle: %1 → %2")
+                    .arg(QString::number(m_currentStats.acmrBefore, 'f', 2))
+                    .arg(QString::number(m_currentStats.acmrAfter, 'f', 2));
+    }
 
     m_infoLabel->setText(info);
 }
@@ -297,7 +859,7 @@ void MainWindow::updateFps(float fps)
 
 void MainWindow::handleLoadFailure(const QString &message)
 {
-    QMessageBox::critical(this, tr("Failed to load STL"), message);
+    QMessageBox::critical(this, tr("Failed to load mesh"), message);
 }
 
 void MainWindow::saveScreenshot()
@@ -310,6 +872,143 @@ void MainWindow::saveScreenshot()
     }
 }
 
+void MainWindow::checkMeshValidity()
+{
+    if (m_viewport->activeInstance() < 0)
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const MeshValidityReport report = m_viewport->checkMeshValidity();
+    QApplication::restoreOverrideCursor();
+
+    const QString summary = tr("<b>%1</b><br/><br/>"
+                               "Boundary edges: %2 (%3 holes)<br/>"
+                               "Non-manifold edges: %4<br/>"
+                               "Inconsistent winding: %5 edges<br/>"
+                               "Degenerate triangles: %6<br/>"
+                               "Duplicate triangles: %7")
+                                .arg(report.isClean() ? tr("Mesh is watertight and consistently oriented.")
+                                                      : report.isWatertight() ? tr("Mesh is watertight but has defects.")
+                                                                              : tr("Mesh is not watertight."))
+                                .arg(QString::number(report.boundaryEdges))
+                                .arg(QString::number(report.holeLoops))
+                                .arg(QString::number(report.nonManifoldEdges))
+                                .arg(QString::number(report.inconsistentEdges))
+                                .arg(QString::number(report.degenerateTriangles))
+                                .arg(QString::number(report.duplicateTriangles));
+    QMessageBox::information(this, tr("Mesh Validity"), summary);
+}
+
+void MainWindow::saveHighResolutionScreenshot()
+{
+    const QStringList widths = {QStringLiteral("3840"), QStringLiteral("7680"), QStringLiteral("11520"), QStringLiteral("15360")};
+    bool ok = false;
+    const QString choice = QInputDialog::getItem(this, tr("High-Resolution Screenshot"), tr("Image width (px):"), widths, 1, true, &ok);
+    const int imageWidth = choice.toInt();
+    if (!ok || imageWidth <= 0)
+        return;
+
+    const QString path = QFileDialog::getSaveFileName(this, tr("Save High-Resolution Screenshot"), QString(), tr("PNG Image (*.png)"));
+    if (path.isEmpty())
+        return;
+
+    const double aspect = static_cast<double>(qMax(1, m_viewport->height())) / qMax(1, m_viewport->width());
+    const QSize size(imageWidth, qMax(1, qRound(imageWidth * aspect)));
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QString errorMessage;
+    const bool saved = m_viewport->saveHighResolutionScreenshot(path, size, &errorMessage);
+    QApplication::restoreOverrideCursor();
+    if (!saved)
+        QMessageBox::warning(this, tr("Screenshot"), errorMessage.isEmpty() ? tr("Failed to save screenshot.") : errorMessage);
+}
+
+void MainWindow::exportNativeMesh()
+{
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString path = QFileDialog::getSaveFileName(this, tr("Export Compressed Mesh"), dir, tr("Compressed Meshes (*.stlvm)"));
+    if (path.isEmpty())
+        return;
+
+    QString errorMessage;
+    if (!m_viewport->exportNativeMesh(path, &errorMessage))
+        QMessageBox::warning(this, tr("Export"), errorMessage.isEmpty() ? tr("Failed to export mesh.") : errorMessage);
+}
+
+void MainWindow::exportStl()
+{
+    if (m_viewport->activeInstance() < 0)
+        return;
+
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString binaryFilter = tr("Binary STL (*.stl)");
+    QString selectedFilter = binaryFilter;
+    const QString path = QFileDialog::getSaveFileName(this, tr("Export STL"), dir, binaryFilter + ";;" + tr("ASCII STL (*.stl)"), &selectedFilter);
+    if (path.isEmpty())
+        return;
+
+    QProgressDialog progress(tr("Exporting STL…"), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.setMinimumDuration(0);
+
+    QString errorMessage;
+    const STLWriter::Format format = selectedFilter == binaryFilter ? STLWriter::Format::Binary : STLWriter::Format::Ascii;
+    const bool exported = m_viewport->exportStl(path, format, &errorMessage, [&progress](int done, int total) {
+        progress.setMaximum(total);
+        progress.setValue(done);
+        QApplication::processEvents();
+        return !progress.wasCanceled();
+    });
+    progress.close();
+
+    if (exported)
+        statusBar()->showMessage(tr("Exported %1").arg(QDir::toNativeSeparators(path)), 5000);
+    else if (!progress.wasCanceled())
+        QMessageBox::warning(this, tr("Export STL"), errorMessage.isEmpty() ? tr("Failed to export mesh.") : errorMessage);
+}
+
+void MainWindow::generateThumbnails()
+{
+    QSettings settings;
+    const QString dir = settings.value("lastDirectory", QDir::homePath()).toString();
+    const QString source = QFileDialog::getExistingDirectory(this, tr("Thumbnail Source Folder"), dir);
+    if (source.isEmpty())
+        return;
+    const QString target = QFileDialog::getExistingDirectory(this, tr("Thumbnail Output Folder"), source);
+    if (target.isEmpty())
+        return;
+
+    const QStringList files = BatchLoader::expandPaths({source});
+    if (files.isEmpty()) {
+        handleLoadFailure(tr("No mesh files found."));
+        return;
+    }
+
+    QProgressDialog progress(tr("Rendering thumbnails…"), tr("Cancel"), 0, files.size(), this);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.setMinimumDuration(0);
+
+    ThumbnailRenderer::Options options;
+    options.outputDirectory = target;
+    options.size = QSize(256, 256);
+
+    ThumbnailRenderer renderer;
+    QStringList errors;
+    const int rendered = renderer.renderFiles(files, options, &errors, [&progress](int done, int total) {
+        progress.setMaximum(total);
+        progress.setValue(done);
+        QApplication::processEvents();
+        return !progress.wasCanceled();
+    });
+    progress.close();
+
+    statusBar()->showMessage(tr("Rendered %1 thumbnails").arg(rendered), 5000);
+    if (!errors.isEmpty())
+        QMessageBox::warning(this, tr("Thumbnails"), errors.mid(0, 20).join(QLatin1Char('\n')));
+}
+
 void MainWindow::updateTransformFromUi()
 {
     if (m_ignoreTransformSignal)
@@ -345,6 +1044,58 @@ void MainWindow::applyRenderToggles()
     m_viewport->setFaceNormalsEnabled(m_faceNormalCheck->isChecked());
 }
 
+void MainWindow::setPrefetchEnabled(bool enabled)
+{
+    if (enabled) {
+        prefetchRecentFiles();
+    } else {
+        m_prefetcher->cancel();
+        m_meshCache.clear();
+    }
+}
+
+void MainWindow::setAutoReloadEnabled(bool enabled)
+{
+    if (enabled)
+        m_reloadWatcher->watch(m_currentFilePath);
+    else
+        m_reloadWatcher->stop();
+}
+
+void MainWindow::reloadChangedFile(const QString &path)
+{
+    if (path != m_currentFilePath)
+        return;
+
+    m_viewport->reloadMesh(path);
+}
+
+void MainWindow::meshReloaded(const QString &path, const QString &errorMessage)
+{
+    if (path != m_currentFilePath)
+        return;
+
+    // A failed reload is usually an export still in progress; the next
+    // write triggers another attempt, so only report it in the status bar.
+    if (!errorMessage.isEmpty()) {
+        statusBar()->showMessage(tr("Reloading %1 failed: %2").arg(QFileInfo(path).fileName(), errorMessage), 5000);
+        return;
+    }
+    refreshModelDetails();
+    statusBar()->showMessage(tr("Reloaded %1").arg(QFileInfo(path).fileName()), 3000);
+}
+
+// `loadedPath` has just been parsed for display; prefetching it again would
+// only repeat that work.
+void MainWindow::prefetchRecentFiles(const QString &loadedPath)
+{
+    if (!m_prefetchAction || !m_prefetchAction->isChecked())
+        return;
+    QStringList files = recentFiles();
+    files.removeAll(loadedPath);
+    m_prefetcher->prefetch(files);
+}
+
 void MainWindow::populateRecentFiles()
 {
     const QStringList files = recentFiles();
@@ -379,6 +1130,7 @@ void MainWindow::addRecentFile(const QString &path)
         files.removeLast();
     setRecentFiles(files);
     populateRecentFiles();
+    prefetchRecentFiles(path);
 }
 
 QStringList MainWindow::recentFiles() const
@@ -405,7 +1157,17 @@ void MainWindow::readSettings()
     m_normalsCheck->setChecked(settings.value("render/recomputeNormals", false).toBool());
     m_faceNormalCheck->setChecked(settings.value("render/faceNormals", false).toBool());
     m_shadingCombo->setCurrentIndex(settings.value("render/shadingMode", 0).toInt());
+    m_featureAngleSpin->setValue(settings.value("render/featureEdgeAngle", FeatureEdges::kDefaultAngle).toDouble());
+    m_analysisCombo->setCurrentIndex(settings.value("analysis/colormap", 0).toInt());
+    m_overhangSpin->setValue(settings.value("analysis/overhangAngle", 45.0).toDouble());
+    m_draftSpin->setValue(settings.value("analysis/draftAngle", 3.0).toDouble());
     applyRenderToggles();
+
+    m_meshCache.setBudget(settings.value("prefetch/memoryBudgetMB", kDefaultPrefetchBudgetMb).toLongLong() * 1024 * 1024);
+    const QSignalBlocker blocker(m_prefetchAction);
+    m_prefetchAction->setChecked(settings.value("prefetch/enabled", false).toBool());
+    m_autoReloadAction->setChecked(settings.value("file/autoReload", false).toBool());
+    m_highlightDefectsAction->setChecked(settings.value("analysis/highlightDefects", true).toBool());
 }
 
 void MainWindow::writeSettings()
@@ -419,6 +1181,14 @@ void MainWindow::writeSettings()
     settings.setValue("render/recomputeNormals", m_normalsCheck->isChecked());
     settings.setValue("render/faceNormals", m_faceNormalCheck->isChecked());
     settings.setValue("render/shadingMode", m_shadingCombo->currentIndex());
+    settings.setValue("render/featureEdgeAngle", m_featureAngleSpin->value());
+    settings.setValue("analysis/highlightDefects", m_highlightDefectsAction->isChecked());
+    settings.setValue("analysis/colormap", m_analysisCombo->currentIndex());
+    settings.setValue("analysis/overhangAngle", m_overhangSpin->value());
+    settings.setValue("analysis/draftAngle", m_draftSpin->value());
+    settings.setValue("prefetch/enabled", m_prefetchAction->isChecked());
+    settings.setValue("file/autoReload", m_autoReloadAction->isChecked());
+    settings.setValue("prefetch/memoryBudgetMB", m_meshCache.budget() / (1024 * 1024));
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
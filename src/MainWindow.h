@@ -4,21 +4,28 @@
 #include <QPointer>
 #include <QVector3D>
 
+#include "MeshCache.h"
 #include "MeshStatistics.h"
 
 class QAction;
 class QLabel;
 class QListWidget;
 class QDoubleSpinBox;
+class QSpinBox;
 class QDockWidget;
 class QMenu;
 class QPushButton;
+class QSlider;
 class QCheckBox;
 class QComboBox;
 class QSettings;
 class QListWidget;
 
+class BatchLoader;
+class FileReloadWatcher;
 class GLViewport;
+class QProgressDialog;
+class RecentFilePrefetcher;
 
 class MainWindow : public QMainWindow
 {
@@ -33,16 +40,42 @@ protected:
 
 private slots:
     void openFileDialog();
+    void openFolderDialog();
+    void loadFiles(const QStringList &paths);
+    void updateBatchProgress(int finished, int total, quint64 triangles);
+    void finishBatchLoad();
+    void addToSceneDialog();
+    void addInstanceCopies();
+    void updateSceneControls(int instanceCount, int activeInstance);
     void openRecentFile();
     void updateMeshInfo(const MeshStatistics &stats);
     void updateCameraStatus(float distance);
     void updateFps(float fps);
     void handleLoadFailure(const QString &message);
     void saveScreenshot();
+    void saveHighResolutionScreenshot();
+    void exportNativeMesh();
+    void exportStl();
+    void generateThumbnails();
+    void checkMeshValidity();
+    void updateSliceHeight();
+    void exportSlices();
+    void computeWallThickness();
+    void updateThicknessThreshold();
+    void loadReferenceMesh();
+    void clearReferenceMesh();
+    void computeDeviation();
+    void alignToReference();
+    void updateDeviationInfo();
     void updateTransformFromUi();
     void resetTransform();
     void toggleShadingMode(int index);
     void applyRenderToggles();
+    void setPrefetchEnabled(bool enabled);
+    void setAutoReloadEnabled(bool enabled);
+    void reloadChangedFile(const QString &path);
+    void meshReloaded(const QString &path, const QString &errorMessage);
+    void prefetchRecentFiles(const QString &loadedPath = QString());
 
 private:
     void createUi();
@@ -62,6 +95,10 @@ private:
 
     QAction *m_openAction = nullptr;
     QAction *m_screenshotAction = nullptr;
+    QAction *m_exportNativeAction = nullptr;
+    QAction *m_prefetchAction = nullptr;
+    QAction *m_autoReloadAction = nullptr;
+    QAction *m_highlightDefectsAction = nullptr;
     QMenu *m_recentMenu = nullptr;
     QList<QAction *> m_recentFileActions;
     QListWidget *m_recentList = nullptr;
@@ -77,11 +114,47 @@ private:
     QCheckBox *m_faceNormalCheck = nullptr;
 
     QComboBox *m_shadingCombo = nullptr;
+    QDoubleSpinBox *m_featureAngleSpin = nullptr;
+    QComboBox *m_analysisCombo = nullptr;
+    QDoubleSpinBox *m_overhangSpin = nullptr;
+    QDoubleSpinBox *m_draftSpin = nullptr;
+
+    QSpinBox *m_instanceSpin = nullptr;
+    QPushButton *m_copiesButton = nullptr;
+
+    QCheckBox *m_sliceCheck = nullptr;
+    QSlider *m_sliceSlider = nullptr;
+    QLabel *m_sliceLabel = nullptr;
+
+    QCheckBox *m_thicknessCheck = nullptr;
+    QSlider *m_thicknessSlider = nullptr;
+    QLabel *m_thicknessLabel = nullptr;
+
+    QCheckBox *m_referenceCheck = nullptr;
+    QCheckBox *m_deviationCheck = nullptr;
+    QDoubleSpinBox *m_toleranceSpin = nullptr;
+    QLabel *m_deviationLabel = nullptr;
+    QAction *m_compareAction = nullptr;
+    QAction *m_alignAction = nullptr;
+    QAction *m_clearReferenceAction = nullptr;
+    QString m_referencePath;
+
+    QCheckBox *m_clipCheck[3] = {nullptr, nullptr, nullptr};
+    QDoubleSpinBox *m_clipOffset[3] = {nullptr, nullptr, nullptr};
+    QCheckBox *m_clipFlip[3] = {nullptr, nullptr, nullptr};
+    QCheckBox *m_capsCheck = nullptr;
 
     QDoubleSpinBox *m_translate[3] = {nullptr, nullptr, nullptr};
     QDoubleSpinBox *m_rotate[3] = {nullptr, nullptr, nullptr};
     QDoubleSpinBox *m_scale[3] = {nullptr, nullptr, nullptr};
 
+    MeshCache m_meshCache;
+    RecentFilePrefetcher *m_prefetcher = nullptr;
+    FileReloadWatcher *m_reloadWatcher = nullptr;
+    BatchLoader *m_batchLoader = nullptr;
+    QProgressDialog *m_batchProgress = nullptr;
+    QStringList m_batchErrors;
+
     MeshStatistics m_currentStats;
     QString m_currentFilePath;
 
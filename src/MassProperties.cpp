@@ -0,0 +1,132 @@
+#include "MassProperties.h"
+#include "Parallel.h"
+
+#include <array>
+#include <cmath>
+
+namespace
+{
+// 6V, 2A, 24·first moments (3), 60·second moments (3), 120·products (3).
+constexpr int kTerms = 11;
+
+// Kahan-compensated sums kept in structure-of-arrays form so the per-term
+// loops vectorize.
+struct Accumulator
+{
+    std::array<double, kTerms> sum{};
+    std::array<double, kTerms> compensation{};
+
+    void add(const std::array<double, kTerms> &terms)
+    {
+        for (int k = 0; k < kTerms; ++k) {
+            const double y = terms[k] - compensation[k];
+            const double t = sum[k] + y;
+            compensation[k] = (t - sum[k]) - y;
+            sum[k] = t;
+        }
+    }
+
+    void merge(const Accumulator &other)
+    {
+        std::array<double, kTerms> terms;
+        for (int k = 0; k < kTerms; ++k)
+            terms[k] = other.sum[k] - other.compensation[k];
+        add(terms);
+    }
+};
+
+// Each triangle spans a tetrahedron with the origin; its signed volume and
+// moments follow from the closed-form polynomial integrals over a simplex.
+void integrateTriangle(const QVector3D &pa, const QVector3D &pb, const QVector3D &pc, const QVector3D &origin, std::array<double, kTerms> &terms)
+{
+    const double ax = pa.x() - origin.x(), ay = pa.y() - origin.y(), az = pa.z() - origin.z();
+    const double bx = pb.x() - origin.x(), by = pb.y() - origin.y(), bz = pb.z() - origin.z();
+    const double cx = pc.x() - origin.x(), cy = pc.y() - origin.y(), cz = pc.z() - origin.z();
+
+    const double ex = bx - ax, ey = by - ay, ez = bz - az;
+    const double fx = cx - ax, fy = cy - ay, fz = cz - az;
+    const double nx = ey * fz - ez * fy;
+    const double ny = ez * fx - ex * fz;
+    const double nz = ex * fy - ey * fx;
+
+    const double v6 = ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+
+    terms[0] = v6;
+    terms[1] = std::sqrt(nx * nx + ny * ny + nz * nz);
+    terms[2] = v6 * (ax + bx + cx);
+    terms[3] = v6 * (ay + by + cy);
+    terms[4] = v6 * (az + bz + cz);
+    terms[5] = v6 * (ax * ax + bx * bx + cx * cx + ax * bx + ax * cx + bx * cx);
+    terms[6] = v6 * (ay * ay + by * by + cy * cy + ay * by + ay * cy + by * cy);
+    terms[7] = v6 * (az * az + bz * bz + cz * cz + az * bz + az * cz + bz * cz);
+    terms[8] = v6 * (2.0 * (ax * ay + bx * by + cx * cy) + ax * by + ay * bx + ax * cy + ay * cx + bx * cy + by * cx);
+    terms[9] = v6 * (2.0 * (ay * az + by * bz + cy * cz) + ay * bz + az * by + ay * cz + az * cy + by * cz + bz * cy);
+    terms[10] = v6 * (2.0 * (ax * az + bx * bz + cx * cz) + ax * bz + az * bx + ax * cz + az * cx + bx * cz + bz * cx);
+}
+} // namespace
+
+MassProperties MassProperties::compute(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices, const QVector3D &origin)
+{
+    MassProperties result;
+    const qsizetype triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || positions.isEmpty())
+        return result;
+
+    const QVector<Parallel::Range> ranges = Parallel::split(triangleCount);
+    QVector<Accumulator> partials(ranges.size());
+    const QVector3D *vertexData = positions.constData();
+    const unsigned int *indexData = indices.constData();
+    const auto vertexCount = static_cast<unsigned int>(positions.size());
+
+    Parallel::forRanges(ranges, [&](const Parallel::Range &range) {
+        Accumulator accumulator;
+        std::array<double, kTerms> terms;
+        for (qsizetype t = range.begin; t < range.end; ++t) {
+            const unsigned int i0 = indexData[t * 3];
+            const unsigned int i1 = indexData[t * 3 + 1];
+            const unsigned int i2 = indexData[t * 3 + 2];
+            if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+                continue;
+            integrateTriangle(vertexData[i0], vertexData[i1], vertexData[i2], origin, terms);
+            accumulator.add(terms);
+        }
+        partials[range.index] = accumulator;
+    });
+
+    // Pairwise combination of the per-chunk partials.
+    for (qsizetype stride = 1; stride < partials.size(); stride *= 2) {
+        for (qsizetype i = 0; i + stride < partials.size(); i += stride * 2)
+            partials[i].merge(partials[i + stride]);
+    }
+    std::array<double, kTerms> total;
+    for (int k = 0; k < kTerms; ++k)
+        total[k] = partials[0].sum[k] - partials[0].compensation[k];
+
+    result.volume = total[0] / 6.0;
+    result.surfaceArea = total[1] / 2.0;
+    if (std::abs(result.volume) <= 1e-12 * qMax(1.0, result.surfaceArea * std::sqrt(result.surfaceArea)))
+        return result;
+
+    const double mx = total[2] / 24.0, my = total[3] / 24.0, mz = total[4] / 24.0;
+    const double cx = mx / result.volume, cy = my / result.volume, cz = mz / result.volume;
+
+    // Second moments about the centroid (parallel axis theorem), then flip
+    // the sign for inverted meshes so the tensor stays positive definite.
+    const double sign = result.volume < 0.0 ? -1.0 : 1.0;
+    const double sxx = sign * (total[5] / 60.0 - result.volume * cx * cx);
+    const double syy = sign * (total[6] / 60.0 - result.volume * cy * cy);
+    const double szz = sign * (total[7] / 60.0 - result.volume * cz * cz);
+    const double sxy = sign * (total[8] / 120.0 - result.volume * cx * cy);
+    const double syz = sign * (total[9] / 120.0 - result.volume * cy * cz);
+    const double sxz = sign * (total[10] / 120.0 - result.volume * cx * cz);
+
+    result.valid = true;
+    result.centroid = origin + QVector3D(static_cast<float>(cx), static_cast<float>(cy), static_cast<float>(cz));
+    result.ixx = syy + szz;
+    result.iyy = sxx + szz;
+    result.izz = sxx + syy;
+    result.ixy = -sxy;
+    result.iyz = -syz;
+    result.ixz = -sxz;
+    return result;
+}
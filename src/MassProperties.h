@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QVector>
+#include <QVector3D>
+
+// Physical properties of a closed triangle mesh, assuming unit density.
+// Lengths are in model units (mm), so volume is mm^3 and inertia mm^5.
+struct MassProperties
+{
+    bool valid = false;
+    // Signed volume from the divergence theorem; negative when the
+    // triangle winding is inverted.
+    double volume = 0.0;
+    double surfaceArea = 0.0;
+    QVector3D centroid;
+    // Inertia tensor about the centroid.
+    double ixx = 0.0;
+    double iyy = 0.0;
+    double izz = 0.0;
+    double ixy = 0.0;
+    double iyz = 0.0;
+    double ixz = 0.0;
+
+    // Integrates every triangle relative to `origin`; passing the bounding
+    // box center keeps the products small and the sums well conditioned.
+    static MassProperties compute(const QVector<QVector3D> &positions,
+                                  const QVector<unsigned int> &indices,
+                                  const QVector3D &origin = QVector3D());
+};
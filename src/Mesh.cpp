@@ -1,11 +1,64 @@
 #include "Mesh.h"
 
+#include <QVector4D>
 #include <QtMath>
 #include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr GLuint kInstanceModelLocation = 2;
+constexpr GLuint kInstanceNormalLocation = 6;
+constexpr GLuint kScalarLocation = 9;
+constexpr float kNoScalar = -1.0e30f;
+constexpr GLuint kColorLocation = 10;
+constexpr GLuint kFaceColorBaseLocation = 11;
+
+struct InstanceData
+{
+    float model[16];
+    float normal[9];
+};
+
+// True unless all eight corners of the box lie beyond one clip plane of
+// `transform`, which maps the box into clip space.
+bool boxInFrustum(const QMatrix4x4 &transform, const QVector3D &minBounds, const QVector3D &maxBounds)
+{
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+    for (int corner = 0; corner < 8; ++corner) {
+        const QVector4D p = transform * QVector4D(corner & 1 ? maxBounds.x() : minBounds.x(), corner & 2 ? maxBounds.y() : minBounds.y(),
+                                                  corner & 4 ? maxBounds.z() : minBounds.z(), 1.0f);
+        outside[0] += p.x() < -p.w();
+        outside[1] += p.x() > p.w();
+        outside[2] += p.y() < -p.w();
+        outside[3] += p.y() > p.w();
+        outside[4] += p.z() < -p.w();
+        outside[5] += p.z() > p.w();
+    }
+    return std::none_of(std::begin(outside), std::end(outside), [](int count) { return count == 8; });
+}
+
+// Overwrites a bound buffer in place (glBufferSubData) when the size is
+// unchanged, e.g. when a re-exported file is reloaded, instead of having
+// the driver reallocate it.
+void fillBuffer(QOpenGLBuffer &buffer, const void *data, int bytes)
+{
+    if (buffer.size() == bytes)
+        buffer.write(0, data, bytes);
+    else
+        buffer.allocate(data, bytes);
+}
+} // namespace
 
 Mesh::Mesh()
     : m_vbo(QOpenGLBuffer::VertexBuffer)
     , m_ebo(QOpenGLBuffer::IndexBuffer)
+    , m_edgeEbo(QOpenGLBuffer::IndexBuffer)
+    , m_instanceVbo(QOpenGLBuffer::VertexBuffer)
+    , m_scalarVbo(QOpenGLBuffer::VertexBuffer)
+    , m_colorVbo(QOpenGLBuffer::VertexBuffer)
+    , m_faceColorBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_faceColorTexture(QOpenGLTexture::TargetBuffer)
 {
 }
 
@@ -20,8 +73,15 @@ void Mesh::clear()
     m_indices.clear();
     m_normals.clear();
     m_originalNormals.clear();
+    m_colors.clear();
+    m_faceColors.clear();
+    m_ranges.clear();
+    m_featureEdges.clear();
     m_hasSourceNormals = false;
     m_uploaded = false;
+    m_instanceTransforms.clear();
+    m_instanceCount = 0;
+    m_hasScalarField = false;
 
     if (m_vao.isCreated())
         m_vao.destroy();
@@ -29,6 +89,18 @@ void Mesh::clear()
         m_vbo.destroy();
     if (m_ebo.isCreated())
         m_ebo.destroy();
+    if (m_edgeEbo.isCreated())
+        m_edgeEbo.destroy();
+    if (m_instanceVbo.isCreated())
+        m_instanceVbo.destroy();
+    if (m_scalarVbo.isCreated())
+        m_scalarVbo.destroy();
+    if (m_colorVbo.isCreated())
+        m_colorVbo.destroy();
+    if (m_faceColorTexture.isCreated())
+        m_faceColorTexture.destroy();
+    if (m_faceColorBuffer.isCreated())
+        m_faceColorBuffer.destroy();
 }
 
 bool Mesh::isValid() const
@@ -45,6 +117,10 @@ void Mesh::setData(const QVector<QVector3D> &positions,
     m_indices = indices;
     m_originalNormals = normals;
     m_normals = normals;
+    m_colors.clear();
+    m_faceColors.clear();
+    m_ranges.clear();
+    m_featureEdges.clear();
     m_hasSourceNormals = hasNormals && normals.size() == positions.size();
 
     if (!m_hasSourceNormals) {
@@ -58,6 +134,76 @@ void Mesh::setData(const QVector<QVector3D> &positions,
     m_uploaded = false;
 }
 
+void Mesh::setColors(const QVector<quint32> &colors)
+{
+    m_colors = colors.size() == m_positions.size() ? colors : QVector<quint32>();
+    m_uploaded = false;
+}
+
+void Mesh::setFaceColors(const QVector<quint16> &colors)
+{
+    m_faceColors = colors.size() == m_indices.size() / 3 ? colors : QVector<quint16>();
+    m_uploaded = false;
+}
+
+void Mesh::setRanges(const QVector<MeshRange> &ranges)
+{
+    m_ranges.clear();
+    // draw() culls range by range, so the ranges must tile the index buffer.
+    qsizetype end = 0;
+    for (const MeshRange &range : ranges) {
+        if (range.firstIndex != end || range.indexCount % 3 != 0)
+            return;
+        end += range.indexCount;
+    }
+    if (end != m_indices.size())
+        return;
+    m_ranges = ranges;
+}
+
+void Mesh::setFeatureEdges(const QVector<unsigned int> &lines)
+{
+    m_featureEdges.clear();
+    if (lines.size() % 2 != 0)
+        return;
+    for (unsigned int index : lines) {
+        if (index >= static_cast<unsigned int>(m_positions.size()))
+            return;
+    }
+    m_featureEdges = lines;
+    m_uploaded = false;
+}
+
+void Mesh::updateFeatureEdges(QOpenGLFunctions_4_1_Core *gl, const QVector<unsigned int> &lines)
+{
+    const bool uploaded = m_uploaded;
+    setFeatureEdges(lines);
+    if (!uploaded || !gl)
+        return;
+
+    // Only the line list changed; the rest of the upload stays valid.
+    m_uploaded = true;
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    uploadFeatureEdges();
+}
+
+// Expects the VAO to be bound.
+void Mesh::uploadFeatureEdges()
+{
+    if (!m_featureEdges.isEmpty()) {
+        if (!m_edgeEbo.isCreated())
+            m_edgeEbo.create();
+        m_edgeEbo.bind();
+        m_edgeEbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        fillBuffer(m_edgeEbo, m_featureEdges.constData(), static_cast<int>(m_featureEdges.size() * sizeof(unsigned int)));
+        // The VAO remembers the last bound index buffer; triangles stay
+        // its default.
+        m_ebo.bind();
+    } else if (m_edgeEbo.isCreated()) {
+        m_edgeEbo.destroy();
+    }
+}
+
 void Mesh::updateBounds()
 {
     if (m_positions.isEmpty()) {
@@ -154,29 +300,193 @@ void Mesh::upload(QOpenGLFunctions_4_1_Core *gl)
         vertexData[i].normal = (i < m_normals.size()) ? m_normals.at(i) : QVector3D(0, 1, 0);
     }
 
-    m_vbo.allocate(vertexData.constData(), vertexData.size() * sizeof(Vertex));
+    fillBuffer(m_vbo, vertexData.constData(), static_cast<int>(vertexData.size() * sizeof(Vertex)));
 
     if (!m_ebo.isCreated())
         m_ebo.create();
     m_ebo.bind();
     m_ebo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_ebo.allocate(m_indices.constData(), m_indices.size() * sizeof(unsigned int));
+    fillBuffer(m_ebo, m_indices.constData(), static_cast<int>(m_indices.size() * sizeof(unsigned int)));
+
+    uploadFeatureEdges();
 
     gl->glEnableVertexAttribArray(0);
     gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, position)));
     gl->glEnableVertexAttribArray(1);
     gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, normal)));
 
+    if (!m_colors.isEmpty()) {
+        if (!m_colorVbo.isCreated())
+            m_colorVbo.create();
+        m_colorVbo.bind();
+        m_colorVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        fillBuffer(m_colorVbo, m_colors.constData(), static_cast<int>(m_colors.size() * sizeof(quint32)));
+        gl->glEnableVertexAttribArray(kColorLocation);
+        gl->glVertexAttribPointer(kColorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(quint32), nullptr);
+    } else if (m_colorVbo.isCreated()) {
+        gl->glDisableVertexAttribArray(kColorLocation);
+        m_colorVbo.destroy();
+    }
+
+    if (!m_faceColors.isEmpty()) {
+        // The texture only views the buffer, so the binding point used for
+        // the upload does not matter.
+        if (!m_faceColorBuffer.isCreated())
+            m_faceColorBuffer.create();
+        m_faceColorBuffer.bind();
+        m_faceColorBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        fillBuffer(m_faceColorBuffer, m_faceColors.constData(), static_cast<int>(m_faceColors.size() * sizeof(quint16)));
+        m_faceColorBuffer.release();
+        if (!m_faceColorTexture.isCreated())
+            m_faceColorTexture.create();
+        m_faceColorTexture.bind();
+        gl->glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, m_faceColorBuffer.bufferId());
+        m_faceColorTexture.release();
+    } else {
+        if (m_faceColorTexture.isCreated())
+            m_faceColorTexture.destroy();
+        if (m_faceColorBuffer.isCreated())
+            m_faceColorBuffer.destroy();
+    }
+
+    uploadInstances(gl);
     m_uploaded = true;
 }
 
-void Mesh::draw(QOpenGLFunctions_4_1_Core *gl) const
+void Mesh::setInstanceTransforms(QOpenGLFunctions_4_1_Core *gl, const QVector<QMatrix4x4> &transforms)
+{
+    m_instanceTransforms = transforms;
+    if (m_uploaded && gl)
+        uploadInstances(gl);
+}
+
+void Mesh::setScalarField(QOpenGLFunctions_4_1_Core *gl, const QVector<float> &values)
+{
+    if (!gl || !m_uploaded || values.size() != m_positions.size())
+        return;
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    if (!m_scalarVbo.isCreated())
+        m_scalarVbo.create();
+    m_scalarVbo.bind();
+    m_scalarVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_scalarVbo.allocate(values.constData(), static_cast<int>(values.size() * sizeof(float)));
+    gl->glEnableVertexAttribArray(kScalarLocation);
+    gl->glVertexAttribPointer(kScalarLocation, 1, GL_FLOAT, GL_FALSE, sizeof(float), nullptr);
+    m_hasScalarField = true;
+}
+
+void Mesh::clearScalarField(QOpenGLFunctions_4_1_Core *gl)
+{
+    if (!m_hasScalarField || !gl)
+        return;
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    gl->glDisableVertexAttribArray(kScalarLocation);
+    m_scalarVbo.destroy();
+    m_hasScalarField = false;
+}
+
+void Mesh::uploadInstances(QOpenGLFunctions_4_1_Core *gl)
+{
+    QVector<QMatrix4x4> transforms = m_instanceTransforms;
+    if (transforms.isEmpty())
+        transforms.append(QMatrix4x4());
+
+    QVector<InstanceData> instanceData(transforms.size());
+    for (int i = 0; i < transforms.size(); ++i) {
+        const QMatrix3x3 normalMatrix = transforms.at(i).normalMatrix();
+        std::memcpy(instanceData[i].model, transforms.at(i).constData(), sizeof(InstanceData::model));
+        std::memcpy(instanceData[i].normal, normalMatrix.constData(), sizeof(InstanceData::normal));
+    }
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    if (!m_instanceVbo.isCreated())
+        m_instanceVbo.create();
+    m_instanceVbo.bind();
+    m_instanceVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_instanceVbo.allocate(instanceData.constData(), instanceData.size() * sizeof(InstanceData));
+
+    for (GLuint column = 0; column < 4; ++column) {
+        const GLuint location = kInstanceModelLocation + column;
+        gl->glEnableVertexAttribArray(location);
+        gl->glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  reinterpret_cast<void *>(offsetof(InstanceData, model) + column * 4 * sizeof(float)));
+        gl->glVertexAttribDivisor(location, 1);
+    }
+    for (GLuint column = 0; column < 3; ++column) {
+        const GLuint location = kInstanceNormalLocation + column;
+        gl->glEnableVertexAttribArray(location);
+        gl->glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  reinterpret_cast<void *>(offsetof(InstanceData, normal) + column * 3 * sizeof(float)));
+        gl->glVertexAttribDivisor(location, 1);
+    }
+
+    m_instanceCount = transforms.size();
+}
+
+void Mesh::draw(QOpenGLFunctions_4_1_Core *gl, const QMatrix4x4 *viewProjection) const
+{
+    if (!m_uploaded || !gl || m_instanceCount <= 0)
+        return;
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(const_cast<QOpenGLVertexArrayObject *>(&m_vao));
+    // The current value of a disabled attribute is context state, so it has
+    // to be reset for every mesh that has no scalar field of its own.
+    if (!m_hasScalarField)
+        gl->glVertexAttrib1f(kScalarLocation, kNoScalar);
+    // Zero alpha tells the shader to use its uniform base color.
+    if (m_colors.isEmpty())
+        gl->glVertexAttrib4f(kColorLocation, 0.0f, 0.0f, 0.0f, 0.0f);
+    if (!m_faceColors.isEmpty()) {
+        gl->glActiveTexture(GL_TEXTURE0 + kFaceColorTextureUnit);
+        const_cast<QOpenGLTexture &>(m_faceColorTexture).bind();
+    }
+
+    // gl_PrimitiveID restarts at zero with every draw call, so the shader
+    // is told the first triangle of each one (plus one; zero means no
+    // facet colors).
+    auto drawIndices = [&](quint32 first, quint32 count) {
+        gl->glVertexAttribI1i(kFaceColorBaseLocation, m_faceColors.isEmpty() ? 0 : static_cast<GLint>(first / 3 + 1));
+        gl->glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(count), GL_UNSIGNED_INT,
+                                    reinterpret_cast<const void *>(static_cast<quintptr>(first) * sizeof(unsigned int)), m_instanceCount);
+    };
+    if (m_ranges.isEmpty() || !viewProjection) {
+        drawIndices(0, static_cast<quint32>(m_indices.size()));
+        return;
+    }
+
+    // A range is skipped when its bounds are off screen for every
+    // instance; runs of adjacent survivors go out as one draw call.
+    const QVector<QMatrix4x4> transforms = m_instanceTransforms.isEmpty() ? QVector<QMatrix4x4>{QMatrix4x4()} : m_instanceTransforms;
+    quint32 runFirst = 0;
+    quint32 runEnd = 0;
+    for (const MeshRange &range : m_ranges) {
+        const bool visible = std::any_of(transforms.cbegin(), transforms.cend(), [&](const QMatrix4x4 &model) {
+            return boxInFrustum(*viewProjection * model, range.minBounds, range.maxBounds);
+        });
+        if (!visible)
+            continue;
+        if (range.firstIndex != runEnd) {
+            if (runEnd > runFirst)
+                drawIndices(runFirst, runEnd - runFirst);
+            runFirst = range.firstIndex;
+        }
+        runEnd = range.firstIndex + range.indexCount;
+    }
+    if (runEnd > runFirst)
+        drawIndices(runFirst, runEnd - runFirst);
+}
+
+void Mesh::drawFeatureEdges(QOpenGLFunctions_4_1_Core *gl) const
 {
-    if (!m_uploaded || !gl)
+    if (!m_uploaded || !gl || m_instanceCount <= 0 || m_featureEdges.isEmpty())
         return;
 
     QOpenGLVertexArrayObject::Binder vaoBinder(const_cast<QOpenGLVertexArrayObject *>(&m_vao));
-    gl->glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
+    const_cast<QOpenGLBuffer &>(m_edgeEbo).bind();
+    gl->glDrawElementsInstanced(GL_LINES, m_featureEdges.size(), GL_UNSIGNED_INT, nullptr, m_instanceCount);
+    const_cast<QOpenGLBuffer &>(m_ebo).bind();
 }
 
 quint64 Mesh::triangleCount() const
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "MeshRange.h"
+
+#include <QMatrix4x4>
 #include <QOpenGLBuffer>
 #include <QOpenGLFunctions_4_1_Core>
+#include <QOpenGLTexture>
 #include <QOpenGLVertexArrayObject>
 #include <QVector>
 #include <QVector3D>
@@ -19,9 +23,47 @@ public:
                  const QVector<QVector3D> &normals,
                  const QVector<unsigned int> &indices,
                  bool hasNormals);
+    // Optional per-vertex sRGB colors (attribute 10, 0xAABBGGRR). Must be
+    // set after setData, which clears them.
+    void setColors(const QVector<quint32> &colors);
+    bool hasColors() const { return !m_colors.isEmpty(); }
+    // Optional per-triangle RGB555 words (bit 15 = colored), kept in a
+    // buffer texture the fragment shader reads by gl_PrimitiveID, so welded
+    // meshes need two bytes per triangle instead of a color per corner.
+    // Must be set after setData, which clears them.
+    void setFaceColors(const QVector<quint16> &colors);
+    bool hasFaceColors() const { return !m_faceColors.isEmpty(); }
+    const QVector<quint16> &faceColors() const { return m_faceColors; }
+    static constexpr GLint kFaceColorTextureUnit = 0;
+    // Sub-mesh draw ranges, in index buffer order and covering all of it;
+    // draw() culls them one by one. Must be set after setData, which clears
+    // them; empty when the mesh is a single part.
+    void setRanges(const QVector<MeshRange> &ranges);
+    const QVector<MeshRange> &ranges() const { return m_ranges; }
+    // Optional GL_LINES index list into the vertex buffer (see
+    // FeatureEdges), drawn by drawFeatureEdges. Must be set after setData,
+    // which clears it.
+    void setFeatureEdges(const QVector<unsigned int> &lines);
+    // Replaces the list of an uploaded mesh by rewriting only its line
+    // index buffer.
+    void updateFeatureEdges(QOpenGLFunctions_4_1_Core *gl, const QVector<unsigned int> &lines);
+    bool hasFeatureEdges() const { return !m_featureEdges.isEmpty(); }
 
+    // Buffers whose size is unchanged since the last upload are rewritten
+    // in place rather than reallocated.
     void upload(QOpenGLFunctions_4_1_Core *gl);
-    void draw(QOpenGLFunctions_4_1_Core *gl) const;
+    void setInstanceTransforms(QOpenGLFunctions_4_1_Core *gl, const QVector<QMatrix4x4> &transforms);
+    // Optional per-vertex scalar (attribute 9) for analysis heatmaps.
+    // Meshes without one feed a large negative sentinel, meaning "no data".
+    void setScalarField(QOpenGLFunctions_4_1_Core *gl, const QVector<float> &values);
+    void clearScalarField(QOpenGLFunctions_4_1_Core *gl);
+    bool hasScalarField() const { return m_hasScalarField; }
+    // With `viewProjection`, sub-mesh ranges whose bounds fall outside the
+    // view for every instance are not drawn.
+    void draw(QOpenGLFunctions_4_1_Core *gl, const QMatrix4x4 *viewProjection = nullptr) const;
+    void drawFeatureEdges(QOpenGLFunctions_4_1_Core *gl) const;
+
+    int instanceCount() const { return m_instanceCount; }
 
     quint64 triangleCount() const;
     const QVector3D &minBounds() const { return m_minBounds; }
@@ -38,19 +80,34 @@ public:
 
 private:
     void updateBounds();
+    void uploadInstances(QOpenGLFunctions_4_1_Core *gl);
+    void uploadFeatureEdges();
 
     QVector<QVector3D> m_positions;
     QVector<unsigned int> m_indices;
     QVector<QVector3D> m_normals;
     QVector<QVector3D> m_originalNormals;
+    QVector<quint32> m_colors;
+    QVector<quint16> m_faceColors;
+    QVector<MeshRange> m_ranges;
+    QVector<unsigned int> m_featureEdges;
+    QVector<QMatrix4x4> m_instanceTransforms;
+    int m_instanceCount = 0;
 
     bool m_hasSourceNormals = false;
     bool m_uploaded = false;
+    bool m_hasScalarField = false;
 
     QVector3D m_minBounds;
     QVector3D m_maxBounds;
 
     QOpenGLBuffer m_vbo;
     QOpenGLBuffer m_ebo;
+    QOpenGLBuffer m_edgeEbo;
+    QOpenGLBuffer m_instanceVbo;
+    QOpenGLBuffer m_scalarVbo;
+    QOpenGLBuffer m_colorVbo;
+    QOpenGLBuffer m_faceColorBuffer;
+    QOpenGLTexture m_faceColorTexture;
     QOpenGLVertexArrayObject m_vao;
 };
@@ -0,0 +1,129 @@
+#include "MeshCache.h"
+
+#include <QFileInfo>
+#include <QMutexLocker>
+
+MeshCache::MeshCache(qint64 budgetBytes)
+    : m_budget(budgetBytes)
+{
+}
+
+MeshCache::Stamp MeshCache::stamp(const QString &path)
+{
+    const QFileInfo info(path);
+    Stamp stamp;
+    stamp.lastModified = info.lastModified();
+    stamp.fileSize = info.size();
+    return stamp;
+}
+
+void MeshCache::setBudget(qint64 budgetBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax<qint64>(0, budgetBytes);
+    evictToBudget();
+}
+
+qint64 MeshCache::budget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+qint64 MeshCache::usedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_used;
+}
+
+bool MeshCache::contains(const QString &path) const
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_entries.constFind(path);
+    return it != m_entries.constEnd() && isFresh(path, it.value());
+}
+
+bool MeshCache::lookup(const QString &path, MeshBuffer *buffer)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(path);
+    if (it == m_entries.end())
+        return false;
+
+    if (!isFresh(path, it.value())) {
+        m_used -= it->bytes;
+        m_entries.erase(it);
+        m_lru.removeAll(path);
+        return false;
+    }
+
+    m_lru.removeAll(path);
+    m_lru.prepend(path);
+    if (buffer)
+        *buffer = it->buffer;
+    return true;
+}
+
+quint64 MeshCache::generation() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_generation;
+}
+
+void MeshCache::insert(const QString &path, const MeshBuffer &buffer, const Stamp &stamp, quint64 generation)
+{
+    Entry entry;
+    entry.buffer = buffer;
+    entry.stamp = stamp;
+    entry.bytes = estimateBytes(buffer);
+
+    QMutexLocker locker(&m_mutex);
+    if (generation != m_generation || entry.bytes > m_budget)
+        return;
+
+    auto it = m_entries.find(path);
+    if (it != m_entries.end())
+        m_used -= it->bytes;
+    m_entries.insert(path, entry);
+    m_used += entry.bytes;
+    m_lru.removeAll(path);
+    m_lru.prepend(path);
+    evictToBudget();
+}
+
+void MeshCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_used = 0;
+    ++m_generation;
+}
+
+qint64 MeshCache::estimateBytes(const MeshBuffer &buffer)
+{
+    return static_cast<qint64>(buffer.positions.size()) * sizeof(QVector3D) +
+           static_cast<qint64>(buffer.normals.size()) * sizeof(QVector3D) +
+           static_cast<qint64>(buffer.indices.size()) * sizeof(unsigned int) +
+           static_cast<qint64>(buffer.colors.size()) * sizeof(quint32) +
+           static_cast<qint64>(buffer.faceColors.size()) * sizeof(quint16) +
+           static_cast<qint64>(buffer.featureEdges.size()) * sizeof(unsigned int);
+}
+
+bool MeshCache::isFresh(const QString &path, const Entry &entry) const
+{
+    const QFileInfo info(path);
+    return info.exists() && info.size() == entry.stamp.fileSize && info.lastModified() == entry.stamp.lastModified;
+}
+
+void MeshCache::evictToBudget()
+{
+    while (m_used > m_budget && !m_lru.isEmpty()) {
+        const QString victim = m_lru.takeLast();
+        const auto it = m_entries.find(victim);
+        if (it == m_entries.end())
+            continue;
+        m_used -= it->bytes;
+        m_entries.erase(it);
+    }
+}
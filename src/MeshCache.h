@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+class MeshCache
+{
+public:
+    // Size and modification time of a file on disk; an entry is served
+    // only while the file still matches the stamp taken before it was parsed.
+    struct Stamp
+    {
+        QDateTime lastModified;
+        qint64 fileSize = 0;
+    };
+
+    explicit MeshCache(qint64 budgetBytes = 512ll * 1024 * 1024);
+
+    static Stamp stamp(const QString &path);
+
+    void setBudget(qint64 budgetBytes);
+    qint64 budget() const;
+    qint64 usedBytes() const;
+
+    bool contains(const QString &path) const;
+    bool lookup(const QString &path, MeshBuffer *buffer);
+    // Bumped by clear(); an insert made for an older generation is dropped
+    // so a load that was in flight when the cache was cleared stays out.
+    quint64 generation() const;
+    void insert(const QString &path, const MeshBuffer &buffer, const Stamp &stamp, quint64 generation);
+    void clear();
+
+    static qint64 estimateBytes(const MeshBuffer &buffer);
+
+private:
+    struct Entry
+    {
+        MeshBuffer buffer;
+        Stamp stamp;
+        qint64 bytes = 0;
+    };
+
+    bool isFresh(const QString &path, const Entry &entry) const;
+    void evictToBudget();
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    QStringList m_lru;
+    qint64 m_budget = 0;
+    qint64 m_used = 0;
+    quint64 m_generation = 0;
+};
@@ -0,0 +1,179 @@
+#include "MeshDeviation.h"
+#include "MeshTopology.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kBatchSize = 1 << 16;
+
+struct Moments
+{
+    double sum = 0.0;
+    double sumAbsolute = 0.0;
+    double sumSquares = 0.0;
+    float minimum = std::numeric_limits<float>::max();
+    float maximum = -std::numeric_limits<float>::max();
+};
+
+float percentile(QVector<float> &sorted, double fraction)
+{
+    const auto rank = static_cast<qsizetype>(std::ceil(fraction * sorted.size())) - 1;
+    const qsizetype index = qBound<qsizetype>(0, rank, sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted.at(index);
+}
+
+float cornerAngle(const QVector3D &corner, const QVector3D &next, const QVector3D &previous)
+{
+    const QVector3D u = (next - corner).normalized();
+    const QVector3D v = (previous - corner).normalized();
+    return std::acos(qBound(-1.0f, QVector3D::dotProduct(u, v), 1.0f));
+}
+} // namespace
+
+void PseudoNormals::build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices)
+{
+    clear();
+    const MeshTopology topology = MeshTopology::build(positions, indices);
+    if (topology.isEmpty())
+        return;
+
+    const QVector<unsigned int> &corners = topology.indices();
+    const qsizetype triangleCount = static_cast<qsizetype>(topology.triangleCount());
+    QVector<QVector3D> faceNormals(triangleCount);
+    QVector<QVector3D> cornerNormals(corners.size());
+    m_cornerVertices.resize(corners.size());
+    Parallel::forEach(triangleCount, [&](qsizetype t) {
+        const QVector3D p[3] = {positions.at(corners.at(t * 3)), positions.at(corners.at(t * 3 + 1)), positions.at(corners.at(t * 3 + 2))};
+        const QVector3D n = QVector3D::crossProduct(p[1] - p[0], p[2] - p[0]).normalized();
+        faceNormals[t] = n;
+        for (int k = 0; k < 3; ++k) {
+            cornerNormals[t * 3 + k] = n.isNull() ? QVector3D() : n * cornerAngle(p[k], p[(k + 1) % 3], p[(k + 2) % 3]);
+            m_cornerVertices[t * 3 + k] = topology.weldedCorner(static_cast<quint32>(t * 3 + k));
+        }
+    });
+
+    // Vertex normals: incident face normals weighted by their corner angle.
+    m_vertexNormals = QVector<QVector3D>(static_cast<qsizetype>(topology.vertexCount()));
+    for (qsizetype c = 0; c < corners.size(); ++c)
+        m_vertexNormals[m_cornerVertices.at(c)] += cornerNormals.at(c);
+    Parallel::forEach(m_vertexNormals.size(), [&](qsizetype v) { m_vertexNormals[v].normalize(); });
+
+    // Edge normals: the sum of the faces sharing the edge, stored for each
+    // of its half-edges.
+    m_edgeNormals = QVector<QVector3D>(corners.size());
+    topology.forEachEdge(topology.edgeRanges(), [&](const Parallel::Range &, quint32 v0, quint32, const MeshTopology::HalfEdge *halfEdges, int count) {
+        const bool firstFromV0 = topology.weldedCorner(halfEdges[0].id) == v0;
+        QVector3D sum;
+        for (int i = 0; i < count; ++i) {
+            // A neighbour wound the other way runs the edge in the same
+            // direction as the first face; flip it so the sum does not cancel.
+            const bool flipped = i > 0 && (topology.weldedCorner(halfEdges[i].id) == v0) == firstFromV0;
+            const QVector3D &n = faceNormals.at(halfEdges[i].id / 3);
+            sum += flipped ? -n : n;
+        }
+        sum.normalize();
+        for (int i = 0; i < count; ++i)
+            m_edgeNormals[halfEdges[i].id] = sum;
+    });
+}
+
+void PseudoNormals::clear()
+{
+    m_edgeNormals.clear();
+    m_vertexNormals.clear();
+    m_cornerVertices.clear();
+}
+
+QVector3D PseudoNormals::normal(const Bvh::Closest &closest) const
+{
+    const qsizetype corner = static_cast<qsizetype>(closest.triangle) * 3 + closest.corner;
+    QVector3D n;
+    if (closest.feature == Bvh::Feature::Edge && corner < m_edgeNormals.size())
+        n = m_edgeNormals.at(corner);
+    else if (closest.feature == Bvh::Feature::Vertex && corner < m_cornerVertices.size())
+        n = m_vertexNormals.at(m_cornerVertices.at(corner));
+    // Collapsed triangles and features without a normal fall back to the face.
+    return n.isNull() ? closest.normal : n;
+}
+
+bool MeshDeviation::compute(const Bvh &reference,
+                            const PseudoNormals &normals,
+                            const QVector<QVector3D> &positions,
+                            const QMatrix4x4 &transform,
+                            DeviationField *field,
+                            const ProgressFunction &progress)
+{
+    if (!field || reference.isEmpty() || positions.isEmpty())
+        return false;
+
+    const qsizetype count = positions.size();
+    QVector<float> values(count);
+    float *data = values.data();
+    const float maxDistance = std::numeric_limits<float>::max();
+
+    for (qsizetype first = 0; first < count; first += kBatchSize) {
+        const qsizetype batchEnd = qMin(count, first + kBatchSize);
+        Parallel::forEach(
+            batchEnd - first,
+            [&](qsizetype offset) {
+                const qsizetype i = first + offset;
+                const QVector3D point = transform.map(positions.at(i));
+                Bvh::Closest closest;
+                if (!reference.closestPoint(point, maxDistance, &closest)) {
+                    data[i] = 0.0f;
+                    return;
+                }
+                const bool outside = QVector3D::dotProduct(point - closest.point, normals.normal(closest)) >= 0.0f;
+                data[i] = outside ? closest.distance : -closest.distance;
+            },
+            1024);
+        if (progress && !progress(static_cast<int>(batchEnd / 1024), static_cast<int>((count + 1023) / 1024)))
+            return false;
+    }
+
+    const QVector<Parallel::Range> ranges = Parallel::split(count);
+    QVector<Moments> partials(ranges.size());
+    Parallel::forRanges(ranges, [&](const Parallel::Range &range) {
+        Moments &moments = partials[range.index];
+        for (qsizetype i = range.begin; i < range.end; ++i) {
+            const float value = data[i];
+            moments.sum += value;
+            moments.sumAbsolute += std::abs(value);
+            moments.sumSquares += static_cast<double>(value) * value;
+            moments.minimum = qMin(moments.minimum, value);
+            moments.maximum = qMax(moments.maximum, value);
+        }
+    });
+
+    Moments total;
+    for (const Moments &moments : partials) {
+        total.sum += moments.sum;
+        total.sumAbsolute += moments.sumAbsolute;
+        total.sumSquares += moments.sumSquares;
+        total.minimum = qMin(total.minimum, moments.minimum);
+        total.maximum = qMax(total.maximum, moments.maximum);
+    }
+
+    DeviationField result;
+    result.minimum = total.minimum;
+    result.maximum = total.maximum;
+    result.mean = total.sum / count;
+    result.meanAbsolute = total.sumAbsolute / count;
+    result.rms = std::sqrt(total.sumSquares / count);
+
+    QVector<float> magnitudes(count);
+    Parallel::forEach(count, [&](qsizetype i) { magnitudes[i] = std::abs(data[i]); });
+    result.p50 = percentile(magnitudes, 0.50);
+    result.p90 = percentile(magnitudes, 0.90);
+    result.p95 = percentile(magnitudes, 0.95);
+    result.p99 = percentile(magnitudes, 0.99);
+
+    result.values = std::move(values);
+    *field = std::move(result);
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Bvh.h"
+
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+
+#include <functional>
+
+struct DeviationField
+{
+    QVector<float> values; // per vertex; positive outside the reference surface
+    float minimum = 0.0f;
+    float maximum = 0.0f;
+    double mean = 0.0;
+    double meanAbsolute = 0.0;
+    double rms = 0.0;
+    // Percentiles of the absolute deviation.
+    float p50 = 0.0f;
+    float p90 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+
+    bool isEmpty() const { return values.isEmpty(); }
+};
+
+// Angle-weighted pseudonormals of a reference mesh (Baerentzen and Aanaes).
+// When the closest point lies on an edge or a corner, the face normal of
+// whichever triangle happened to be found can point the wrong way; the
+// pseudonormal of that edge or vertex gives the correct inside/outside
+// sign on convex and concave features alike.
+class PseudoNormals
+{
+public:
+    void build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices);
+    void clear();
+    bool isEmpty() const { return m_cornerVertices.isEmpty(); }
+
+    // Normal to test the sign against at `closest`.
+    QVector3D normal(const Bvh::Closest &closest) const;
+
+private:
+    QVector<QVector3D> m_edgeNormals;   // per half-edge, triangle * 3 + corner
+    QVector<QVector3D> m_vertexNormals; // per welded vertex
+    QVector<quint32> m_cornerVertices;  // welded vertex of every corner
+};
+
+// Signed distance from every vertex of a part to the closest point of a
+// reference surface. The sign comes from the pseudonormal at the closest
+// point, so the reference should be closed and consistently wound.
+class MeshDeviation
+{
+public:
+    using ProgressFunction = std::function<bool(int finished, int total)>;
+
+    // `transform` places the part's vertices in the reference frame. Returns
+    // false when `progress` cancels; `field` is left untouched then.
+    static bool compute(const Bvh &reference,
+                        const PseudoNormals &normals,
+                        const QVector<QVector3D> &positions,
+                        const QMatrix4x4 &transform,
+                        DeviationField *field,
+                        const ProgressFunction &progress = ProgressFunction());
+};
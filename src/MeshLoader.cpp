@@ -1,4 +1,11 @@
 #include "MeshLoader.h"
+#include "DecompressingDevice.h"
+#include "FeatureEdges.h"
+#include "MeshOptimizer.h"
+#include "NativeMeshFormat.h"
+#include "OBJParser.h"
+#include "PLYParser.h"
+#include "Parallel.h"
 #include "STLParser.h"
 
 #ifdef USE_ASSIMP
@@ -7,50 +14,231 @@
 #include <assimp/scene.h>
 #endif
 
+#include <QFile>
+#include <QFileInfo>
 #include <QObject>
 
-MeshLoader::MeshLoader() = default;
+#include <algorithm>
+
+namespace
+{
+struct FileType
+{
+    const char *name; // translated with QObject::tr
+    QStringList patterns;
+};
+
+QVector<FileType> fileTypes()
+{
+    return {{QT_TR_NOOP("STL Files"), {QStringLiteral("*.stl"), QStringLiteral("*.stl.gz"), QStringLiteral("*.stl.zst")}},
+            {QT_TR_NOOP("PLY Files"), {QStringLiteral("*.ply")}},
+            {QT_TR_NOOP("OBJ Files"), {QStringLiteral("*.obj")}},
+            {QT_TR_NOOP("Compressed Meshes"), {QStringLiteral("*.") + NativeMeshFormat::fileSuffix()}}};
+}
+} // namespace
+
+#ifdef USE_ASSIMP
+namespace
+{
+struct AssimpPart
+{
+    const aiMesh *mesh = nullptr;
+    qsizetype triangleCount = 0;
+    qsizetype firstVertex = 0;
+    qsizetype firstTriangle = 0;
+};
+
+// Copies one sub-mesh into its slice of the presized buffer. Sub-meshes
+// without normals get smooth ones from their own faces when the buffer
+// carries normals for the others.
+void convertAssimpPart(const AssimpPart &part, MeshBuffer &buffer, MeshRange *range)
+{
+    const aiMesh *mesh = part.mesh;
+    const unsigned int base = static_cast<unsigned int>(part.firstVertex);
+    QVector3D *positions = buffer.positions.data() + part.firstVertex;
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        const aiVector3D &v = mesh->mVertices[i];
+        positions[i] = QVector3D(v.x, v.y, v.z);
+    }
+
+    unsigned int *indices = buffer.indices.data() + part.firstTriangle * 3;
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace &face = mesh->mFaces[f];
+        if (face.mNumIndices < 3)
+            continue;
+        for (unsigned int idx = 0; idx < 3; ++idx)
+            *indices++ = base + face.mIndices[idx];
+    }
+
+    if (!buffer.normals.isEmpty()) {
+        QVector3D *normals = buffer.normals.data() + part.firstVertex;
+        if (mesh->HasNormals()) {
+            for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+                const aiVector3D &n = mesh->mNormals[i];
+                normals[i] = QVector3D(n.x, n.y, n.z);
+            }
+        } else {
+            const unsigned int *triangles = buffer.indices.constData() + part.firstTriangle * 3;
+            for (qsizetype t = 0; t < part.triangleCount; ++t) {
+                const unsigned int a = triangles[t * 3] - base;
+                const unsigned int b = triangles[t * 3 + 1] - base;
+                const unsigned int c = triangles[t * 3 + 2] - base;
+                if (a >= mesh->mNumVertices || b >= mesh->mNumVertices || c >= mesh->mNumVertices)
+                    continue;
+                QVector3D n = QVector3D::crossProduct(positions[b] - positions[a], positions[c] - positions[a]);
+                if (!n.isNull())
+                    n.normalize();
+                normals[a] += n;
+                normals[b] += n;
+                normals[c] += n;
+            }
+            for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+                normals[i] = normals[i].isNull() ? QVector3D(0.0f, 1.0f, 0.0f) : normals[i].normalized();
+        }
+    }
+
+    range->name = QString::fromUtf8(mesh->mName.C_Str());
+    range->firstIndex = static_cast<quint32>(part.firstTriangle * 3);
+    range->indexCount = static_cast<quint32>(part.triangleCount * 3);
+    range->minBounds = positions[0];
+    range->maxBounds = positions[0];
+    for (unsigned int i = 1; i < mesh->mNumVertices; ++i) {
+        const QVector3D &p = positions[i];
+        range->minBounds = QVector3D(qMin(range->minBounds.x(), p.x()), qMin(range->minBounds.y(), p.y()), qMin(range->minBounds.z(), p.z()));
+        range->maxBounds = QVector3D(qMax(range->maxBounds.x(), p.x()), qMax(range->maxBounds.y(), p.y()), qMax(range->maxBounds.z(), p.z()));
+    }
+}
+} // namespace
+#endif
+
+MeshLoader::MeshLoader()
+    : m_extractFeatureEdges(false)
+    , m_featureAngle(FeatureEdges::kDefaultAngle)
+{
+}
+
+QStringList MeshLoader::nameFilters()
+{
+    QStringList filters;
+    for (const FileType &type : fileTypes())
+        filters += type.patterns;
+    return filters;
+}
+
+QString MeshLoader::fileDialogFilter()
+{
+    QStringList entries = {QObject::tr("Mesh Files (%1)").arg(nameFilters().join(QLatin1Char(' ')))};
+    for (const FileType &type : fileTypes())
+        entries.append(QStringLiteral("%1 (%2)").arg(QObject::tr(type.name), type.patterns.join(QLatin1Char(' '))));
+    return entries.join(QStringLiteral(";;"));
+}
+
+bool MeshLoader::canLoad(const QString &path)
+{
+    const QStringList filters = nameFilters();
+    return std::any_of(filters.cbegin(), filters.cend(), [&](const QString &filter) {
+        return path.endsWith(QStringView(filter).mid(1), Qt::CaseInsensitive);
+    });
+}
 
 MeshBuffer MeshLoader::load(const QString &path, QString *errorMessage) const
 {
+    MeshBuffer buffer = read(path, errorMessage);
+    if (!buffer.positions.isEmpty() && !buffer.indices.isEmpty()) {
+        MeshOptimizer::optimize(buffer);
+        if (m_extractFeatureEdges) {
+            buffer.featureEdges = FeatureEdges::extract(buffer.positions, buffer.indices, m_featureAngle);
+            buffer.featureAngle = m_featureAngle;
+        }
+    }
+    return buffer;
+}
+
+void MeshLoader::setExtractFeatureEdges(bool extract)
+{
+    m_extractFeatureEdges = extract;
+}
+
+bool MeshLoader::extractFeatureEdges() const
+{
+    return m_extractFeatureEdges;
+}
+
+void MeshLoader::setFeatureAngle(float degrees)
+{
+    m_featureAngle = degrees;
+}
+
+float MeshLoader::featureAngle() const
+{
+    return m_featureAngle;
+}
+
+MeshBuffer MeshLoader::read(const QString &path, QString *errorMessage) const
+{
+    {
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly)) {
+            const QByteArray header = file.peek(16);
+            if (NativeMeshFormat::canRead(header)) {
+                NativeMeshFormat format;
+                return format.read(path, errorMessage);
+            }
+            if (PLYParser::canRead(header)) {
+                PLYParser parser;
+                return parser.parse(path, errorMessage);
+            }
+            // Compressed archives are STL; the parser inflates them itself.
+            if (DecompressingDevice::detect(header) != DecompressingDevice::Codec::None) {
+                STLParser parser;
+                return parser.parse(path, errorMessage);
+            }
+        }
+    }
+    // OBJ has no magic number to sniff.
+    if (QFileInfo(path).suffix().compare(QLatin1String("obj"), Qt::CaseInsensitive) == 0) {
+        OBJParser parser;
+        return parser.parse(path, errorMessage);
+    }
+
 #ifdef USE_ASSIMP
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path.toStdString(),
-                                            aiProcess_Triangulate |
-                                                aiProcess_JoinIdenticalVertices |
-                                                aiProcess_GenNormals |
-                                                aiProcess_ImproveCacheLocality |
-                                                aiProcess_OptimizeMeshes);
+    // Normals are generated below, only for the sub-meshes that lack them,
+    // and the vertex cache order is left to MeshOptimizer. Sub-meshes are
+    // not merged, so each one keeps its own draw range.
+    const aiScene *scene = importer.ReadFile(path.toStdString(), aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
     if (scene && scene->HasMeshes()) {
-        MeshBuffer buffer;
-        bool allHaveNormals = true;
+        QVector<AssimpPart> parts;
         for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; ++meshIndex) {
             const aiMesh *mesh = scene->mMeshes[meshIndex];
-            if (!mesh)
-                continue;
-            const unsigned int baseIndex = buffer.positions.size();
-            for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-                const aiVector3D &v = mesh->mVertices[i];
-                buffer.positions.append(QVector3D(v.x, v.y, v.z));
-                if (mesh->HasNormals()) {
-                    const aiVector3D &n = mesh->mNormals[i];
-                    buffer.normals.append(QVector3D(n.x, n.y, n.z));
-                }
+            if (mesh && mesh->mNumVertices > 0)
+                parts.append({mesh});
+        }
+        Parallel::forEach(parts.size(), [&parts](qsizetype i) {
+            AssimpPart &part = parts[i];
+            for (unsigned int f = 0; f < part.mesh->mNumFaces; ++f) {
+                if (part.mesh->mFaces[f].mNumIndices >= 3)
+                    ++part.triangleCount;
             }
-            if (!mesh->HasNormals())
-                allHaveNormals = false;
+        }, 1);
 
-            for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
-                const aiFace &face = mesh->mFaces[f];
-                if (face.mNumIndices < 3)
-                    continue;
-                for (unsigned int idx = 0; idx < 3; ++idx)
-                    buffer.indices.append(baseIndex + face.mIndices[idx]);
-            }
+        MeshBuffer buffer;
+        qsizetype vertexTotal = 0;
+        qsizetype triangleTotal = 0;
+        for (AssimpPart &part : parts) {
+            part.firstVertex = vertexTotal;
+            part.firstTriangle = triangleTotal;
+            vertexTotal += part.mesh->mNumVertices;
+            triangleTotal += part.triangleCount;
+            buffer.hasNormals = buffer.hasNormals || part.mesh->HasNormals();
         }
-        if (!allHaveNormals)
-            buffer.normals.clear();
-        buffer.hasNormals = allHaveNormals && !buffer.normals.isEmpty();
+        buffer.positions.resize(vertexTotal);
+        if (buffer.hasNormals)
+            buffer.normals.resize(vertexTotal);
+        buffer.indices.resize(triangleTotal * 3);
+        buffer.ranges.resize(parts.size());
+        Parallel::forEach(parts.size(), [&](qsizetype i) { convertAssimpPart(parts.at(i), buffer, &buffer.ranges[i]); }, 1);
+
         if (!buffer.positions.isEmpty())
             return buffer;
         if (errorMessage)
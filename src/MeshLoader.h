@@ -1,6 +1,9 @@
 #pragma once
 
+#include "MeshRange.h"
+
 #include <QString>
+#include <QStringList>
 #include <QVector>
 #include <QVector3D>
 
@@ -9,12 +12,52 @@ struct MeshBuffer
     QVector<QVector3D> positions;
     QVector<QVector3D> normals;
     QVector<unsigned int> indices;
+    QVector<quint32> colors; // optional per-vertex sRGB, 0xAABBGGRR with alpha 255
+    QVector<quint16> faceColors; // optional per-triangle RGB555, bit 15 set when the facet has a color
+    // Sharp and open edges as vertex index pairs, see FeatureEdges, and
+    // the dihedral angle in degrees they were extracted at; negative if
+    // the loader did not extract them.
+    QVector<unsigned int> featureEdges;
+    float featureAngle = -1.0f;
+    // Sub-mesh boundaries in `indices`; empty for single-part formats.
+    QVector<MeshRange> ranges;
     bool hasNormals = false;
+    // Vertex cache misses per triangle as parsed and as optimized by
+    // MeshOptimizer; zero if the optimizer did not run.
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
 };
 
 class MeshLoader
 {
 public:
     MeshLoader();
+
+    // Name patterns of every format load() reads ("*.stl", ...), for
+    // directory scans; the same list as a file dialog filter with one entry
+    // per format; and whether `path` matches one of the patterns.
+    static QStringList nameFilters();
+    static QString fileDialogFilter();
+    static bool canLoad(const QString &path);
+
+    // Parses `path`, optimizes the result for the vertex caches and, if
+    // enabled, extracts its feature edges.
     MeshBuffer load(const QString &path, QString *errorMessage) const;
+
+    // Feature edges are only drawn by the viewport, so loaders feeding it
+    // turn extraction on; it is off by default. Not synchronized: set it
+    // before starting loads.
+    void setExtractFeatureEdges(bool extract);
+    bool extractFeatureEdges() const;
+
+    // Dihedral angle in degrees above which an edge counts as a feature
+    // edge. Not synchronized: set it before starting loads.
+    void setFeatureAngle(float degrees);
+    float featureAngle() const;
+
+private:
+    MeshBuffer read(const QString &path, QString *errorMessage) const;
+
+    bool m_extractFeatureEdges;
+    float m_featureAngle;
 };
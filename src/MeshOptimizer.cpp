@@ -0,0 +1,460 @@
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+// Forsyth's scoring assumes a 32-entry LRU cache; ACMR and cluster
+// boundaries use a 16-entry FIFO, closer to what hardware reuses.
+constexpr int kLruSize = 32;
+constexpr int kFifoSize = 16;
+constexpr int kMaxValence = 64;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+constexpr qsizetype kChunkTriangles = 1 << 16;
+
+struct ScoreTable
+{
+    float cache[kLruSize];
+    float valence[kMaxValence];
+
+    ScoreTable()
+    {
+        for (int i = 0; i < kLruSize; ++i) {
+            // The last triangle's corners score a flat value, so the next
+            // triangle does not simply reuse its most recent edge.
+            cache[i] = i < 3 ? kLastTriangleScore
+                             : std::pow(1.0f - float(i - 3) / float(kLruSize - 3), kCacheDecayPower);
+        }
+        valence[0] = 0.0f;
+        for (int i = 1; i < kMaxValence; ++i)
+            valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+    }
+};
+
+const ScoreTable &scoreTable()
+{
+    static const ScoreTable table;
+    return table;
+}
+
+float vertexScore(int cachePosition, quint32 remaining)
+{
+    if (remaining == 0)
+        return -1.0f;
+    const ScoreTable &table = scoreTable();
+    float score = cachePosition >= 0 ? table.cache[cachePosition] : 0.0f;
+    return score + table.valence[qMin<quint32>(remaining, kMaxValence - 1)];
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation". `corners` holds three
+// local vertex ids per triangle; returns the triangles in draw order.
+QVector<quint32> forsythOrder(const QVector<quint32> &corners, qsizetype vertexCount)
+{
+    const qsizetype triangleCount = corners.size() / 3;
+
+    // Triangles per vertex; the live ones are kept at the front of each list.
+    QVector<quint32> offsets(vertexCount + 1, 0);
+    for (quint32 v : corners)
+        ++offsets[v + 1];
+    for (qsizetype v = 0; v < vertexCount; ++v)
+        offsets[v + 1] += offsets[v];
+    QVector<quint32> remaining(vertexCount, 0);
+    QVector<quint32> adjacency(corners.size());
+    for (qsizetype c = 0; c < corners.size(); ++c) {
+        const quint32 v = corners.at(c);
+        adjacency[offsets.at(v) + remaining[v]++] = static_cast<quint32>(c / 3);
+    }
+
+    QVector<int> cachePosition(vertexCount, -1);
+    QVector<float> score(vertexCount);
+    for (qsizetype v = 0; v < vertexCount; ++v)
+        score[v] = vertexScore(-1, remaining.at(v));
+    auto triangleScore = [&](qsizetype t) {
+        return score.at(corners.at(t * 3)) + score.at(corners.at(t * 3 + 1)) + score.at(corners.at(t * 3 + 2));
+    };
+    qsizetype best = -1;
+    float bestScore = -std::numeric_limits<float>::max();
+    for (qsizetype t = 0; t < triangleCount; ++t) {
+        const float s = triangleScore(t);
+        if (s > bestScore) {
+            bestScore = s;
+            best = t;
+        }
+    }
+
+    QVector<char> emitted(triangleCount, 0);
+    QVector<quint32> order;
+    order.reserve(triangleCount);
+    quint32 cache[kLruSize + 3];
+    int cacheCount = 0;
+    qsizetype cursor = 0;
+
+    while (order.size() < triangleCount) {
+        if (best < 0) {
+            // Nothing in the cache touches a live triangle; the chunk is
+            // spatially sorted, so the next one in input order stays local.
+            while (emitted.at(cursor))
+                ++cursor;
+            best = cursor;
+        }
+        emitted[best] = 1;
+        order.append(static_cast<quint32>(best));
+
+        quint32 next[kLruSize + 3];
+        int nextCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            const quint32 v = corners.at(best * 3 + k);
+            quint32 *begin = adjacency.data() + offsets.at(v);
+            quint32 *end = begin + remaining.at(v);
+            quint32 *found = std::find(begin, end, static_cast<quint32>(best));
+            if (found != end) {
+                *found = *(end - 1);
+                --remaining[v];
+            }
+            if (std::find(next, next + nextCount, v) == next + nextCount)
+                next[nextCount++] = v;
+        }
+        const int triangleVertices = nextCount;
+        for (int i = 0; i < cacheCount; ++i) {
+            if (std::find(next, next + triangleVertices, cache[i]) == next + triangleVertices)
+                next[nextCount++] = cache[i];
+        }
+
+        // Entries pushed past the end leave the cache; their triangles are
+        // rescored too, since their scores just dropped.
+        for (int i = 0; i < nextCount; ++i) {
+            const quint32 v = next[i];
+            cachePosition[v] = i < kLruSize ? i : -1;
+            score[v] = vertexScore(cachePosition.at(v), remaining.at(v));
+        }
+        cacheCount = qMin(nextCount, kLruSize);
+        std::copy(next, next + cacheCount, cache);
+
+        best = -1;
+        bestScore = -std::numeric_limits<float>::max();
+        for (int i = 0; i < nextCount; ++i) {
+            const quint32 v = next[i];
+            for (quint32 a = offsets.at(v), end = offsets.at(v) + remaining.at(v); a < end; ++a) {
+                const quint32 t = adjacency.at(a);
+                const float s = triangleScore(t);
+                if (s > bestScore) {
+                    bestScore = s;
+                    best = t;
+                }
+            }
+        }
+    }
+    return order;
+}
+
+quint32 floatBits(float value)
+{
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+quint64 mix(quint64 hash, quint32 value)
+{
+    hash ^= value;
+    hash *= 0x100000001b3ull;
+    return hash ^ (hash >> 29);
+}
+
+quint32 spreadBits(quint32 value)
+{
+    value &= 0x3ff;
+    value = (value | (value << 16)) & 0x030000ff;
+    value = (value | (value << 8)) & 0x0300f00f;
+    value = (value | (value << 4)) & 0x030c30c3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+// Merges bit-identical vertices; returns the representative of each one.
+QVector<quint32> weldIdentical(const MeshBuffer &buffer, bool withNormals, bool withColors)
+{
+    const qsizetype vertexCount = buffer.positions.size();
+    // A null normal (binary STL often stores (0,0,0)) is a placeholder for
+    // the facet's own normal, not a shared one: such corners never weld.
+    auto compare = [&](quint32 a, quint32 b) {
+        int c = std::memcmp(&buffer.positions.at(a), &buffer.positions.at(b), sizeof(QVector3D));
+        if (c == 0 && withNormals) {
+            c = std::memcmp(&buffer.normals.at(a), &buffer.normals.at(b), sizeof(QVector3D));
+            if (c == 0 && buffer.normals.at(a).isNull())
+                c = a < b ? -1 : (a > b ? 1 : 0);
+        }
+        if (c == 0 && withColors)
+            c = buffer.colors.at(a) < buffer.colors.at(b) ? -1 : (buffer.colors.at(a) > buffer.colors.at(b) ? 1 : 0);
+        return c;
+    };
+
+    struct Key
+    {
+        quint64 hash;
+        quint32 vertex;
+    };
+    QVector<Key> keys(vertexCount);
+    Parallel::forEach(vertexCount, [&](qsizetype i) {
+        quint64 hash = 0xcbf29ce484222325ull;
+        const QVector3D &p = buffer.positions.at(i);
+        for (int axis = 0; axis < 3; ++axis)
+            hash = mix(hash, floatBits(p[axis]));
+        if (withNormals) {
+            const QVector3D &n = buffer.normals.at(i);
+            for (int axis = 0; axis < 3; ++axis)
+                hash = mix(hash, floatBits(n[axis]));
+        }
+        if (withColors)
+            hash = mix(hash, buffer.colors.at(i));
+        keys[i] = {hash, static_cast<quint32>(i)};
+    });
+    Parallel::sort(keys, [&](const Key &a, const Key &b) {
+        if (a.hash != b.hash)
+            return a.hash < b.hash;
+        const int c = compare(a.vertex, b.vertex);
+        return c != 0 ? c < 0 : a.vertex < b.vertex;
+    });
+
+    QVector<quint32> representative(vertexCount);
+    for (qsizetype i = 0; i < vertexCount;) {
+        qsizetype j = i + 1;
+        while (j < vertexCount && keys.at(j).hash == keys.at(i).hash && compare(keys.at(j).vertex, keys.at(i).vertex) == 0)
+            ++j;
+        for (qsizetype k = i; k < j; ++k)
+            representative[keys.at(k).vertex] = keys.at(i).vertex;
+        i = j;
+    }
+    return representative;
+}
+
+// Reorders one chunk of triangles for the vertex cache, then sorts its
+// cache clusters outward-facing first. Writes the original triangle ids in
+// draw order to `order`.
+void optimizeChunk(const MeshBuffer &buffer, const quint32 *triangles, qsizetype count, const QVector3D &center, quint32 *order)
+{
+    QVector<quint32> globals(count * 3);
+    for (qsizetype t = 0; t < count; ++t) {
+        for (int k = 0; k < 3; ++k)
+            globals[t * 3 + k] = buffer.indices.at(qsizetype(triangles[t]) * 3 + k);
+    }
+    QVector<quint32> vertices = globals;
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    QVector<quint32> corners(globals.size());
+    for (qsizetype c = 0; c < globals.size(); ++c)
+        corners[c] = static_cast<quint32>(std::lower_bound(vertices.cbegin(), vertices.cend(), globals.at(c)) - vertices.cbegin());
+
+    const QVector<quint32> sequence = forsythOrder(corners, vertices.size());
+
+    // A cluster ends where a triangle misses the cache with all three
+    // corners: nothing before it is reused after it, so clusters can be
+    // drawn in any order without hurting the cache.
+    struct Cluster
+    {
+        qsizetype begin = 0;
+        qsizetype end = 0;
+        float key = 0.0f;
+    };
+    QVector<Cluster> clusters;
+    QVector<qint64> stamp(vertices.size(), std::numeric_limits<qint64>::min() / 2);
+    qint64 time = 0;
+    QVector3D areaNormal;
+    QVector3D areaCentroid;
+    float area = 0.0f;
+    auto closeCluster = [&](qsizetype end) {
+        Cluster cluster;
+        cluster.begin = clusters.isEmpty() ? 0 : clusters.last().end;
+        cluster.end = end;
+        if (area > 0.0f && !areaNormal.isNull())
+            cluster.key = QVector3D::dotProduct(areaCentroid / area - center, areaNormal.normalized());
+        clusters.append(cluster);
+        areaNormal = QVector3D();
+        areaCentroid = QVector3D();
+        area = 0.0f;
+    };
+    for (qsizetype i = 0; i < sequence.size(); ++i) {
+        const quint32 t = sequence.at(i);
+        int misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            const quint32 v = corners.at(qsizetype(t) * 3 + k);
+            if (time - stamp.at(v) >= kFifoSize) {
+                stamp[v] = time++;
+                ++misses;
+            }
+        }
+        if (misses == 3 && i > 0)
+            closeCluster(i);
+
+        const QVector3D &a = buffer.positions.at(globals.at(qsizetype(t) * 3));
+        const QVector3D &b = buffer.positions.at(globals.at(qsizetype(t) * 3 + 1));
+        const QVector3D &c = buffer.positions.at(globals.at(qsizetype(t) * 3 + 2));
+        const QVector3D normal = QVector3D::crossProduct(b - a, c - a);
+        const float twiceArea = normal.length();
+        areaNormal += normal;
+        areaCentroid += (a + b + c) * (twiceArea / 3.0f);
+        area += twiceArea;
+    }
+    if (!sequence.isEmpty())
+        closeCluster(sequence.size());
+
+    // Outward-facing clusters first: they tend to be in front, so the
+    // depth test rejects more of what is drawn after them.
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+    qsizetype out = 0;
+    for (const Cluster &cluster : clusters) {
+        for (qsizetype i = cluster.begin; i < cluster.end; ++i)
+            order[out++] = triangles[sequence.at(i)];
+    }
+}
+} // namespace
+
+float MeshOptimizer::acmr(const QVector<unsigned int> &indices, qsizetype vertexCount, int cacheSize)
+{
+    const qsizetype triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return 0.0f;
+
+    QVector<qint64> stamp(vertexCount, std::numeric_limits<qint64>::min() / 2);
+    qint64 time = 0;
+    for (qsizetype i = 0; i < triangleCount * 3; ++i) {
+        const unsigned int v = indices.at(i);
+        if (time - stamp.at(v) >= cacheSize)
+            stamp[v] = time++;
+    }
+    return static_cast<float>(time) / static_cast<float>(triangleCount);
+}
+
+bool MeshOptimizer::optimize(MeshBuffer &buffer)
+{
+    const qsizetype vertexCount = buffer.positions.size();
+    const qsizetype triangleCount = buffer.indices.size() / 3;
+    if (triangleCount == 0 || buffer.indices.size() % 3 != 0)
+        return false;
+
+    std::atomic<bool> valid = true;
+    Parallel::forEach(buffer.indices.size(), [&](qsizetype i) {
+        if (buffer.indices.at(i) >= static_cast<unsigned int>(vertexCount))
+            valid.store(false, std::memory_order_relaxed);
+    });
+    if (!valid)
+        return false;
+
+    buffer.acmrBefore = acmr(buffer.indices, vertexCount);
+
+    // Only weld what cannot change the shading: with normals missing, a
+    // soup would turn from flat to smooth once its corners are shared.
+    const bool withNormals = buffer.normals.size() == vertexCount;
+    const bool withColors = buffer.colors.size() == vertexCount;
+    if (withNormals) {
+        const QVector<quint32> representative = weldIdentical(buffer, withNormals, withColors);
+        Parallel::forEach(buffer.indices.size(), [&](qsizetype i) { buffer.indices[i] = representative.at(buffer.indices.at(i)); });
+    }
+
+    QVector3D minBounds = buffer.positions.first();
+    QVector3D maxBounds = minBounds;
+    for (const QVector3D &p : buffer.positions) {
+        minBounds = QVector3D(qMin(minBounds.x(), p.x()), qMin(minBounds.y(), p.y()), qMin(minBounds.z(), p.z()));
+        maxBounds = QVector3D(qMax(maxBounds.x(), p.x()), qMax(maxBounds.y(), p.y()), qMax(maxBounds.z(), p.z()));
+    }
+    const QVector3D center = (minBounds + maxBounds) * 0.5f;
+
+    // Sub-meshes keep their index ranges: triangles are only reordered
+    // within their own range.
+    struct Span
+    {
+        qsizetype begin = 0;
+        qsizetype end = 0;
+    };
+    QVector<Span> spans;
+    for (const MeshRange &range : buffer.ranges) {
+        const qsizetype begin = range.firstIndex / 3;
+        if (begin != (spans.isEmpty() ? 0 : spans.last().end) || range.indexCount % 3 != 0)
+            break;
+        spans.append({begin, begin + range.indexCount / 3});
+    }
+    if (spans.isEmpty() || spans.last().end != triangleCount)
+        spans = {Span{0, triangleCount}};
+
+    // Spatial chunks in Morton order of the triangle centroids.
+    QVector<quint32> triangles(triangleCount);
+    for (qsizetype t = 0; t < triangleCount; ++t)
+        triangles[t] = static_cast<quint32>(t);
+    const QVector3D extent = maxBounds - minBounds;
+    const float scale = 1023.0f / qMax(qMax(extent.x(), extent.y()), qMax(extent.z(), 1e-20f));
+    for (const Span &span : spans) {
+        const qsizetype count = span.end - span.begin;
+        if (count <= kChunkTriangles)
+            continue;
+        QVector<quint64> keys(count);
+        Parallel::forEach(count, [&](qsizetype i) {
+            const qsizetype t = span.begin + i;
+            const QVector3D centroid = (buffer.positions.at(buffer.indices.at(t * 3)) + buffer.positions.at(buffer.indices.at(t * 3 + 1)) +
+                                        buffer.positions.at(buffer.indices.at(t * 3 + 2))) / 3.0f;
+            const QVector3D cell = (centroid - minBounds) * scale;
+            const quint32 code = spreadBits(quint32(cell.x())) | (spreadBits(quint32(cell.y())) << 1) | (spreadBits(quint32(cell.z())) << 2);
+            keys[i] = (static_cast<quint64>(code) << 32) | static_cast<quint32>(t);
+        });
+        Parallel::sort(keys, std::less<quint64>());
+        Parallel::forEach(count, [&](qsizetype i) { triangles[span.begin + i] = static_cast<quint32>(keys.at(i)); });
+    }
+
+    QVector<Span> chunks;
+    for (const Span &span : spans) {
+        for (qsizetype begin = span.begin; begin < span.end; begin += kChunkTriangles)
+            chunks.append({begin, qMin(span.end, begin + kChunkTriangles)});
+    }
+    QVector<quint32> order(triangleCount);
+    Parallel::forEach(chunks.size(), [&](qsizetype chunk) {
+        const Span &range = chunks.at(chunk);
+        optimizeChunk(buffer, triangles.constData() + range.begin, range.end - range.begin, center, order.data() + range.begin);
+    }, 1);
+
+    // Vertex fetch: number vertices in the order the reordered index
+    // buffer first touches them; welded-away vertices drop out here.
+    QVector<quint32> remap(vertexCount, std::numeric_limits<quint32>::max());
+    QVector<quint32> source;
+    source.reserve(vertexCount);
+    QVector<unsigned int> indices(triangleCount * 3);
+    for (qsizetype t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = buffer.indices.at(qsizetype(order.at(t)) * 3 + k);
+            if (remap.at(v) == std::numeric_limits<quint32>::max()) {
+                remap[v] = static_cast<quint32>(source.size());
+                source.append(v);
+            }
+            indices[t * 3 + k] = remap.at(v);
+        }
+    }
+
+    auto gather = [&source](auto &values) {
+        using Vector = std::remove_reference_t<decltype(values)>;
+        Vector reordered(source.size());
+        Parallel::forEach(source.size(), [&](qsizetype i) { reordered[i] = values.at(source.at(i)); });
+        values = std::move(reordered);
+    };
+    gather(buffer.positions);
+    if (withNormals)
+        gather(buffer.normals);
+    if (withColors)
+        gather(buffer.colors);
+    if (buffer.faceColors.size() == triangleCount) {
+        QVector<quint16> faceColors(triangleCount);
+        Parallel::forEach(triangleCount, [&](qsizetype t) { faceColors[t] = buffer.faceColors.at(order.at(t)); });
+        buffer.faceColors = std::move(faceColors);
+    }
+    buffer.indices = std::move(indices);
+    buffer.acmrAfter = acmr(buffer.indices, buffer.positions.size());
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+// Reorders a loaded mesh for the GPU's vertex caches without changing how
+// it looks:
+// - bit-identical vertices (position, normal, color) are welded, so that
+//   triangle soups such as STL share their corners;
+// - triangles are grouped into spatial chunks (Morton order of centroids)
+//   and every chunk is reordered concurrently with Forsyth's linear-speed
+//   vertex cache optimization;
+// - each chunk's order is cut into clusters where the cache runs cold, and
+//   clusters facing away from the model center are drawn first to reduce
+//   overdraw;
+// - vertices are renumbered in first-use order for sequential fetch.
+// Triangles never leave their sub-mesh range, and per-triangle colors
+// follow their triangles. The ACMR before and after is stored in the buffer.
+class MeshOptimizer
+{
+public:
+    // Vertex shader invocations per triangle with a FIFO post-transform cache
+    // of `cacheSize` entries; 3.0 for a triangle soup.
+    static float acmr(const QVector<unsigned int> &indices, qsizetype vertexCount, int cacheSize = 16);
+
+    // Leaves the buffer untouched and returns false if an index is out of
+    // range.
+    static bool optimize(MeshBuffer &buffer);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QString>
+#include <QVector3D>
+
+// A contiguous run of triangles in a mesh's index buffer that came from one
+// part of the source file (an Assimp sub-mesh), with its own bounds so it
+// can be culled or hidden on its own.
+struct MeshRange
+{
+    QString name;
+    quint32 firstIndex = 0;
+    quint32 indexCount = 0;
+    QVector3D minBounds;
+    QVector3D maxBounds;
+};
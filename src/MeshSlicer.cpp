@@ -0,0 +1,294 @@
+#include "MeshSlicer.h"
+#include "Parallel.h"
+
+#include <QObject>
+#include <QPair>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kBlockSize = 256;
+constexpr int kLayersPerTask = 8;
+
+struct Segment
+{
+    QVector2D start;
+    QVector2D end;
+};
+
+quint64 pointKey(const QVector2D &p)
+{
+    const float px = p.x();
+    const float py = p.y();
+    quint32 x = 0;
+    quint32 y = 0;
+    std::memcpy(&x, &px, sizeof(float));
+    std::memcpy(&y, &py, sizeof(float));
+    return (static_cast<quint64>(x) << 32) | y;
+}
+
+bool positionLess(const QVector3D &a, const QVector3D &b)
+{
+    if (a.x() != b.x())
+        return a.x() < b.x();
+    if (a.y() != b.y())
+        return a.y() < b.y();
+    return a.z() < b.z();
+}
+
+// Endpoints are ordered canonically so the two triangles sharing an edge
+// produce bit-identical intersection points, which lets segments chain by
+// exact key instead of a distance tolerance.
+QVector2D intersectEdge(QVector3D a, QVector3D b, float z)
+{
+    if (a.z() == z)
+        return QVector2D(a.x(), a.y());
+    if (b.z() == z)
+        return QVector2D(b.x(), b.y());
+    if (positionLess(b, a))
+        std::swap(a, b);
+    // Snap when rounding lands on an endpoint; otherwise the vertex would be
+    // reproduced slightly differently by each edge that meets it.
+    const float t = (z - a.z()) / (b.z() - a.z());
+    if (t <= 0.0f)
+        return QVector2D(a.x(), a.y());
+    if (t >= 1.0f)
+        return QVector2D(b.x(), b.y());
+    return QVector2D(a.x() + (b.x() - a.x()) * t, a.y() + (b.y() - a.y()) * t);
+}
+
+// Vertices exactly on the plane count as above it, so every crossing
+// triangle yields exactly one segment and none yields a point.
+bool intersectTriangle(const QVector3D &a, const QVector3D &b, const QVector3D &c, float z, Segment *segment)
+{
+    const QVector3D v[3] = {a, b, c};
+    QVector2D points[2];
+    int count = 0;
+    for (int k = 0; k < 3; ++k) {
+        const QVector3D &p = v[k];
+        const QVector3D &q = v[(k + 1) % 3];
+        if ((p.z() >= z) != (q.z() >= z))
+            points[count++] = intersectEdge(p, q, z);
+    }
+    if (count != 2 || pointKey(points[0]) == pointKey(points[1]))
+        return false;
+
+    // Orient along (Z x normal) so material lies to the left and outer
+    // contours run counter-clockwise.
+    const QVector3D normal = QVector3D::crossProduct(b - a, c - a);
+    const QVector2D direction(-normal.y(), normal.x());
+    if (QVector2D::dotProduct(points[1] - points[0], direction) < 0.0f)
+        std::swap(points[0], points[1]);
+    segment->start = points[0];
+    segment->end = points[1];
+    return true;
+}
+
+QVector<SliceContour> chainSegments(const QVector<Segment> &segments)
+{
+    QVector<QPair<quint64, int>> starts(segments.size());
+    for (qsizetype i = 0; i < segments.size(); ++i)
+        starts[i] = qMakePair(pointKey(segments.at(i).start), static_cast<int>(i));
+    std::sort(starts.begin(), starts.end());
+
+    auto findNext = [&starts](quint64 key, const QVector<bool> &used) {
+        auto it = std::lower_bound(starts.cbegin(), starts.cend(), qMakePair(key, std::numeric_limits<int>::min()));
+        for (; it != starts.cend() && it->first == key; ++it) {
+            if (!used.at(it->second))
+                return it->second;
+        }
+        return -1;
+    };
+
+    QVector<SliceContour> contours;
+    QVector<bool> used(segments.size(), false);
+    for (qsizetype first = 0; first < segments.size(); ++first) {
+        if (used.at(first))
+            continue;
+        used[first] = true;
+        SliceContour contour;
+        contour.points.append(segments.at(first).start);
+        const quint64 originKey = pointKey(segments.at(first).start);
+        QVector2D end = segments.at(first).end;
+        for (;;) {
+            contour.points.append(end);
+            if (pointKey(end) == originKey) {
+                contour.closed = true;
+                break;
+            }
+            const int next = findNext(pointKey(end), used);
+            if (next < 0)
+                break;
+            used[next] = true;
+            end = segments.at(next).end;
+        }
+        if (contour.points.size() >= 2)
+            contours.append(contour);
+    }
+    return contours;
+}
+
+float signedArea(const QVector<QVector2D> &points)
+{
+    double area = 0.0;
+    for (qsizetype i = 0; i + 1 < points.size(); ++i)
+        area += static_cast<double>(points.at(i).x()) * points.at(i + 1).y() - static_cast<double>(points.at(i + 1).x()) * points.at(i).y();
+    return static_cast<float>(area * 0.5);
+}
+
+void appendCliLayer(QByteArray &out, const SliceLayer &layer)
+{
+    out += "$$LAYER/" + QByteArray::number(layer.z, 'f', 4) + '\n';
+    for (const SliceContour &contour : layer.contours) {
+        // CLI directions: 0 = clockwise (inner), 1 = counter-clockwise (outer), 2 = open.
+        const int direction = !contour.closed ? 2 : (signedArea(contour.points) >= 0.0f ? 1 : 0);
+        out += "$$POLYLINE/1," + QByteArray::number(direction) + ',' + QByteArray::number(contour.points.size());
+        for (const QVector2D &p : contour.points)
+            out += ',' + QByteArray::number(p.x(), 'f', 4) + ',' + QByteArray::number(p.y(), 'f', 4);
+        out += '\n';
+    }
+}
+} // namespace
+
+void MeshSlicer::clear()
+{
+    *this = MeshSlicer();
+}
+
+void MeshSlicer::build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices)
+{
+    clear();
+    const qsizetype triangleCount = indices.size() / 3;
+    if (positions.isEmpty() || triangleCount == 0)
+        return;
+
+    m_positions = positions;
+    m_indices = indices;
+
+    QVector<float> bottoms(triangleCount);
+    QVector<float> tops(triangleCount);
+    Parallel::forEach(triangleCount, [&](qsizetype t) {
+        const float a = positions.at(indices.at(t * 3)).z();
+        const float b = positions.at(indices.at(t * 3 + 1)).z();
+        const float c = positions.at(indices.at(t * 3 + 2)).z();
+        bottoms[t] = qMin(a, qMin(b, c));
+        tops[t] = qMax(a, qMax(b, c));
+    });
+
+    m_triangles.resize(triangleCount);
+    for (qsizetype t = 0; t < triangleCount; ++t)
+        m_triangles[t] = static_cast<quint32>(t);
+    Parallel::sort(m_triangles, [&bottoms](quint32 a, quint32 b) { return bottoms.at(a) < bottoms.at(b); });
+
+    m_bottoms.resize(triangleCount);
+    m_tops.resize(triangleCount);
+    Parallel::forEach(triangleCount, [&](qsizetype i) {
+        m_bottoms[i] = bottoms.at(m_triangles.at(i));
+        m_tops[i] = tops.at(m_triangles.at(i));
+    });
+
+    m_blockTops.resize((triangleCount + kBlockSize - 1) / kBlockSize);
+    Parallel::forEach(m_blockTops.size(), [&](qsizetype block) {
+        const qsizetype end = qMin(triangleCount, (block + 1) * kBlockSize);
+        float top = m_tops.at(block * kBlockSize);
+        for (qsizetype i = block * kBlockSize + 1; i < end; ++i)
+            top = qMax(top, m_tops.at(i));
+        m_blockTops[block] = top;
+    }, 64);
+
+    m_minZ = m_bottoms.first();
+    m_maxZ = *std::max_element(m_blockTops.cbegin(), m_blockTops.cend());
+}
+
+SliceLayer MeshSlicer::slice(float z) const
+{
+    SliceLayer layer;
+    layer.z = z;
+    if (isEmpty() || z < m_minZ || z > m_maxZ)
+        return layer;
+
+    // Only triangles whose bottom is at or below the plane can cross it.
+    const qsizetype candidates = std::upper_bound(m_bottoms.cbegin(), m_bottoms.cend(), z) - m_bottoms.cbegin();
+    QVector<Segment> segments;
+    Segment segment;
+    for (qsizetype block = 0; block * kBlockSize < candidates; ++block) {
+        if (m_blockTops.at(block) < z)
+            continue;
+        const qsizetype end = qMin(candidates, (block + 1) * kBlockSize);
+        for (qsizetype i = block * kBlockSize; i < end; ++i) {
+            if (m_tops.at(i) < z)
+                continue;
+            const qsizetype t = m_triangles.at(i);
+            if (intersectTriangle(m_positions.at(m_indices.at(t * 3)), m_positions.at(m_indices.at(t * 3 + 1)),
+                                  m_positions.at(m_indices.at(t * 3 + 2)), z, &segment))
+                segments.append(segment);
+        }
+    }
+    layer.contours = chainSegments(segments);
+    return layer;
+}
+
+QVector<SliceLayer> MeshSlicer::sliceLayers(float layerHeight) const
+{
+    QVector<SliceLayer> layers;
+    if (isEmpty() || layerHeight <= 0.0f)
+        return layers;
+
+    const int count = qMax(1, static_cast<int>(std::ceil((m_maxZ - m_minZ) / layerHeight)));
+    layers.resize(count);
+    Parallel::forEach(count, [&](qsizetype i) { layers[i] = slice(m_minZ + (static_cast<float>(i) + 0.5f) * layerHeight); }, kLayersPerTask);
+    return layers;
+}
+
+bool MeshSlicer::writeCli(const QString &path, float layerHeight, QString *errorMessage, const ProgressFunction &progress) const
+{
+    if (isEmpty() || layerHeight <= 0.0f) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Nothing to slice.");
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to write file %1").arg(path);
+        return false;
+    }
+
+    const int count = qMax(1, static_cast<int>(std::ceil((m_maxZ - m_minZ) / layerHeight)));
+    QByteArray header = "$$HEADERSTART\n$$ASCII\n$$UNITS/1.0\n$$VERSION/200\n$$LAYERS/" + QByteArray::number(count) +
+                        "\n$$HEADEREND\n$$GEOMETRYSTART\n";
+    bool ok = file.write(header) == header.size();
+
+    // Slice and format batches of layers across cores, then append them in
+    // order, so only one batch of formatted text is held at a time.
+    const int batchSize = qMax(1, QThread::idealThreadCount()) * kLayersPerTask * 4;
+    for (int first = 0; ok && first < count; first += batchSize) {
+        const int batchCount = qMin(batchSize, count - first);
+        QVector<QByteArray> formatted(batchCount);
+        Parallel::forEach(batchCount, [&](qsizetype i) {
+            appendCliLayer(formatted[i], slice(m_minZ + (static_cast<float>(first + i) + 0.5f) * layerHeight));
+        }, kLayersPerTask);
+        for (const QByteArray &layer : formatted)
+            ok = ok && file.write(layer) == layer.size();
+        if (progress && !progress(first + batchCount, count)) {
+            file.cancelWriting();
+            if (errorMessage)
+                *errorMessage = QObject::tr("Export cancelled.");
+            return false;
+        }
+    }
+
+    ok = ok && file.write("$$GEOMETRYEND\n") == 14;
+    if (!ok || !file.commit()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to write %1").arg(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+
+#include <functional>
+
+struct SliceContour
+{
+    QVector<QVector2D> points;
+    bool closed = false;
+};
+
+struct SliceLayer
+{
+    float z = 0.0f;
+    QVector<SliceContour> contours;
+};
+
+// Planar cross-sections perpendicular to the model Z axis. Triangles are
+// sorted by the bottom of their Z extent once; each block of the sorted
+// order also stores the highest top, so a query only visits blocks that
+// can still reach the plane.
+class MeshSlicer
+{
+public:
+    using ProgressFunction = std::function<bool(int finished, int total)>;
+
+    MeshSlicer() = default;
+
+    void build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices);
+    void clear();
+    bool isEmpty() const { return m_triangles.isEmpty(); }
+    float minZ() const { return m_minZ; }
+    float maxZ() const { return m_maxZ; }
+
+    SliceLayer slice(float z) const;
+    // Slices at the middle of every layer of the given height, in parallel.
+    QVector<SliceLayer> sliceLayers(float layerHeight) const;
+    // Writes every layer as Common Layer Interface (ASCII .cli) polylines.
+    bool writeCli(const QString &path, float layerHeight, QString *errorMessage, const ProgressFunction &progress = ProgressFunction()) const;
+
+private:
+    QVector<QVector3D> m_positions;
+    QVector<unsigned int> m_indices;
+    QVector<quint32> m_triangles;
+    QVector<float> m_bottoms;
+    QVector<float> m_tops;
+    QVector<float> m_blockTops;
+    float m_minZ = 0.0f;
+    float m_maxZ = 0.0f;
+};
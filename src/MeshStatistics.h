@@ -1,5 +1,7 @@
 #pragma once
 
+#include "MassProperties.h"
+
 #include <QVector3D>
 #include <QString>
 
@@ -7,8 +9,19 @@ struct MeshStatistics
 {
     QString fileName;
     quint64 triangleCount = 0;
+    int instanceCount = 0;
+    quint64 sceneTriangleCount = 0;
     QVector3D minBounds;
     QVector3D maxBounds;
     QVector3D size;
     bool hasNormals = false;
+    MassProperties mass;
+    // Downward-facing area steeper than overhangThreshold (degrees from
+    // vertical) for the active orientation, at the model's own scale.
+    double overhangArea = 0.0;
+    float overhangThreshold = 45.0f;
+    // Vertex cache misses per triangle as loaded and after optimization;
+    // zero if the mesh was not optimized.
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
 };
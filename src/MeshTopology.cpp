@@ -0,0 +1,132 @@
+#include "MeshTopology.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace
+{
+struct PositionKey
+{
+    quint32 bits[3];
+};
+
+PositionKey positionKey(const QVector3D &p)
+{
+    PositionKey key;
+    for (int axis = 0; axis < 3; ++axis) {
+        // Fold -0.0 onto 0.0 so the two weld together.
+        const float value = p[axis] == 0.0f ? 0.0f : p[axis];
+        std::memcpy(&key.bits[axis], &value, sizeof(float));
+    }
+    return key;
+}
+
+bool keyLess(const PositionKey &a, const PositionKey &b)
+{
+    if (a.bits[0] != b.bits[0])
+        return a.bits[0] < b.bits[0];
+    if (a.bits[1] != b.bits[1])
+        return a.bits[1] < b.bits[1];
+    return a.bits[2] < b.bits[2];
+}
+} // namespace
+
+bool MeshTopology::isCollapsed(quint64 triangle) const
+{
+    const quint32 a = m_welded.at(m_indices.at(triangle * 3));
+    const quint32 b = m_welded.at(m_indices.at(triangle * 3 + 1));
+    const quint32 c = m_welded.at(m_indices.at(triangle * 3 + 2));
+    return a == b || b == c || a == c;
+}
+
+MeshTopology MeshTopology::build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices)
+{
+    MeshTopology topology;
+    const qsizetype cornerCount = indices.size() - indices.size() % 3;
+    if (positions.isEmpty() || cornerCount == 0 || cornerCount > std::numeric_limits<quint32>::max())
+        return topology;
+    for (unsigned int index : indices) {
+        if (index >= static_cast<unsigned int>(positions.size()))
+            return topology;
+    }
+
+    topology.m_indices = indices;
+    topology.m_indices.resize(cornerCount);
+    topology.m_triangleCount = static_cast<quint64>(cornerCount / 3);
+
+    // Weld: sort vertex ids by exact position bits, then number the runs.
+    QVector<PositionKey> keys(positions.size());
+    Parallel::forEach(positions.size(), [&](qsizetype i) { keys[i] = positionKey(positions.at(i)); });
+    QVector<quint32> order(positions.size());
+    for (qsizetype i = 0; i < order.size(); ++i)
+        order[i] = static_cast<quint32>(i);
+    Parallel::sort(order, [&keys](quint32 a, quint32 b) {
+        return keyLess(keys.at(a), keys.at(b)) || (!keyLess(keys.at(b), keys.at(a)) && a < b);
+    });
+
+    topology.m_welded.resize(positions.size());
+    quint32 welded = 0;
+    for (qsizetype i = 0; i < order.size(); ++i) {
+        if (i > 0 && keyLess(keys.at(order.at(i - 1)), keys.at(order.at(i))))
+            ++welded;
+        topology.m_welded[order.at(i)] = welded;
+    }
+    topology.m_vertexCount = welded + 1;
+    keys = QVector<PositionKey>();
+    order = QVector<quint32>();
+
+    // Count half-edges per lower endpoint, prefix-sum into offsets, then
+    // scatter and sort each bucket so equal edges become adjacent runs.
+    const quint32 vertexCount = topology.m_vertexCount;
+    const quint32 *weldedData = topology.m_welded.constData();
+    const unsigned int *indexData = topology.m_indices.constData();
+    std::unique_ptr<std::atomic<quint32>[]> counts(new std::atomic<quint32>[vertexCount]);
+    for (quint32 v = 0; v < vertexCount; ++v)
+        counts[v].store(0, std::memory_order_relaxed);
+
+    auto forEachCorner = [&](auto &&function) {
+        Parallel::forRanges(Parallel::split(static_cast<qsizetype>(topology.m_triangleCount)), [&](const Parallel::Range &range) {
+            for (qsizetype t = range.begin; t < range.end; ++t) {
+                const quint32 w[3] = {weldedData[indexData[t * 3]], weldedData[indexData[t * 3 + 1]], weldedData[indexData[t * 3 + 2]]};
+                if (w[0] == w[1] || w[1] == w[2] || w[0] == w[2])
+                    continue;
+                for (int k = 0; k < 3; ++k)
+                    function(static_cast<quint32>(t * 3 + k), w[k], w[(k + 1) % 3]);
+            }
+        });
+    };
+
+    forEachCorner([&counts](quint32, quint32 a, quint32 b) { counts[qMin(a, b)].fetch_add(1, std::memory_order_relaxed); });
+
+    topology.m_offsets.resize(static_cast<qsizetype>(vertexCount) + 1);
+    quint32 running = 0;
+    for (quint32 v = 0; v < vertexCount; ++v) {
+        topology.m_offsets[v] = running;
+        running += counts[v].exchange(0, std::memory_order_relaxed);
+    }
+    topology.m_offsets[vertexCount] = running;
+
+    topology.m_halfEdges.resize(running);
+    HalfEdge *halfEdges = topology.m_halfEdges.data();
+    const quint32 *offsets = topology.m_offsets.constData();
+    forEachCorner([&counts, halfEdges, offsets](quint32 id, quint32 a, quint32 b) {
+        const quint32 low = qMin(a, b);
+        HalfEdge &entry = halfEdges[offsets[low] + counts[low].fetch_add(1, std::memory_order_relaxed)];
+        entry.other = qMax(a, b);
+        entry.id = id;
+    });
+
+    Parallel::forRanges(topology.edgeRanges(), [halfEdges, offsets](const Parallel::Range &range) {
+        for (qsizetype v = range.begin; v < range.end; ++v) {
+            std::sort(halfEdges + offsets[v], halfEdges + offsets[v + 1], [](const HalfEdge &a, const HalfEdge &b) {
+                return a.other != b.other ? a.other < b.other : a.id < b.id;
+            });
+        }
+    });
+    return topology;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Parallel.h"
+
+#include <QVector>
+#include <QVector3D>
+
+// Welded connectivity of a triangle soup. Vertices with bit-identical
+// positions are merged, and every undirected edge is stored once in a
+// bucket keyed by its lower vertex (a CSR layout filled by a parallel
+// counting sort), which costs 8 bytes per half-edge instead of a node per
+// edge in an ordered map.
+class MeshTopology
+{
+public:
+    struct HalfEdge
+    {
+        quint32 other = 0;
+        // Triangle index * 3 + corner; the half-edge runs from that corner
+        // to the next one in winding order.
+        quint32 id = 0;
+    };
+
+    MeshTopology() = default;
+
+    static MeshTopology build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices);
+
+    bool isEmpty() const { return m_vertexCount == 0; }
+    quint32 vertexCount() const { return m_vertexCount; }
+    quint64 triangleCount() const { return m_triangleCount; }
+
+    // Maps an original vertex index to its welded vertex.
+    quint32 weldedVertex(unsigned int vertex) const { return m_welded.at(vertex); }
+    const QVector<quint32> &weldedVertices() const { return m_welded; }
+    quint32 weldedCorner(quint32 halfEdge) const { return m_welded.at(m_indices.at(halfEdge)); }
+    const QVector<unsigned int> &indices() const { return m_indices; }
+    quint32 nextCorner(quint32 halfEdge) const { return halfEdge - halfEdge % 3 + (halfEdge + 1) % 3; }
+
+    // True if two corners of the triangle weld to the same vertex; such
+    // triangles contribute no edges.
+    bool isCollapsed(quint64 triangle) const;
+
+    QVector<Parallel::Range> edgeRanges() const { return Parallel::split(m_vertexCount, 4096); }
+
+    // Calls function(range, v0, v1, halfEdges, count) for every undirected
+    // edge v0 < v1 whose vertex bucket lies in one of `ranges`, in parallel.
+    template <typename Function>
+    void forEachEdge(const QVector<Parallel::Range> &ranges, Function &&function) const
+    {
+        Parallel::forRanges(ranges, [this, &function](const Parallel::Range &range) {
+            for (qsizetype v = range.begin; v < range.end; ++v) {
+                const quint32 end = m_offsets.at(v + 1);
+                for (quint32 first = m_offsets.at(v); first < end;) {
+                    quint32 last = first + 1;
+                    while (last < end && m_halfEdges.at(last).other == m_halfEdges.at(first).other)
+                        ++last;
+                    function(range, static_cast<quint32>(v), m_halfEdges.at(first).other, m_halfEdges.constData() + first, static_cast<int>(last - first));
+                    first = last;
+                }
+            }
+        });
+    }
+
+private:
+    QVector<unsigned int> m_indices;
+    quint32 m_vertexCount = 0;
+    quint64 m_triangleCount = 0;
+    QVector<quint32> m_welded;
+    QVector<quint32> m_offsets;
+    QVector<HalfEdge> m_halfEdges;
+};
@@ -0,0 +1,165 @@
+#include "MeshValidity.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+constexpr float kDegenerateRatio = 1.0e-6f;
+constexpr qsizetype kMaxHighlightSegments = 1 << 20;
+
+struct EdgeDefects
+{
+    quint64 boundary = 0;
+    quint64 nonManifold = 0;
+    quint64 inconsistent = 0;
+    QVector<quint32> boundaryHalfEdges;
+    QVector<quint32> nonManifoldHalfEdges;
+    QVector<quint32> windingHalfEdges;
+    QVector<quint64> duplicateTriangles;
+};
+
+struct BoundaryEdge
+{
+    quint32 from = 0;
+    quint32 to = 0;
+};
+
+void appendSegment(QVector<QVector3D> &lines, const QVector3D &a, const QVector3D &b)
+{
+    if (lines.size() / 2 >= kMaxHighlightSegments)
+        return;
+    lines.append(a);
+    lines.append(b);
+}
+
+// Chains directed boundary edges into loops; a chain that cannot be closed
+// (e.g. because of flipped neighbours) still counts as one hole.
+quint64 countHoleLoops(QVector<BoundaryEdge> edges)
+{
+    std::sort(edges.begin(), edges.end(), [](const BoundaryEdge &a, const BoundaryEdge &b) {
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+    QVector<bool> used(edges.size(), false);
+    quint64 loops = 0;
+    for (qsizetype start = 0; start < edges.size(); ++start) {
+        if (used.at(start))
+            continue;
+        ++loops;
+        used[start] = true;
+        const quint32 origin = edges.at(start).from;
+        quint32 current = edges.at(start).to;
+        while (current != origin) {
+            auto it = std::lower_bound(edges.cbegin(), edges.cend(), current, [](const BoundaryEdge &edge, quint32 vertex) {
+                return edge.from < vertex;
+            });
+            qsizetype next = it - edges.cbegin();
+            while (next < edges.size() && edges.at(next).from == current && used.at(next))
+                ++next;
+            if (next >= edges.size() || edges.at(next).from != current)
+                break;
+            used[next] = true;
+            current = edges.at(next).to;
+        }
+    }
+    return loops;
+}
+} // namespace
+
+MeshValidityReport MeshValidity::analyze(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices) const
+{
+    return analyze(positions, MeshTopology::build(positions, indices));
+}
+
+MeshValidityReport MeshValidity::analyze(const QVector<QVector3D> &positions, const MeshTopology &topology) const
+{
+    MeshValidityReport report;
+    if (topology.isEmpty())
+        return report;
+
+    const QVector<unsigned int> &indices = topology.indices();
+
+    // Edge classification, one partial result per vertex-bucket range.
+    const QVector<Parallel::Range> edgeRanges = topology.edgeRanges();
+    QVector<EdgeDefects> edgeDefects(edgeRanges.size());
+    topology.forEachEdge(edgeRanges, [&](const Parallel::Range &range, quint32 v0, quint32, const MeshTopology::HalfEdge *halfEdges, int count) {
+        EdgeDefects &defects = edgeDefects[range.index];
+        if (count == 1) {
+            ++defects.boundary;
+            defects.boundaryHalfEdges.append(halfEdges[0].id);
+            return;
+        }
+        if (count > 2) {
+            ++defects.nonManifold;
+            defects.nonManifoldHalfEdges.append(halfEdges[0].id);
+        } else if ((topology.weldedCorner(halfEdges[0].id) == v0) == (topology.weldedCorner(halfEdges[1].id) == v0)) {
+            ++defects.inconsistent;
+            defects.windingHalfEdges.append(halfEdges[0].id);
+        }
+
+        // Two faces sharing an edge and the opposite corner are duplicates;
+        // the later face is reported.
+        for (int i = 0; i < count; ++i) {
+            const quint32 apexI = topology.weldedCorner(topology.nextCorner(topology.nextCorner(halfEdges[i].id)));
+            for (int j = i + 1; j < count; ++j) {
+                if (topology.weldedCorner(topology.nextCorner(topology.nextCorner(halfEdges[j].id))) == apexI)
+                    defects.duplicateTriangles.append(qMax(halfEdges[i].id, halfEdges[j].id) / 3);
+            }
+        }
+    });
+
+    // Degenerate faces: collapsed after welding or with negligible area.
+    const QVector<Parallel::Range> faceRanges = Parallel::split(static_cast<qsizetype>(topology.triangleCount()));
+    QVector<QVector<quint64>> degenerate(faceRanges.size());
+    Parallel::forRanges(faceRanges, [&](const Parallel::Range &range) {
+        for (qsizetype t = range.begin; t < range.end; ++t) {
+            const QVector3D &a = positions.at(indices.at(t * 3));
+            const QVector3D &b = positions.at(indices.at(t * 3 + 1));
+            const QVector3D &c = positions.at(indices.at(t * 3 + 2));
+            const float longest = qMax((b - a).lengthSquared(), qMax((c - b).lengthSquared(), (a - c).lengthSquared()));
+            if (topology.isCollapsed(t) || QVector3D::crossProduct(b - a, c - a).length() <= kDegenerateRatio * longest)
+                degenerate[range.index].append(static_cast<quint64>(t));
+        }
+    });
+
+    QVector<BoundaryEdge> boundary;
+    QVector<quint64> duplicates;
+    auto appendHalfEdge = [&](QVector<QVector3D> &lines, quint32 id) {
+        appendSegment(lines, positions.at(indices.at(id)), positions.at(indices.at(topology.nextCorner(id))));
+    };
+    auto appendTriangle = [&](quint64 t) {
+        for (int k = 0; k < 3; ++k)
+            appendHalfEdge(report.faceLines, static_cast<quint32>(t * 3 + k));
+    };
+
+    for (const EdgeDefects &defects : edgeDefects) {
+        report.boundaryEdges += defects.boundary;
+        report.nonManifoldEdges += defects.nonManifold;
+        report.inconsistentEdges += defects.inconsistent;
+        for (quint32 id : defects.boundaryHalfEdges) {
+            boundary.append({topology.weldedCorner(id), topology.weldedCorner(topology.nextCorner(id))});
+            appendHalfEdge(report.boundaryLines, id);
+        }
+        for (quint32 id : defects.nonManifoldHalfEdges)
+            appendHalfEdge(report.nonManifoldLines, id);
+        for (quint32 id : defects.windingHalfEdges)
+            appendHalfEdge(report.windingLines, id);
+        duplicates += defects.duplicateTriangles;
+    }
+    edgeDefects.clear();
+
+    std::sort(duplicates.begin(), duplicates.end());
+    duplicates.erase(std::unique(duplicates.begin(), duplicates.end()), duplicates.end());
+    report.duplicateTriangles = static_cast<quint64>(duplicates.size());
+    for (quint64 t : duplicates)
+        appendTriangle(t);
+
+    for (const QVector<quint64> &faces : degenerate) {
+        report.degenerateTriangles += static_cast<quint64>(faces.size());
+        for (quint64 t : faces)
+            appendTriangle(t);
+    }
+
+    report.holeLoops = countHoleLoops(std::move(boundary));
+    return report;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MeshTopology.h"
+
+#include <QVector>
+#include <QVector3D>
+
+struct MeshValidityReport
+{
+    quint64 boundaryEdges = 0;
+    quint64 holeLoops = 0;
+    quint64 nonManifoldEdges = 0;
+    quint64 inconsistentEdges = 0;
+    quint64 degenerateTriangles = 0;
+    quint64 duplicateTriangles = 0;
+
+    bool isWatertight() const { return boundaryEdges == 0 && nonManifoldEdges == 0; }
+    bool isClean() const
+    {
+        return isWatertight() && inconsistentEdges == 0 && degenerateTriangles == 0 && duplicateTriangles == 0;
+    }
+
+    // Model-space line segments (consecutive endpoint pairs) outlining each
+    // defect class, capped so heavily broken scans stay drawable.
+    QVector<QVector3D> boundaryLines;
+    QVector<QVector3D> nonManifoldLines;
+    QVector<QVector3D> windingLines;
+    QVector<QVector3D> faceLines;
+};
+
+class MeshValidity
+{
+public:
+    MeshValidity() = default;
+
+    MeshValidityReport analyze(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices) const;
+    MeshValidityReport analyze(const QVector<QVector3D> &positions, const MeshTopology &topology) const;
+};
@@ -0,0 +1,565 @@
+#include "NativeMeshFormat.h"
+#include "Parallel.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QObject>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+constexpr char kMagic[8] = {'S', 'T', 'L', 'V', 'M', 'S', 'H', '\x1a'};
+constexpr quint32 kVersion = 1;
+constexpr quint32 kFlagNormals = 0x1;
+// Chunks are zstd frames instead of qCompress (zlib) streams.
+constexpr quint32 kFlagZstd = 0x2;
+constexpr qsizetype kVerticesPerChunk = 1 << 16;
+constexpr qsizetype kIndicesPerChunk = 3 << 16;
+constexpr float kQuantizationSteps = 65535.0f;
+// Size of one chunk table entry, and the most each codec can expand a
+// chunk: deflate tops out near 1032:1, zstd at one 128 KiB RLE block per
+// 4 bytes. qCompress streams start with a 4 byte length prefix, zstd
+// frames with a 4 byte magic number.
+constexpr qint64 kChunkEntryBytes = 8;
+constexpr qint64 kMaxInflateRatio = 1032;
+constexpr qint64 kMaxZstdRatio = 32768;
+constexpr qint64 kSizePrefixBytes = 4;
+constexpr qint64 kMaxVarintBytes = 10;
+#ifdef HAVE_ZSTD
+constexpr quint32 kChunkCodecFlag = kFlagZstd;
+constexpr int kCompressionLevel = 3;
+#else
+constexpr quint32 kChunkCodecFlag = 0;
+constexpr int kCompressionLevel = 6;
+#endif
+
+struct ChunkEntry
+{
+    quint32 elementCount = 0;
+    quint32 compressedSize = 0;
+    qint64 fileOffset = 0;
+    qsizetype firstElement = 0;
+};
+
+float signNotZero(float v)
+{
+    return v < 0.0f ? -1.0f : 1.0f;
+}
+
+quint32 encodeNormal(const QVector3D &n)
+{
+    const float l1 = qAbs(n.x()) + qAbs(n.y()) + qAbs(n.z());
+    float x = 0.0f;
+    float y = 0.0f;
+    if (l1 > 0.0f) {
+        x = n.x() / l1;
+        y = n.y() / l1;
+        if (n.z() < 0.0f) {
+            const float ox = x;
+            x = (1.0f - qAbs(y)) * signNotZero(ox);
+            y = (1.0f - qAbs(ox)) * signNotZero(y);
+        }
+    }
+    const auto ex = static_cast<qint16>(qRound(qBound(-1.0f, x, 1.0f) * 32767.0f));
+    const auto ey = static_cast<qint16>(qRound(qBound(-1.0f, y, 1.0f) * 32767.0f));
+    return static_cast<quint32>(static_cast<quint16>(ex)) | (static_cast<quint32>(static_cast<quint16>(ey)) << 16);
+}
+
+QVector3D decodeNormal(qint16 ex, qint16 ey)
+{
+    float x = ex / 32767.0f;
+    float y = ey / 32767.0f;
+    const float z = 1.0f - qAbs(x) - qAbs(y);
+    if (z < 0.0f) {
+        const float ox = x;
+        x = (1.0f - qAbs(y)) * signNotZero(ox);
+        y = (1.0f - qAbs(ox)) * signNotZero(y);
+    }
+    QVector3D n(x, y, z);
+    if (!n.isNull())
+        n.normalize();
+    return n;
+}
+
+quint16 quantize(float value, float min, float extent)
+{
+    if (extent <= 0.0f)
+        return 0;
+    return static_cast<quint16>(qBound(0.0f, (value - min) / extent * kQuantizationSteps + 0.5f, kQuantizationSteps));
+}
+
+void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+bool readVarint(const uchar *&cursor, const uchar *end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        const uchar byte = *cursor++;
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+template <typename T>
+void appendLittleEndian(QByteArray &out, T value)
+{
+    const T le = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&le), sizeof(T));
+}
+
+// zstd decodes several times faster than zlib at a similar ratio; builds
+// without it fall back to qCompress. Returns an empty array on failure.
+QByteArray compressChunk(const QByteArray &raw)
+{
+#ifdef HAVE_ZSTD
+    QByteArray out(static_cast<qsizetype>(ZSTD_compressBound(raw.size())), Qt::Uninitialized);
+    const size_t size = ZSTD_compress(out.data(), out.size(), raw.constData(), raw.size(), kCompressionLevel);
+    if (ZSTD_isError(size))
+        return {};
+    out.resize(static_cast<qsizetype>(size));
+    return out;
+#else
+    return qCompress(raw, kCompressionLevel);
+#endif
+}
+
+// The decoded size a chunk records about itself (the qCompress prefix or
+// the zstd frame's content size), or -1 if it records none. Read before
+// decoding so a corrupt chunk cannot make the decoder allocate at will.
+qint64 storedSize(const uchar *chunk, quint32 size, bool zstd)
+{
+    if (size < kSizePrefixBytes)
+        return -1;
+    if (!zstd)
+        return qFromBigEndian<quint32>(chunk);
+#ifdef HAVE_ZSTD
+    const unsigned long long content = ZSTD_getFrameContentSize(chunk, size);
+    if (content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR || content > std::numeric_limits<quint32>::max())
+        return -1;
+    return static_cast<qint64>(content);
+#else
+    return -1;
+#endif
+}
+
+// `rawSize` comes from storedSize and has been checked by the caller.
+QByteArray decompressChunk(const uchar *chunk, quint32 size, qint64 rawSize, bool zstd)
+{
+    if (!zstd)
+        return qUncompress(chunk, size);
+#ifdef HAVE_ZSTD
+    QByteArray raw(static_cast<qsizetype>(rawSize), Qt::Uninitialized);
+    const size_t written = ZSTD_decompress(raw.data(), raw.size(), chunk, size);
+    if (ZSTD_isError(written) || written != static_cast<size_t>(rawSize))
+        return {};
+    return raw;
+#else
+    Q_UNUSED(rawSize);
+    return {};
+#endif
+}
+
+QVector<ChunkEntry> makeChunks(qsizetype count, qsizetype perChunk)
+{
+    QVector<ChunkEntry> chunks;
+    for (qsizetype first = 0; first < count; first += perChunk) {
+        ChunkEntry entry;
+        entry.firstElement = first;
+        entry.elementCount = static_cast<quint32>(qMin(perChunk, count - first));
+        chunks.append(entry);
+    }
+    return chunks;
+}
+} // namespace
+
+bool NativeMeshFormat::canRead(const QByteArray &header)
+{
+    return header.size() >= static_cast<qsizetype>(sizeof(kMagic)) &&
+           std::memcmp(header.constData(), kMagic, sizeof(kMagic)) == 0;
+}
+
+bool NativeMeshFormat::readCounts(const QByteArray &header, quint32 *vertexCount, quint32 *indexCount)
+{
+    // Magic, version and flags come first.
+    if (!canRead(header) || header.size() < kCountsHeaderSize)
+        return false;
+    const auto *counts = reinterpret_cast<const uchar *>(header.constData()) + sizeof(kMagic) + 8;
+    *vertexCount = qFromLittleEndian<quint32>(counts);
+    *indexCount = qFromLittleEndian<quint32>(counts + 4);
+    return true;
+}
+
+bool NativeMeshFormat::write(const QString &path, const MeshBuffer &buffer, QString *errorMessage) const
+{
+    if (buffer.positions.isEmpty() || buffer.indices.isEmpty()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("No geometry to export.");
+        return false;
+    }
+
+    const bool storeNormals = buffer.hasNormals && buffer.normals.size() == buffer.positions.size();
+
+    QVector3D minBounds = buffer.positions.first();
+    QVector3D maxBounds = buffer.positions.first();
+    for (const QVector3D &p : buffer.positions) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minBounds[axis] = qMin(minBounds[axis], p[axis]);
+            maxBounds[axis] = qMax(maxBounds[axis], p[axis]);
+        }
+    }
+    const QVector3D extent = maxBounds - minBounds;
+
+    struct WeldKey
+    {
+        quint64 position;
+        quint32 normal;
+        quint32 vertex;
+    };
+
+    const qsizetype sourceVertexCount = buffer.positions.size();
+    QVector<WeldKey> keys(sourceVertexCount);
+    Parallel::forEach(sourceVertexCount, [&](qsizetype i) {
+        const QVector3D &p = buffer.positions.at(i);
+        WeldKey &key = keys[i];
+        key.position = static_cast<quint64>(quantize(p.x(), minBounds.x(), extent.x())) |
+                       (static_cast<quint64>(quantize(p.y(), minBounds.y(), extent.y())) << 16) |
+                       (static_cast<quint64>(quantize(p.z(), minBounds.z(), extent.z())) << 32);
+        key.normal = storeNormals ? encodeNormal(buffer.normals.at(i)) : 0;
+        key.vertex = static_cast<quint32>(i);
+    });
+    std::sort(keys.begin(), keys.end(), [](const WeldKey &a, const WeldKey &b) {
+        if (a.position != b.position)
+            return a.position < b.position;
+        if (a.normal != b.normal)
+            return a.normal < b.normal;
+        return a.vertex < b.vertex;
+    });
+
+    QVector<quint32> representative(sourceVertexCount);
+    for (qsizetype i = 0; i < keys.size();) {
+        qsizetype j = i;
+        while (j < keys.size() && keys.at(j).position == keys.at(i).position && keys.at(j).normal == keys.at(i).normal) {
+            representative[keys.at(j).vertex] = keys.at(i).vertex;
+            ++j;
+        }
+        i = j;
+    }
+
+    const quint32 unassigned = 0xffffffffu;
+    QVector<quint32> remap(sourceVertexCount, unassigned);
+    QVector<quint32> order;
+    QVector<unsigned int> indices;
+    indices.reserve(buffer.indices.size());
+    for (unsigned int index : buffer.indices) {
+        if (index >= static_cast<unsigned int>(sourceVertexCount)) {
+            if (errorMessage)
+                *errorMessage = QObject::tr("Mesh contains out-of-range indices.");
+            return false;
+        }
+        const quint32 rep = representative.at(index);
+        if (remap.at(rep) == unassigned) {
+            remap[rep] = static_cast<quint32>(order.size());
+            order.append(rep);
+        }
+        indices.append(remap.at(rep));
+    }
+
+    QVector<quint64> quantized(order.size());
+    QVector<quint32> encodedNormals(storeNormals ? order.size() : 0);
+    Parallel::forEach(order.size(), [&](qsizetype i) {
+        const QVector3D &p = buffer.positions.at(order.at(i));
+        quantized[i] = static_cast<quint64>(quantize(p.x(), minBounds.x(), extent.x())) |
+                       (static_cast<quint64>(quantize(p.y(), minBounds.y(), extent.y())) << 16) |
+                       (static_cast<quint64>(quantize(p.z(), minBounds.z(), extent.z())) << 32);
+        if (storeNormals)
+            encodedNormals[i] = encodeNormal(buffer.normals.at(order.at(i)));
+    });
+
+    QVector<ChunkEntry> vertexChunks = makeChunks(order.size(), kVerticesPerChunk);
+    QVector<ChunkEntry> indexChunks = makeChunks(indices.size(), kIndicesPerChunk);
+    QVector<QByteArray> vertexPayloads(vertexChunks.size());
+    QVector<QByteArray> indexPayloads(indexChunks.size());
+
+    Parallel::forEach(vertexChunks.size(), [&](qsizetype c) {
+        const ChunkEntry &chunk = vertexChunks.at(c);
+        QByteArray raw;
+        raw.reserve(chunk.elementCount * (storeNormals ? 10 : 6));
+        for (int component = 0; component < 3; ++component) {
+            for (quint32 i = 0; i < chunk.elementCount; ++i)
+                appendLittleEndian<quint16>(raw, static_cast<quint16>(quantized.at(chunk.firstElement + i) >> (16 * component)));
+        }
+        if (storeNormals) {
+            for (int component = 0; component < 2; ++component) {
+                for (quint32 i = 0; i < chunk.elementCount; ++i)
+                    appendLittleEndian<quint16>(raw, static_cast<quint16>(encodedNormals.at(chunk.firstElement + i) >> (16 * component)));
+            }
+        }
+        vertexPayloads[c] = compressChunk(raw);
+    }, 1);
+
+    Parallel::forEach(indexChunks.size(), [&](qsizetype c) {
+        const ChunkEntry &chunk = indexChunks.at(c);
+        QByteArray raw;
+        raw.reserve(chunk.elementCount * 2);
+        qint64 previous = 0;
+        for (quint32 i = 0; i < chunk.elementCount; ++i) {
+            const qint64 current = indices.at(chunk.firstElement + i);
+            const qint64 delta = current - previous;
+            appendVarint(raw, static_cast<quint64>((delta << 1) ^ (delta >> 63)));
+            previous = current;
+        }
+        indexPayloads[c] = compressChunk(raw);
+    }, 1);
+
+    const auto isEmpty = [](const QByteArray &payload) { return payload.isEmpty(); };
+    if (std::any_of(vertexPayloads.cbegin(), vertexPayloads.cend(), isEmpty) ||
+        std::any_of(indexPayloads.cbegin(), indexPayloads.cend(), isEmpty)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to compress mesh data.");
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to write file %1").arg(path);
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream.writeRawData(kMagic, sizeof(kMagic));
+    stream << kVersion << ((storeNormals ? kFlagNormals : 0u) | kChunkCodecFlag);
+    stream << static_cast<quint32>(order.size()) << static_cast<quint32>(indices.size());
+    stream << minBounds.x() << minBounds.y() << minBounds.z();
+    stream << maxBounds.x() << maxBounds.y() << maxBounds.z();
+    stream << static_cast<quint32>(vertexChunks.size()) << static_cast<quint32>(indexChunks.size());
+    for (qsizetype c = 0; c < vertexChunks.size(); ++c)
+        stream << vertexChunks.at(c).elementCount << static_cast<quint32>(vertexPayloads.at(c).size());
+    for (qsizetype c = 0; c < indexChunks.size(); ++c)
+        stream << indexChunks.at(c).elementCount << static_cast<quint32>(indexPayloads.at(c).size());
+    for (const QByteArray &payload : vertexPayloads)
+        stream.writeRawData(payload.constData(), payload.size());
+    for (const QByteArray &payload : indexPayloads)
+        stream.writeRawData(payload.constData(), payload.size());
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to write %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+MeshBuffer NativeMeshFormat::read(const QString &path, QString *errorMessage) const
+{
+    MeshBuffer buffer;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to open file %1").arg(path);
+        return buffer;
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    char magic[sizeof(kMagic)];
+    quint32 version = 0;
+    quint32 flags = 0;
+    quint32 vertexCount = 0;
+    quint32 indexCount = 0;
+    float minX, minY, minZ, maxX, maxY, maxZ;
+    quint32 vertexChunkCount = 0;
+    quint32 indexChunkCount = 0;
+
+    if (stream.readRawData(magic, sizeof(magic)) != sizeof(magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Not a native mesh file.");
+        return buffer;
+    }
+    stream >> version >> flags >> vertexCount >> indexCount;
+    stream >> minX >> minY >> minZ >> maxX >> maxY >> maxZ;
+    stream >> vertexChunkCount >> indexChunkCount;
+    if (stream.status() != QDataStream::Ok || version != kVersion || indexCount % 3 != 0) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unsupported native mesh header.");
+        return buffer;
+    }
+
+    // Every count below comes from the file, so nothing is allocated before
+    // the bytes that back it are known to be there.
+    if ((static_cast<qint64>(vertexChunkCount) + indexChunkCount) * kChunkEntryBytes > file.size() - file.pos()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unexpected end of native mesh file.");
+        return buffer;
+    }
+
+    const bool zstd = flags & kFlagZstd;
+#ifndef HAVE_ZSTD
+    if (zstd) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("This build has no zstd support.");
+        return buffer;
+    }
+#endif
+
+    QVector<ChunkEntry> vertexChunks(vertexChunkCount);
+    QVector<ChunkEntry> indexChunks(indexChunkCount);
+    const bool hasNormals = flags & kFlagNormals;
+    const qint64 vertexStride = hasNormals ? 10 : 6;
+    // A delta-coded index takes at least one varint byte.
+    const qint64 indexStride = 1;
+    const qint64 maxRatio = zstd ? kMaxZstdRatio : kMaxInflateRatio;
+    auto fits = [maxRatio](const ChunkEntry &chunk, qsizetype maxElements, qint64 stride) {
+        return chunk.elementCount <= maxElements && chunk.compressedSize >= kSizePrefixBytes &&
+               chunk.elementCount * stride <= qMax<qint64>(static_cast<qint64>(chunk.compressedSize) - kSizePrefixBytes, 0) * maxRatio;
+    };
+    qint64 offset = 0;
+    qsizetype element = 0;
+    bool valid = true;
+    for (ChunkEntry &chunk : vertexChunks) {
+        stream >> chunk.elementCount >> chunk.compressedSize;
+        chunk.firstElement = element;
+        element += chunk.elementCount;
+        valid = valid && fits(chunk, kVerticesPerChunk, vertexStride);
+    }
+    if (!valid || element != vertexCount) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Corrupt native mesh vertex table.");
+        return buffer;
+    }
+    element = 0;
+    for (ChunkEntry &chunk : indexChunks) {
+        stream >> chunk.elementCount >> chunk.compressedSize;
+        chunk.firstElement = element;
+        element += chunk.elementCount;
+        valid = valid && fits(chunk, kIndicesPerChunk, indexStride);
+    }
+    if (stream.status() != QDataStream::Ok || !valid || element != indexCount) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Corrupt native mesh index table.");
+        return buffer;
+    }
+
+    offset = file.pos();
+    for (ChunkEntry &chunk : vertexChunks) {
+        chunk.fileOffset = offset;
+        offset += chunk.compressedSize;
+    }
+    for (ChunkEntry &chunk : indexChunks) {
+        chunk.fileOffset = offset;
+        offset += chunk.compressedSize;
+    }
+    if (offset > file.size()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unexpected end of native mesh file.");
+        return buffer;
+    }
+
+    QByteArray fallback;
+    const uchar *data = file.map(0, file.size());
+    if (!data) {
+        file.seek(0);
+        fallback = file.readAll();
+        data = reinterpret_cast<const uchar *>(fallback.constData());
+    }
+
+    auto rawSize = [&](const ChunkEntry &chunk) { return storedSize(data + chunk.fileOffset, chunk.compressedSize, zstd); };
+
+    const QVector3D minBounds(minX, minY, minZ);
+    const QVector3D scale = (QVector3D(maxX, maxY, maxZ) - minBounds) / kQuantizationSteps;
+
+    buffer.positions.resize(vertexCount);
+    if (hasNormals)
+        buffer.normals.resize(vertexCount);
+    buffer.indices.resize(indexCount);
+    QVector3D *positions = buffer.positions.data();
+    QVector3D *normals = hasNormals ? buffer.normals.data() : nullptr;
+    unsigned int *indices = buffer.indices.data();
+    std::atomic<bool> failed = false;
+
+    Parallel::forEach(vertexChunks.size(), [&](qsizetype c) {
+        const ChunkEntry &chunk = vertexChunks.at(c);
+        const qsizetype n = chunk.elementCount;
+        const qint64 size = rawSize(chunk);
+        if (size != n * vertexStride) {
+            failed = true;
+            return;
+        }
+        const QByteArray raw = decompressChunk(data + chunk.fileOffset, chunk.compressedSize, size, zstd);
+        if (raw.size() != n * vertexStride) {
+            failed = true;
+            return;
+        }
+        const auto *words = reinterpret_cast<const uchar *>(raw.constData());
+        for (qsizetype i = 0; i < n; ++i) {
+            const float x = qFromLittleEndian<quint16>(words + 2 * i);
+            const float y = qFromLittleEndian<quint16>(words + 2 * (n + i));
+            const float z = qFromLittleEndian<quint16>(words + 2 * (2 * n + i));
+            positions[chunk.firstElement + i] = minBounds + QVector3D(x, y, z) * scale;
+            if (normals) {
+                const auto ex = static_cast<qint16>(qFromLittleEndian<quint16>(words + 2 * (3 * n + i)));
+                const auto ey = static_cast<qint16>(qFromLittleEndian<quint16>(words + 2 * (4 * n + i)));
+                normals[chunk.firstElement + i] = decodeNormal(ex, ey);
+            }
+        }
+    }, 1);
+
+    Parallel::forEach(indexChunks.size(), [&](qsizetype c) {
+        const ChunkEntry &chunk = indexChunks.at(c);
+        const qint64 size = rawSize(chunk);
+        if (size < chunk.elementCount || size > chunk.elementCount * kMaxVarintBytes) {
+            failed = true;
+            return;
+        }
+        const QByteArray raw = decompressChunk(data + chunk.fileOffset, chunk.compressedSize, size, zstd);
+        const auto *cursor = reinterpret_cast<const uchar *>(raw.constData());
+        const uchar *end = cursor + raw.size();
+        qint64 previous = 0;
+        for (quint32 i = 0; i < chunk.elementCount; ++i) {
+            quint64 zigzag = 0;
+            if (!readVarint(cursor, end, zigzag)) {
+                failed = true;
+                return;
+            }
+            const qint64 current = previous + (static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1));
+            if (current < 0 || current >= static_cast<qint64>(vertexCount)) {
+                failed = true;
+                return;
+            }
+            indices[chunk.firstElement + i] = static_cast<unsigned int>(current);
+            previous = current;
+        }
+    }, 1);
+
+    if (failed) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Corrupt native mesh data in %1").arg(path);
+        return {};
+    }
+
+    buffer.hasNormals = hasNormals;
+    return buffer;
+}
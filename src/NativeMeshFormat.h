@@ -0,0 +1,21 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QByteArray>
+
+class NativeMeshFormat
+{
+public:
+    NativeMeshFormat() = default;
+
+    static bool canRead(const QByteArray &header);
+    // Vertex and index counts from the first kCountsHeaderSize bytes of a
+    // native file, for sizing work before reading it.
+    static constexpr qsizetype kCountsHeaderSize = 24;
+    static bool readCounts(const QByteArray &header, quint32 *vertexCount, quint32 *indexCount);
+    static QString fileSuffix() { return QStringLiteral("stlvm"); }
+
+    MeshBuffer read(const QString &path, QString *errorMessage) const;
+    bool write(const QString &path, const MeshBuffer &buffer, QString *errorMessage) const;
+};
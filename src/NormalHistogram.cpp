@@ -0,0 +1,89 @@
+#include "NormalHistogram.h"
+#include "Parallel.h"
+
+namespace
+{
+constexpr int kResolution = 64;
+constexpr int kBinCount = kResolution * kResolution;
+
+int binIndex(const QVector3D &n)
+{
+    const float l1 = qAbs(n.x()) + qAbs(n.y()) + qAbs(n.z());
+    float x = n.x() / l1;
+    float y = n.y() / l1;
+    if (n.z() < 0.0f) {
+        const float ox = x;
+        x = (1.0f - qAbs(y)) * (ox < 0.0f ? -1.0f : 1.0f);
+        y = (1.0f - qAbs(ox)) * (y < 0.0f ? -1.0f : 1.0f);
+    }
+    const int u = qBound(0, static_cast<int>((x * 0.5f + 0.5f) * kResolution), kResolution - 1);
+    const int v = qBound(0, static_cast<int>((y * 0.5f + 0.5f) * kResolution), kResolution - 1);
+    return v * kResolution + u;
+}
+
+struct Bins
+{
+    QVector<double> areas = QVector<double>(kBinCount, 0.0);
+    QVector<QVector3D> normals = QVector<QVector3D>(kBinCount);
+};
+} // namespace
+
+void NormalHistogram::build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices)
+{
+    m_areas.clear();
+    m_normals.clear();
+    const qsizetype triangleCount = indices.size() / 3;
+    if (positions.isEmpty() || triangleCount == 0)
+        return;
+
+    // Large chunks keep the number of per-range histograms small.
+    const QVector<Parallel::Range> ranges = Parallel::split(triangleCount, 1 << 18);
+    QVector<Bins> partials(ranges.size());
+    const auto vertexCount = static_cast<unsigned int>(positions.size());
+    Parallel::forRanges(ranges, [&](const Parallel::Range &range) {
+        Bins &bins = partials[range.index];
+        for (qsizetype t = range.begin; t < range.end; ++t) {
+            const unsigned int i0 = indices.at(t * 3);
+            const unsigned int i1 = indices.at(t * 3 + 1);
+            const unsigned int i2 = indices.at(t * 3 + 2);
+            if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+                continue;
+            const QVector3D &a = positions.at(i0);
+            const QVector3D cross = QVector3D::crossProduct(positions.at(i1) - a, positions.at(i2) - a);
+            const float doubleArea = cross.length();
+            if (doubleArea <= 0.0f)
+                continue;
+            const int bin = binIndex(cross / doubleArea);
+            bins.areas[bin] += 0.5 * doubleArea;
+            bins.normals[bin] += cross * 0.5f;
+        }
+    });
+
+    m_areas = partials.first().areas;
+    QVector<QVector3D> sums = partials.first().normals;
+    for (qsizetype i = 1; i < partials.size(); ++i) {
+        for (int bin = 0; bin < kBinCount; ++bin) {
+            m_areas[bin] += partials.at(i).areas.at(bin);
+            sums[bin] += partials.at(i).normals.at(bin);
+        }
+    }
+    m_normals.resize(kBinCount);
+    for (int bin = 0; bin < kBinCount; ++bin)
+        m_normals[bin] = sums.at(bin).normalized();
+}
+
+double NormalHistogram::area(const QMatrix3x3 &normalMatrix, const QVector3D &direction, float minCosine) const
+{
+    double total = 0.0;
+    for (qsizetype bin = 0; bin < m_areas.size(); ++bin) {
+        if (m_areas.at(bin) <= 0.0)
+            continue;
+        const QVector3D &n = m_normals.at(bin);
+        QVector3D mapped;
+        for (int row = 0; row < 3; ++row)
+            mapped[row] = normalMatrix(row, 0) * n.x() + normalMatrix(row, 1) * n.y() + normalMatrix(row, 2) * n.z();
+        if (QVector3D::dotProduct(mapped.normalized(), direction) > minCosine)
+            total += m_areas.at(bin);
+    }
+    return total;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QGenericMatrix>
+#include <QVector>
+#include <QVector3D>
+
+// Area-weighted histogram of face normals over an octahedral grid. Each bin
+// keeps its total area and area-weighted mean normal, so orientation
+// dependent measures (such as overhang area) can be re-evaluated for any
+// rotation by visiting a few thousand bins instead of every triangle.
+class NormalHistogram
+{
+public:
+    NormalHistogram() = default;
+
+    void build(const QVector<QVector3D> &positions, const QVector<unsigned int> &indices);
+    bool isEmpty() const { return m_areas.isEmpty(); }
+
+    // Total area of faces whose normal, mapped by `normalMatrix`, satisfies
+    // dot(normal, direction) > minCosine.
+    double area(const QMatrix3x3 &normalMatrix, const QVector3D &direction, float minCosine) const;
+
+private:
+    QVector<double> m_areas;
+    QVector<QVector3D> m_normals;
+};
@@ -0,0 +1,338 @@
+#include "OBJParser.h"
+#include "Parallel.h"
+
+#include <QFile>
+#include <QObject>
+
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kChunkSize = 1 << 22;
+constexpr qint32 kNoIndex = std::numeric_limits<qint32>::min();
+
+// Records of one line-aligned slice of the file. Relative (negative)
+// indices are resolved against this chunk's own counts and listed, so the
+// merge pass can add the number of records in the preceding chunks.
+struct Chunk
+{
+    QVector<QVector3D> positions;
+    QVector<quint32> colors;
+    QVector<QVector3D> normals;
+    QVector<qint32> corners; // three per triangle
+    QVector<qint32> cornerNormals;
+    QVector<qsizetype> relativePositions;
+    QVector<qsizetype> relativeNormals;
+    bool allColored = true;
+    bool allNormals = true;
+    bool failed = false;
+};
+
+struct PolygonCorner
+{
+    qint32 position = 0;
+    qint32 normal = kNoIndex;
+    bool relativePosition = false;
+    bool relativeNormal = false;
+};
+
+inline const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    return p;
+}
+
+inline bool readFloat(const char *&p, const char *end, float *value)
+{
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+')
+        ++p;
+    const std::from_chars_result result = std::from_chars(p, end, *value);
+    if (result.ptr == p)
+        return false;
+    if (result.ec == std::errc::result_out_of_range)
+        *value = 0.0f;
+    p = result.ptr;
+    return true;
+}
+
+inline bool readInt(const char *&p, const char *end, long long *value)
+{
+    const std::from_chars_result result = std::from_chars(p, end, *value);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+// One "v", "v/vt", "v//vn" or "v/vt/vn" face corner; texture indices are
+// skipped and a missing normal is reported as 0.
+bool readCorner(const char *&p, const char *end, long long *position, long long *normal)
+{
+    *normal = 0;
+    if (!readInt(p, end, position))
+        return false;
+    if (p < end && *p == '/') {
+        ++p;
+        long long texture = 0;
+        if (p < end && *p != '/' && !readInt(p, end, &texture))
+            return false;
+        if (p < end && *p == '/') {
+            ++p;
+            if (!readInt(p, end, normal))
+                return false;
+        }
+    }
+    return p >= end || *p == ' ' || *p == '\t' || *p == '\r';
+}
+
+// Maps a 1-based or negative OBJ index to a 0-based one; relative indices
+// stay chunk-local and are flagged.
+inline bool resolveIndex(long long index, qsizetype localCount, qint32 *resolved, bool *relative)
+{
+    if (index > 0 && index <= std::numeric_limits<qint32>::max()) {
+        *resolved = static_cast<qint32>(index - 1);
+        *relative = false;
+        return true;
+    }
+    if (index < 0 && -index <= std::numeric_limits<qint32>::max()) {
+        *resolved = static_cast<qint32>(localCount + index);
+        *relative = true;
+        return true;
+    }
+    return false;
+}
+
+void parseChunk(const char *begin, const char *end, Chunk *chunk)
+{
+    QVector<PolygonCorner> polygon;
+    for (const char *line = begin; line < end;) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        if (!lineEnd)
+            lineEnd = end;
+        const char *p = skipSpaces(line, lineEnd);
+        line = lineEnd + 1;
+        if (lineEnd - p < 2)
+            continue;
+
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            float values[7];
+            int count = 0;
+            while (count < 7 && readFloat(p, lineEnd, &values[count]))
+                ++count;
+            if (count < 3) {
+                chunk->failed = true;
+                return;
+            }
+            chunk->positions.append(QVector3D(values[0], values[1], values[2]));
+            // "v x y z r g b" is a common vertex color extension; a fourth
+            // value alone is the rational weight.
+            if (count == 6) {
+                quint32 rgba = 0xff000000u;
+                for (int channel = 0; channel < 3; ++channel)
+                    rgba |= static_cast<quint32>(qBound(0.0f, values[3 + channel] * 255.0f + 0.5f, 255.0f)) << (8 * channel);
+                chunk->colors.append(rgba);
+            } else {
+                chunk->allColored = false;
+                chunk->colors.append(0);
+            }
+        } else if (p[0] == 'v' && p[1] == 'n' && lineEnd - p >= 3 && (p[2] == ' ' || p[2] == '\t')) {
+            p += 3;
+            float values[3];
+            for (float &value : values) {
+                if (!readFloat(p, lineEnd, &value)) {
+                    chunk->failed = true;
+                    return;
+                }
+            }
+            chunk->normals.append(QVector3D(values[0], values[1], values[2]).normalized());
+        } else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            polygon.clear();
+            for (p = skipSpaces(p, lineEnd); p < lineEnd && *p != '#'; p = skipSpaces(p, lineEnd)) {
+                long long position = 0;
+                long long normal = 0;
+                PolygonCorner corner;
+                if (!readCorner(p, lineEnd, &position, &normal) ||
+                    !resolveIndex(position, chunk->positions.size(), &corner.position, &corner.relativePosition)) {
+                    chunk->failed = true;
+                    return;
+                }
+                if (normal == 0) {
+                    chunk->allNormals = false;
+                } else if (!resolveIndex(normal, chunk->normals.size(), &corner.normal, &corner.relativeNormal)) {
+                    chunk->failed = true;
+                    return;
+                }
+                polygon.append(corner);
+            }
+            for (qsizetype k = 1; k + 1 < polygon.size(); ++k) {
+                for (const PolygonCorner &corner : {polygon.at(0), polygon.at(k), polygon.at(k + 1)}) {
+                    if (corner.relativePosition)
+                        chunk->relativePositions.append(chunk->corners.size());
+                    if (corner.relativeNormal)
+                        chunk->relativeNormals.append(chunk->corners.size());
+                    chunk->corners.append(corner.position);
+                    chunk->cornerNormals.append(corner.normal);
+                }
+            }
+        }
+    }
+}
+} // namespace
+
+MeshBuffer OBJParser::parse(const QString &path, QString *errorMessage) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to open file %1").arg(path);
+        return {};
+    }
+
+    QByteArray fallback;
+    const qsizetype size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data) {
+        fallback = file.readAll();
+        data = reinterpret_cast<const uchar *>(fallback.constData());
+    }
+    const char *text = reinterpret_cast<const char *>(data);
+
+    const QVector<const char *> cuts = Parallel::splitLines(text, text + size, kChunkSize);
+    QVector<Chunk> chunks(cuts.size() - 1);
+    Parallel::forEach(chunks.size(), [&](qsizetype c) { parseChunk(cuts.at(c), cuts.at(c + 1), &chunks[c]); }, 1);
+
+    // Merge pass: offsets of every chunk's records in the concatenation.
+    const qsizetype chunkCount = chunks.size();
+    QVector<qsizetype> positionFirst(chunkCount + 1, 0);
+    QVector<qsizetype> normalFirst(chunkCount + 1, 0);
+    QVector<qsizetype> cornerFirst(chunkCount + 1, 0);
+    bool failed = false;
+    bool allColored = true;
+    bool allNormals = true;
+    for (qsizetype c = 0; c < chunkCount; ++c) {
+        const Chunk &chunk = chunks.at(c);
+        positionFirst[c + 1] = positionFirst[c] + chunk.positions.size();
+        normalFirst[c + 1] = normalFirst[c] + chunk.normals.size();
+        cornerFirst[c + 1] = cornerFirst[c] + chunk.corners.size();
+        failed = failed || chunk.failed;
+        allColored = allColored && chunk.allColored;
+        allNormals = allNormals && chunk.allNormals;
+    }
+    const qsizetype vertexCount = positionFirst.last();
+    const qsizetype normalCount = normalFirst.last();
+    const qsizetype cornerCount = cornerFirst.last();
+    if (failed || vertexCount > std::numeric_limits<qint32>::max()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Corrupt OBJ data in %1").arg(path);
+        return {};
+    }
+    if (cornerCount == 0) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("No faces found in OBJ file.");
+        return {};
+    }
+    allColored = allColored && vertexCount > 0;
+    allNormals = allNormals && normalCount > 0;
+
+    QVector<QVector3D> positions(vertexCount);
+    QVector<quint32> colors(allColored ? vertexCount : 0);
+    QVector<QVector3D> normals(allNormals ? normalCount : 0);
+    QVector<qint32> corners(cornerCount);
+    QVector<qint32> cornerNormals(allNormals ? cornerCount : 0);
+    std::atomic<bool> outOfRange = false;
+    Parallel::forEach(chunkCount, [&](qsizetype c) {
+        const Chunk &chunk = chunks.at(c);
+        std::copy(chunk.positions.cbegin(), chunk.positions.cend(), positions.begin() + positionFirst.at(c));
+        if (allColored)
+            std::copy(chunk.colors.cbegin(), chunk.colors.cend(), colors.begin() + positionFirst.at(c));
+        qint32 *chunkCorners = corners.data() + cornerFirst.at(c);
+        std::copy(chunk.corners.cbegin(), chunk.corners.cend(), chunkCorners);
+        for (qsizetype corner : chunk.relativePositions)
+            chunkCorners[corner] += static_cast<qint32>(positionFirst.at(c));
+        for (qsizetype i = 0; i < chunk.corners.size(); ++i) {
+            if (chunkCorners[i] < 0 || chunkCorners[i] >= vertexCount)
+                outOfRange = true;
+        }
+        if (!allNormals)
+            return;
+        std::copy(chunk.normals.cbegin(), chunk.normals.cend(), normals.begin() + normalFirst.at(c));
+        qint32 *chunkNormals = cornerNormals.data() + cornerFirst.at(c);
+        std::copy(chunk.cornerNormals.cbegin(), chunk.cornerNormals.cend(), chunkNormals);
+        for (qsizetype corner : chunk.relativeNormals)
+            chunkNormals[corner] += static_cast<qint32>(normalFirst.at(c));
+        for (qsizetype i = 0; i < chunk.cornerNormals.size(); ++i) {
+            if (chunkNormals[i] < 0 || chunkNormals[i] >= normalCount)
+                outOfRange = true;
+        }
+    }, 1);
+    chunks.clear();
+    if (outOfRange) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("OBJ face references a missing vertex or normal.");
+        return {};
+    }
+
+    MeshBuffer buffer;
+    buffer.indices.resize(cornerCount);
+
+    // Without normals, or when every position is used with a single normal,
+    // the OBJ vertices are the mesh vertices as they are.
+    QVector<qint32> normalOf;
+    bool split = false;
+    if (allNormals) {
+        normalOf = QVector<qint32>(vertexCount, -1);
+        for (qsizetype i = 0; i < cornerCount && !split; ++i) {
+            qint32 &assigned = normalOf[corners.at(i)];
+            if (assigned < 0)
+                assigned = cornerNormals.at(i);
+            split = assigned != cornerNormals.at(i);
+        }
+    }
+
+    if (!split) {
+        Parallel::forEach(cornerCount, [&](qsizetype i) { buffer.indices[i] = static_cast<unsigned int>(corners.at(i)); });
+        if (allNormals) {
+            buffer.normals.resize(vertexCount);
+            Parallel::forEach(vertexCount, [&](qsizetype v) {
+                buffer.normals[v] = normalOf.at(v) >= 0 ? normals.at(normalOf.at(v)) : QVector3D(0.0f, 1.0f, 0.0f);
+            });
+        }
+        buffer.positions = std::move(positions);
+        buffer.colors = std::move(colors);
+    } else {
+        // Weld corners by their (position, normal) pair so hard edges keep
+        // their normals without duplicating every corner.
+        QVector<quint64> keys(cornerCount);
+        Parallel::forEach(cornerCount, [&](qsizetype i) {
+            keys[i] = (static_cast<quint64>(corners.at(i)) << 32) | static_cast<quint32>(cornerNormals.at(i));
+        });
+        QVector<quint64> unique = keys;
+        Parallel::sort(unique, std::less<quint64>());
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+        Parallel::forEach(cornerCount, [&](qsizetype i) {
+            buffer.indices[i] = static_cast<unsigned int>(std::lower_bound(unique.cbegin(), unique.cend(), keys.at(i)) - unique.cbegin());
+        });
+
+        buffer.positions.resize(unique.size());
+        buffer.normals.resize(unique.size());
+        if (allColored)
+            buffer.colors.resize(unique.size());
+        Parallel::forEach(unique.size(), [&](qsizetype v) {
+            const qint32 position = static_cast<qint32>(unique.at(v) >> 32);
+            buffer.positions[v] = positions.at(position);
+            buffer.normals[v] = normals.at(static_cast<qint32>(unique.at(v) & 0xffffffffu));
+            if (allColored)
+                buffer.colors[v] = colors.at(position);
+        });
+    }
+
+    buffer.hasNormals = allNormals;
+    return buffer;
+}
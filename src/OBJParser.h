@@ -0,0 +1,18 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+// Wavefront OBJ geometry (v, vn and f records; optional "v x y z r g b"
+// colors). The mapped file is cut into line-aligned chunks that are parsed
+// concurrently; each chunk fans its polygons into triangles and keeps
+// negative (relative) indices chunk-local until a merge pass, once the
+// vertex counts of the preceding chunks are known. Corners are welded by
+// their (position, normal) pair, so vertices are only split where a
+// position really carries several normals.
+class OBJParser
+{
+public:
+    OBJParser() = default;
+
+    MeshBuffer parse(const QString &path, QString *errorMessage) const;
+};
@@ -0,0 +1,592 @@
+#include "PLYParser.h"
+#include "Parallel.h"
+
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QtEndian>
+
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kFacesPerBlock = 1 << 14;
+constexpr qsizetype kAsciiChunkSize = 1 << 22;
+
+enum class Encoding
+{
+    Ascii,
+    LittleEndian,
+    BigEndian
+};
+
+enum class Type
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+};
+
+struct Property
+{
+    QByteArray name;
+    Type type = Type::Float32; // item type for lists
+    Type countType = Type::UInt8;
+    bool isList = false;
+};
+
+struct Element
+{
+    QByteArray name;
+    qint64 count = 0;
+    QVector<Property> properties;
+    qint64 offset = 0; // start of the element's records in a binary body
+};
+
+struct Header
+{
+    Encoding encoding = Encoding::Ascii;
+    QVector<Element> elements;
+    qsizetype dataOffset = 0;
+};
+
+// Where the vertex attributes we keep sit among the vertex properties.
+struct VertexLayout
+{
+    int position[3] = {-1, -1, -1};
+    int normal[3] = {-1, -1, -1};
+    int color[3] = {-1, -1, -1};
+
+    bool hasNormals() const { return normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0; }
+    bool hasColors() const { return color[0] >= 0 && color[1] >= 0 && color[2] >= 0; }
+};
+
+bool parseType(const QByteArray &name, Type *type)
+{
+    static const struct
+    {
+        const char *name;
+        Type type;
+    } kTypes[] = {{"char", Type::Int8},     {"int8", Type::Int8},       {"uchar", Type::UInt8},   {"uint8", Type::UInt8},
+                  {"short", Type::Int16},   {"int16", Type::Int16},     {"ushort", Type::UInt16}, {"uint16", Type::UInt16},
+                  {"int", Type::Int32},     {"int32", Type::Int32},     {"uint", Type::UInt32},   {"uint32", Type::UInt32},
+                  {"float", Type::Float32}, {"float32", Type::Float32}, {"double", Type::Float64}, {"float64", Type::Float64}};
+    for (const auto &entry : kTypes) {
+        if (name == entry.name) {
+            *type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+int typeSize(Type type)
+{
+    switch (type) {
+    case Type::Int8:
+    case Type::UInt8:
+        return 1;
+    case Type::Int16:
+    case Type::UInt16:
+        return 2;
+    case Type::Int32:
+    case Type::UInt32:
+    case Type::Float32:
+        return 4;
+    case Type::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+template <typename T>
+T load(const uchar *p, bool bigEndian)
+{
+    return bigEndian ? qFromBigEndian<T>(p) : qFromLittleEndian<T>(p);
+}
+
+double readBinary(const uchar *p, Type type, bool bigEndian)
+{
+    switch (type) {
+    case Type::Int8:
+        return static_cast<qint8>(*p);
+    case Type::UInt8:
+        return *p;
+    case Type::Int16:
+        return load<qint16>(p, bigEndian);
+    case Type::UInt16:
+        return load<quint16>(p, bigEndian);
+    case Type::Int32:
+        return load<qint32>(p, bigEndian);
+    case Type::UInt32:
+        return load<quint32>(p, bigEndian);
+    case Type::Float32: {
+        const quint32 bits = load<quint32>(p, bigEndian);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    case Type::Float64: {
+        const quint64 bits = load<quint64>(p, bigEndian);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    }
+    return 0.0;
+}
+
+// Colors are stored as 8-bit sRGB; float channels are taken as 0..1.
+quint32 colorChannel(double value, Type type)
+{
+    if (type == Type::Float32 || type == Type::Float64)
+        value = value * 255.0 + 0.5;
+    return static_cast<quint32>(qBound(0.0, value, 255.0));
+}
+
+bool parseHeader(const char *data, qsizetype size, Header *header, QString *errorMessage)
+{
+    qsizetype position = 0;
+    bool first = true;
+    while (position < size) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(data + position, '\n', size - position));
+        if (!lineEnd)
+            break;
+        const QByteArray line = QByteArray(data + position, lineEnd - (data + position)).simplified();
+        position = lineEnd - data + 1;
+        const QList<QByteArray> parts = line.split(' ');
+
+        if (first) {
+            if (line != "ply")
+                break;
+            first = false;
+            continue;
+        }
+        if (line.isEmpty() || parts.first() == "comment" || parts.first() == "obj_info")
+            continue;
+        if (line == "end_header") {
+            header->dataOffset = position;
+            return true;
+        }
+
+        if (parts.first() == "format" && parts.size() >= 2) {
+            if (parts.at(1) == "ascii") {
+                header->encoding = Encoding::Ascii;
+            } else if (parts.at(1) == "binary_little_endian") {
+                header->encoding = Encoding::LittleEndian;
+            } else if (parts.at(1) == "binary_big_endian") {
+                header->encoding = Encoding::BigEndian;
+            } else {
+                if (errorMessage)
+                    *errorMessage = QObject::tr("Unsupported PLY format \"%1\".").arg(QString::fromLatin1(parts.at(1)));
+                return false;
+            }
+        } else if (parts.first() == "element" && parts.size() >= 3) {
+            Element element;
+            element.name = parts.at(1);
+            bool ok = false;
+            element.count = parts.at(2).toLongLong(&ok);
+            if (!ok || element.count < 0)
+                break;
+            header->elements.append(element);
+        } else if (parts.first() == "property" && !header->elements.isEmpty()) {
+            Property property;
+            bool ok = false;
+            if (parts.size() >= 5 && parts.at(1) == "list") {
+                property.isList = true;
+                property.name = parts.at(4);
+                ok = parseType(parts.at(2), &property.countType) && parseType(parts.at(3), &property.type);
+            } else if (parts.size() >= 3) {
+                property.name = parts.at(2);
+                ok = parseType(parts.at(1), &property.type);
+            }
+            if (!ok)
+                break;
+            header->elements.last().properties.append(property);
+        }
+    }
+
+    if (errorMessage)
+        *errorMessage = QObject::tr("Invalid PLY header.");
+    return false;
+}
+
+int findProperty(const Element &element, std::initializer_list<const char *> names)
+{
+    for (const char *name : names) {
+        for (int i = 0; i < element.properties.size(); ++i) {
+            if (!element.properties.at(i).isList && element.properties.at(i).name == name)
+                return i;
+        }
+    }
+    return -1;
+}
+
+// Negative or oversized indices map to a value every range check rejects.
+unsigned int toIndex(double value)
+{
+    return value >= 0.0 && value < 4294967295.0 ? static_cast<unsigned int>(value) : 0xffffffffu;
+}
+
+// Reads one whitespace-separated number of an ASCII record.
+bool readAscii(const char *&p, const char *end, double *value)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        ++p;
+    if (p < end && *p == '+')
+        ++p;
+    const std::from_chars_result result = std::from_chars(p, end, *value);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+bool isBlank(const char *p, const char *end)
+{
+    for (; p < end; ++p) {
+        if (*p != ' ' && *p != '\t' && *p != '\r')
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+bool PLYParser::canRead(const QByteArray &header)
+{
+    return header.startsWith("ply\n") || header.startsWith("ply\r\n");
+}
+
+MeshBuffer PLYParser::parse(const QString &path, QString *errorMessage) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to open file %1").arg(path);
+        return {};
+    }
+
+    QByteArray fallback;
+    const qsizetype size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data) {
+        fallback = file.readAll();
+        data = reinterpret_cast<const uchar *>(fallback.constData());
+    }
+
+    Header header;
+    if (!parseHeader(reinterpret_cast<const char *>(data), size, &header, errorMessage))
+        return {};
+
+    int vertexElement = -1;
+    int faceElement = -1;
+    for (int i = 0; i < header.elements.size(); ++i) {
+        if (header.elements.at(i).name == "vertex" && vertexElement < 0)
+            vertexElement = i;
+        else if (header.elements.at(i).name == "face" && faceElement < 0)
+            faceElement = i;
+    }
+    if (vertexElement < 0 || faceElement < 0) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("PLY file has no vertex or face element.");
+        return {};
+    }
+
+    const Element &vertices = header.elements.at(vertexElement);
+    const Element &faces = header.elements.at(faceElement);
+    VertexLayout layout;
+    layout.position[0] = findProperty(vertices, {"x"});
+    layout.position[1] = findProperty(vertices, {"y"});
+    layout.position[2] = findProperty(vertices, {"z"});
+    layout.normal[0] = findProperty(vertices, {"nx"});
+    layout.normal[1] = findProperty(vertices, {"ny"});
+    layout.normal[2] = findProperty(vertices, {"nz"});
+    layout.color[0] = findProperty(vertices, {"red", "diffuse_red", "r"});
+    layout.color[1] = findProperty(vertices, {"green", "diffuse_green", "g"});
+    layout.color[2] = findProperty(vertices, {"blue", "diffuse_blue", "b"});
+    int indexList = -1;
+    for (int i = 0; i < faces.properties.size(); ++i) {
+        const Property &property = faces.properties.at(i);
+        if (property.isList && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+            indexList = i;
+            break;
+        }
+    }
+    if (layout.position[0] < 0 || layout.position[1] < 0 || layout.position[2] < 0 || indexList < 0) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("PLY file lacks vertex positions or face indices.");
+        return {};
+    }
+    if (vertices.count > std::numeric_limits<int>::max() || faces.count > std::numeric_limits<int>::max()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("PLY file is too large.");
+        return {};
+    }
+
+    MeshBuffer buffer;
+    const qsizetype vertexCount = vertices.count;
+    // Called once the body is known to hold every record the header
+    // declares, so a bogus count cannot allocate beyond the file.
+    const auto allocateVertices = [&]() {
+        buffer.positions.resize(vertexCount);
+        if (layout.hasNormals())
+            buffer.normals.resize(vertexCount);
+        if (layout.hasColors())
+            buffer.colors.resize(vertexCount);
+    };
+    std::atomic<bool> failed = false;
+
+    // Decoded values of one vertex record, in property order.
+    const auto storeVertex = [&](qsizetype i, const double *values) {
+        buffer.positions[i] = QVector3D(values[layout.position[0]], values[layout.position[1]], values[layout.position[2]]);
+        if (layout.hasNormals())
+            buffer.normals[i] = QVector3D(values[layout.normal[0]], values[layout.normal[1]], values[layout.normal[2]]);
+        if (layout.hasColors()) {
+            quint32 rgba = 0xff000000u;
+            for (int channel = 0; channel < 3; ++channel)
+                rgba |= colorChannel(values[layout.color[channel]], vertices.properties.at(layout.color[channel]).type) << (8 * channel);
+            buffer.colors[i] = rgba;
+        }
+    };
+    // Fans one polygon into `out`; false on an out-of-range index.
+    const auto appendPolygon = [vertexCount](const unsigned int *corners, qsizetype count, unsigned int *out) {
+        for (qsizetype k = 0; k < count; ++k) {
+            if (corners[k] >= static_cast<unsigned int>(vertexCount))
+                return false;
+        }
+        for (qsizetype k = 1; k + 1 < count; ++k) {
+            *out++ = corners[0];
+            *out++ = corners[k];
+            *out++ = corners[k + 1];
+        }
+        return true;
+    };
+
+    if (header.encoding == Encoding::Ascii) {
+        const char *body = reinterpret_cast<const char *>(data) + header.dataOffset;
+        const char *bodyEnd = reinterpret_cast<const char *>(data) + size;
+
+        const QVector<const char *> cuts = Parallel::splitLines(body, bodyEnd, kAsciiChunkSize);
+        const qsizetype chunkCount = cuts.size() - 1;
+
+        const auto forEachLine = [](const char *p, const char *end, auto &&function) {
+            while (p < end) {
+                const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+                if (!lineEnd)
+                    lineEnd = end;
+                if (!isBlank(p, lineEnd) && !function(p, lineEnd))
+                    return;
+                p = lineEnd + 1;
+            }
+        };
+
+        QVector<qint64> firstRecord(chunkCount + 1, 0);
+        Parallel::forEach(chunkCount, [&](qsizetype c) {
+            qint64 lines = 0;
+            forEachLine(cuts.at(c), cuts.at(c + 1), [&lines](const char *, const char *) {
+                ++lines;
+                return true;
+            });
+            firstRecord[c + 1] = lines;
+        }, 1);
+        for (qsizetype c = 0; c < chunkCount; ++c)
+            firstRecord[c + 1] += firstRecord[c];
+
+        QVector<qint64> elementFirst(header.elements.size() + 1, 0);
+        for (int e = 0; e < header.elements.size(); ++e)
+            elementFirst[e + 1] = elementFirst[e] + header.elements.at(e).count;
+        if (firstRecord.last() < elementFirst.last()) {
+            if (errorMessage)
+                *errorMessage = QObject::tr("Unexpected end of PLY file.");
+            return {};
+        }
+        allocateVertices();
+
+        QVector<QVector<unsigned int>> chunkIndices(chunkCount);
+        Parallel::forEach(chunkCount, [&](qsizetype c) {
+            qint64 record = firstRecord.at(c);
+            int element = 0;
+            QVector<double> values;
+            QVector<unsigned int> corners;
+            QVector<unsigned int> &indices = chunkIndices[c];
+            forEachLine(cuts.at(c), cuts.at(c + 1), [&](const char *p, const char *end) {
+                while (element < header.elements.size() && record >= elementFirst.at(element + 1))
+                    ++element;
+                if (element >= header.elements.size())
+                    return false;
+                const qint64 index = record++ - elementFirst.at(element);
+                if (element != vertexElement && element != faceElement)
+                    return true;
+
+                const Element &current = header.elements.at(element);
+                values.resize(current.properties.size());
+                for (int k = 0; k < current.properties.size(); ++k) {
+                    if (!readAscii(p, end, &values[k]))
+                        return !(failed = true);
+                    if (!current.properties.at(k).isList)
+                        continue;
+                    // Every item takes a digit and a separator, bar the last.
+                    if (!(values.at(k) <= static_cast<double>((end - p + 1) / 2)))
+                        return !(failed = true);
+                    const qsizetype count = static_cast<qsizetype>(values.at(k));
+                    corners.resize(qMax<qsizetype>(count, 0));
+                    for (qsizetype item = 0; item < count; ++item) {
+                        double value = 0.0;
+                        if (!readAscii(p, end, &value))
+                            return !(failed = true);
+                        corners[item] = toIndex(value);
+                    }
+                    if (element == faceElement && k == indexList && count >= 3) {
+                        const qsizetype at = indices.size();
+                        indices.resize(at + (count - 2) * 3);
+                        if (!appendPolygon(corners.constData(), count, indices.data() + at))
+                            return !(failed = true);
+                    }
+                }
+                if (element == vertexElement)
+                    storeVertex(index, values.constData());
+                return true;
+            });
+        }, 1);
+
+        QVector<qsizetype> offsets(chunkCount + 1, 0);
+        for (qsizetype c = 0; c < chunkCount; ++c)
+            offsets[c + 1] = offsets[c] + chunkIndices.at(c).size();
+        buffer.indices.resize(offsets.last());
+        Parallel::forEach(chunkCount, [&](qsizetype c) {
+            std::copy(chunkIndices.at(c).cbegin(), chunkIndices.at(c).cend(), buffer.indices.begin() + offsets.at(c));
+        }, 1);
+    } else {
+        const bool bigEndian = header.encoding == Encoding::BigEndian;
+
+        // Size of the record at `at`, or -1 if it runs past the end of the
+        // file. The length of list `list` is reported through `listCount`.
+        const auto recordSize = [&](const Element &element, qint64 at, int list, qint64 *listCount) -> qint64 {
+            const qint64 start = at;
+            for (int k = 0; k < element.properties.size(); ++k) {
+                const Property &property = element.properties.at(k);
+                if (!property.isList) {
+                    at += typeSize(property.type);
+                    continue;
+                }
+                if (at + typeSize(property.countType) > size)
+                    return -1;
+                const qint64 count = qMax<qint64>(static_cast<qint64>(readBinary(data + at, property.countType, bigEndian)), 0);
+                if (k == list)
+                    *listCount = count;
+                at += typeSize(property.countType) + count * typeSize(property.type);
+            }
+            return at <= size ? at - start : -1;
+        };
+
+        // Lay out the elements. Records with lists are walked once; for the
+        // faces this also notes where every block starts and how many
+        // triangles precede it, so the blocks can be decoded independently.
+        const qsizetype blockCount = (faces.count + kFacesPerBlock - 1) / kFacesPerBlock;
+        QVector<qint64> blockOffsets(blockCount);
+        QVector<qsizetype> blockTriangles(blockCount + 1, 0);
+        qint64 vertexStride = -1;
+        qint64 offset = header.dataOffset;
+        for (int e = 0; e < header.elements.size() && offset <= size; ++e) {
+            Element &element = header.elements[e];
+            element.offset = offset;
+            qint64 fixed = 0;
+            for (const Property &property : element.properties)
+                fixed = property.isList || fixed < 0 ? -1 : fixed + typeSize(property.type);
+            if (e == vertexElement)
+                vertexStride = fixed;
+            if (fixed >= 0) {
+                offset += fixed * element.count;
+                continue;
+            }
+            for (qint64 r = 0; r < element.count; ++r) {
+                if (e == faceElement && r % kFacesPerBlock == 0)
+                    blockOffsets[r / kFacesPerBlock] = offset;
+                qint64 listCount = 0;
+                const qint64 recordBytes = recordSize(element, offset, e == faceElement ? indexList : -1, &listCount);
+                if (recordBytes < 0) {
+                    offset = size + 1;
+                    break;
+                }
+                if (e == faceElement)
+                    blockTriangles[r / kFacesPerBlock + 1] += qMax<qint64>(listCount - 2, 0);
+                offset += recordBytes;
+            }
+        }
+        if (offset > size) {
+            if (errorMessage)
+                *errorMessage = QObject::tr("Unexpected end of PLY file.");
+            return {};
+        }
+        if (vertexStride < 0) {
+            if (errorMessage)
+                *errorMessage = QObject::tr("PLY vertices with list properties are not supported.");
+            return {};
+        }
+        allocateVertices();
+
+        QVector<int> propertyOffsets;
+        for (int k = 0, at = 0; k < vertices.properties.size(); at += typeSize(vertices.properties.at(k++).type))
+            propertyOffsets.append(at);
+        Parallel::forRanges(Parallel::split(vertexCount, 1 << 14), [&](const Parallel::Range &range) {
+            QVector<double> values(vertices.properties.size());
+            for (qsizetype i = range.begin; i < range.end; ++i) {
+                const uchar *record = data + vertices.offset + i * vertexStride;
+                for (int k = 0; k < values.size(); ++k)
+                    values[k] = readBinary(record + propertyOffsets.at(k), vertices.properties.at(k).type, bigEndian);
+                storeVertex(i, values.constData());
+            }
+        });
+
+        for (qsizetype b = 0; b < blockCount; ++b)
+            blockTriangles[b + 1] += blockTriangles[b];
+        buffer.indices.resize(blockTriangles.last() * 3);
+        Parallel::forEach(blockCount, [&](qsizetype b) {
+            qint64 at = blockOffsets.at(b);
+            unsigned int *out = buffer.indices.data() + blockTriangles.at(b) * 3;
+            QVector<unsigned int> corners;
+            const qint64 last = qMin<qint64>(faces.count, (b + 1) * kFacesPerBlock);
+            for (qint64 r = b * kFacesPerBlock; r < last; ++r) {
+                for (int k = 0; k < faces.properties.size(); ++k) {
+                    const Property &property = faces.properties.at(k);
+                    if (!property.isList) {
+                        at += typeSize(property.type);
+                        continue;
+                    }
+                    const qint64 count = qMax<qint64>(static_cast<qint64>(readBinary(data + at, property.countType, bigEndian)), 0);
+                    at += typeSize(property.countType);
+                    if (k == indexList && count >= 3) {
+                        const int itemSize = typeSize(property.type);
+                        corners.resize(count);
+                        for (qint64 item = 0; item < count; ++item)
+                            corners[item] = toIndex(readBinary(data + at + item * itemSize, property.type, bigEndian));
+                        if (!appendPolygon(corners.constData(), count, out)) {
+                            failed = true;
+                            return;
+                        }
+                        out += (count - 2) * 3;
+                    }
+                    at += count * typeSize(property.type);
+                }
+            }
+        }, 1);
+    }
+
+    if (failed) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Corrupt PLY data in %1").arg(path);
+        return {};
+    }
+    buffer.hasNormals = layout.hasNormals();
+    if (buffer.indices.isEmpty() && errorMessage)
+        *errorMessage = QObject::tr("No faces found in PLY file.");
+    return buffer;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QByteArray>
+
+// Stanford PLY (ASCII, binary little- and big-endian). The file is memory
+// mapped; fixed-size vertex records are decoded in parallel by index, face
+// records are located by one light sequential pass over their list counts
+// and then decoded block by block in parallel. ASCII bodies are split into
+// line-aligned chunks that are parsed concurrently. Polygons are fanned
+// into triangles; other elements are skipped.
+class PLYParser
+{
+public:
+    PLYParser() = default;
+
+    static bool canRead(const QByteArray &header);
+
+    MeshBuffer parse(const QString &path, QString *errorMessage) const;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Parallel
+{
+struct Range
+{
+    int index = 0;
+    qsizetype begin = 0;
+    qsizetype end = 0;
+};
+
+inline QVector<Range> split(qsizetype count, qsizetype minChunk = 16384)
+{
+    QVector<Range> ranges;
+    if (count <= 0)
+        return ranges;
+
+    const qsizetype maxChunks = qMax(1, QThread::idealThreadCount()) * 4;
+    const qsizetype chunkCount = qBound<qsizetype>(1, (count + minChunk - 1) / qMax<qsizetype>(minChunk, 1), maxChunks);
+    const qsizetype chunkSize = (count + chunkCount - 1) / chunkCount;
+    for (qsizetype begin = 0; begin < count; begin += chunkSize) {
+        Range range;
+        range.index = ranges.size();
+        range.begin = begin;
+        range.end = qMin(count, begin + chunkSize);
+        ranges.append(range);
+    }
+    return ranges;
+}
+
+// Cuts text into chunks of roughly `chunkSize` bytes that each start at the
+// beginning of a line, for parsers that handle chunks concurrently. Returns
+// the chunk boundaries, including `begin` and `end`.
+inline QVector<const char *> splitLines(const char *begin, const char *end, qsizetype chunkSize)
+{
+    QVector<const char *> cuts = {begin};
+    while (end - cuts.last() > chunkSize) {
+        const char *cut = cuts.last() + chunkSize;
+        const char *lineEnd = static_cast<const char *>(std::memchr(cut, '\n', end - cut));
+        if (!lineEnd || lineEnd + 1 >= end)
+            break;
+        cuts.append(lineEnd + 1);
+    }
+    cuts.append(end);
+    return cuts;
+}
+
+template <typename Function>
+void forRanges(const QVector<Range> &ranges, Function &&function)
+{
+    if (ranges.size() == 1) {
+        function(ranges.first());
+        return;
+    }
+    QVector<Range> work = ranges;
+    QtConcurrent::blockingMap(work, [&function](const Range &range) { function(range); });
+}
+
+template <typename Function>
+void forEach(qsizetype count, Function &&function, qsizetype minChunk = 16384)
+{
+    forRanges(split(count, minChunk), [&function](const Range &range) {
+        for (qsizetype i = range.begin; i < range.end; ++i)
+            function(i);
+    });
+}
+
+// Sorts chunks concurrently, then merges neighbouring runs pairwise.
+template <typename T, typename Compare>
+void sort(QVector<T> &values, Compare compare, qsizetype minChunk = 65536)
+{
+    const QVector<Range> ranges = split(values.size(), minChunk);
+    T *data = values.data();
+    forRanges(ranges, [data, &compare](const Range &range) { std::sort(data + range.begin, data + range.end, compare); });
+
+    QVector<qsizetype> bounds;
+    for (const Range &range : ranges)
+        bounds.append(range.begin);
+    bounds.append(values.size());
+
+    while (bounds.size() > 2) {
+        QVector<Range> merges;
+        QVector<qsizetype> next;
+        for (qsizetype i = 0; i + 1 < bounds.size(); i += 2) {
+            next.append(bounds.at(i));
+            if (i + 2 < bounds.size()) {
+                Range merge;
+                merge.index = static_cast<int>(i);
+                merge.begin = bounds.at(i);
+                merge.end = bounds.at(i + 2);
+                merges.append(merge);
+            }
+        }
+        next.append(bounds.last());
+        forRanges(merges, [data, &bounds, &compare](const Range &merge) {
+            std::inplace_merge(data + merge.begin, data + bounds.at(merge.index + 1), data + merge.end, compare);
+        });
+        bounds = next;
+    }
+}
+} // namespace Parallel
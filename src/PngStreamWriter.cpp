@@ -0,0 +1,193 @@
+#include "PngStreamWriter.h"
+
+#include <QObject>
+#include <QtEndian>
+
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+constexpr int kOutputChunkSize = 1 << 20;
+}
+
+struct PngStreamWriter::Deflater
+{
+#ifdef HAVE_ZLIB
+    z_stream stream = {};
+    QByteArray output;
+    QByteArray row;
+#endif
+};
+
+PngStreamWriter::PngStreamWriter() = default;
+
+PngStreamWriter::~PngStreamWriter()
+{
+#ifdef HAVE_ZLIB
+    if (m_deflater)
+        deflateEnd(&m_deflater->stream);
+#endif
+}
+
+bool PngStreamWriter::open(const QString &path, const QSize &size, QString *errorMessage)
+{
+    m_path = path;
+    m_size = size;
+    m_rowsWritten = 0;
+
+#ifdef HAVE_ZLIB
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to write file %1").arg(path);
+        return false;
+    }
+
+    static const char signature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+    QByteArray header(13, '\0');
+    qToBigEndian<quint32>(static_cast<quint32>(size.width()), header.data());
+    qToBigEndian<quint32>(static_cast<quint32>(size.height()), header.data() + 4);
+    header[8] = 8;
+    header[9] = 2;
+    if (m_file.write(signature, sizeof(signature)) != sizeof(signature) || !writeChunk("IHDR", header)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to write %1").arg(path);
+        return false;
+    }
+
+    m_deflater = std::make_unique<Deflater>();
+    if (deflateInit(&m_deflater->stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        m_deflater.reset();
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to initialize PNG compression.");
+        return false;
+    }
+    m_deflater->output.resize(kOutputChunkSize);
+    m_deflater->row.resize(1 + size.width() * 3);
+    m_deflater->stream.next_out = reinterpret_cast<Bytef *>(m_deflater->output.data());
+    m_deflater->stream.avail_out = static_cast<uInt>(m_deflater->output.size());
+#else
+    Q_UNUSED(errorMessage);
+    m_fallbackImage = QImage(size, QImage::Format_RGB32);
+#endif
+    return true;
+}
+
+bool PngStreamWriter::writeRows(const QImage &rows, QString *errorMessage)
+{
+    if (rows.width() != m_size.width() || m_rowsWritten + rows.height() > m_size.height()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Image rows do not match the output size.");
+        return false;
+    }
+
+#ifdef HAVE_ZLIB
+    const QImage rgb = rows.convertToFormat(QImage::Format_RGB888);
+    const int stride = m_size.width() * 3;
+    for (int y = 0; y < rgb.height(); ++y) {
+        const uchar *line = rgb.constScanLine(y);
+        auto *out = reinterpret_cast<uchar *>(m_deflater->row.data());
+        out[0] = 1;
+        for (int i = 0; i < stride; ++i)
+            out[1 + i] = static_cast<uchar>(line[i] - (i >= 3 ? line[i - 3] : 0));
+
+        m_deflater->stream.next_in = out;
+        m_deflater->stream.avail_in = static_cast<uInt>(m_deflater->row.size());
+        while (m_deflater->stream.avail_in > 0) {
+            if (deflate(&m_deflater->stream, Z_NO_FLUSH) != Z_OK || !flushDeflate(false)) {
+                if (errorMessage)
+                    *errorMessage = QObject::tr("Failed to write %1").arg(m_path);
+                return false;
+            }
+        }
+    }
+#else
+    Q_UNUSED(errorMessage);
+    for (int y = 0; y < rows.height(); ++y) {
+        const QImage line = rows.copy(0, y, rows.width(), 1).convertToFormat(QImage::Format_RGB32);
+        std::memcpy(m_fallbackImage.scanLine(m_rowsWritten + y), line.constScanLine(0), line.bytesPerLine());
+    }
+#endif
+    m_rowsWritten += rows.height();
+    return true;
+}
+
+bool PngStreamWriter::close(QString *errorMessage)
+{
+    if (m_rowsWritten != m_size.height()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Incomplete image written to %1").arg(m_path);
+        return false;
+    }
+
+#ifdef HAVE_ZLIB
+    int status = Z_OK;
+    do {
+        status = deflate(&m_deflater->stream, Z_FINISH);
+        if ((status != Z_OK && status != Z_STREAM_END) || !flushDeflate(status == Z_STREAM_END)) {
+            if (errorMessage)
+                *errorMessage = QObject::tr("Failed to write %1").arg(m_path);
+            return false;
+        }
+    } while (status != Z_STREAM_END);
+
+    deflateEnd(&m_deflater->stream);
+    m_deflater.reset();
+    if (!writeChunk("IEND", QByteArray()) || !m_file.commit()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to write %1").arg(m_path);
+        return false;
+    }
+    return true;
+#else
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly) || !m_fallbackImage.save(&file, "PNG") || !file.commit()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to write %1").arg(m_path);
+        return false;
+    }
+    m_fallbackImage = QImage();
+    return true;
+#endif
+}
+
+bool PngStreamWriter::writeChunk(const char type[4], const QByteArray &data)
+{
+#ifdef HAVE_ZLIB
+    char length[4];
+    qToBigEndian<quint32>(static_cast<quint32>(data.size()), length);
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()), static_cast<uInt>(data.size()));
+    char crcBytes[4];
+    qToBigEndian<quint32>(static_cast<quint32>(crc), crcBytes);
+
+    return m_file.write(length, 4) == 4 && m_file.write(type, 4) == 4 &&
+           m_file.write(data) == data.size() && m_file.write(crcBytes, 4) == 4;
+#else
+    Q_UNUSED(type);
+    Q_UNUSED(data);
+    return false;
+#endif
+}
+
+bool PngStreamWriter::flushDeflate(bool finish)
+{
+#ifdef HAVE_ZLIB
+    const qsizetype produced = m_deflater->output.size() - m_deflater->stream.avail_out;
+    if (produced == 0 || (!finish && m_deflater->stream.avail_out > 0))
+        return true;
+
+    if (!writeChunk("IDAT", m_deflater->output.left(produced)))
+        return false;
+    m_deflater->stream.next_out = reinterpret_cast<Bytef *>(m_deflater->output.data());
+    m_deflater->stream.avail_out = static_cast<uInt>(m_deflater->output.size());
+    return true;
+#else
+    Q_UNUSED(finish);
+    return true;
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QSaveFile>
+#include <QSize>
+#include <QString>
+
+#include <memory>
+
+class PngStreamWriter
+{
+public:
+    PngStreamWriter();
+    ~PngStreamWriter();
+
+    bool open(const QString &path, const QSize &size, QString *errorMessage);
+    bool writeRows(const QImage &rows, QString *errorMessage);
+    bool close(QString *errorMessage);
+
+private:
+    bool writeChunk(const char type[4], const QByteArray &data);
+    bool flushDeflate(bool finish);
+
+    struct Deflater;
+
+    QString m_path;
+    QSize m_size;
+    int m_rowsWritten = 0;
+    // Written to a temporary file that only replaces `m_path` on a
+    // successful close(); an encode that fails midway leaves no partial PNG.
+    QSaveFile m_file;
+    std::unique_ptr<Deflater> m_deflater;
+    QImage m_fallbackImage;
+};
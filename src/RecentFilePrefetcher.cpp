@@ -0,0 +1,59 @@
+#include "RecentFilePrefetcher.h"
+#include "MeshCache.h"
+
+#include <QFileInfo>
+#include <QThread>
+
+RecentFilePrefetcher::RecentFilePrefetcher(MeshCache *cache, QObject *parent)
+    : QObject(parent)
+    , m_cache(cache)
+{
+    m_loader.setExtractFeatureEdges(true);
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 4, 2));
+    m_pool.setThreadPriority(QThread::LowestPriority);
+}
+
+RecentFilePrefetcher::~RecentFilePrefetcher()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void RecentFilePrefetcher::prefetch(const QStringList &paths)
+{
+    if (!m_cache)
+        return;
+
+    for (const QString &path : paths) {
+        if (m_pending.contains(path) || m_cache->contains(path) || !QFileInfo::exists(path))
+            continue;
+
+        m_pending.insert(path);
+        const quint64 generation = m_generation.load();
+        const quint64 cacheGeneration = m_cache->generation();
+        m_pool.start([this, path, generation, cacheGeneration]() {
+            if (generation == m_generation.load()) {
+                // Stamped before parsing: a write landing mid-parse leaves the
+                // entry stale instead of passing the old geometry off as new.
+                const MeshCache::Stamp stamp = MeshCache::stamp(path);
+                QString errorMessage;
+                MeshBuffer buffer = m_loader.load(path, &errorMessage);
+                if (!buffer.positions.isEmpty() && !buffer.indices.isEmpty() && generation == m_generation.load())
+                    m_cache->insert(path, buffer, stamp, cacheGeneration);
+            }
+            QMetaObject::invokeMethod(this, [this, path, generation]() {
+                if (generation != m_generation.load())
+                    return;
+                m_pending.remove(path);
+                emit prefetched(path);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void RecentFilePrefetcher::cancel()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_pending.clear();
+}
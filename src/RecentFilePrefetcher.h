@@ -0,0 +1,35 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+
+class MeshCache;
+
+class RecentFilePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RecentFilePrefetcher(MeshCache *cache, QObject *parent = nullptr);
+    ~RecentFilePrefetcher() override;
+
+    void prefetch(const QStringList &paths);
+    void cancel();
+
+signals:
+    void prefetched(const QString &path);
+
+private:
+    MeshCache *m_cache = nullptr;
+    MeshLoader m_loader;
+    QThreadPool m_pool;
+    QSet<QString> m_pending;
+    // Bumped by cancel(); jobs queued before it skip their work.
+    std::atomic<quint64> m_generation = 0;
+};
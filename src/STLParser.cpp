@@ -1,7 +1,7 @@
 #include "STLParser.h"
+#include "DecompressingDevice.h"
 
 #include <QByteArray>
-#include <QDataStream>
 #include <QFile>
 #include <QIODevice>
 #include <QRegularExpression>
@@ -10,6 +10,13 @@
 #include <QTextStream>
 #include <QObject>
 #include <QVector>
+#include <QtEndian>
+
+namespace
+{
+constexpr qint64 kRecordSize = 50;
+constexpr quint32 kRecordsPerRead = 1 << 14;
+}
 
 MeshBuffer STLParser::parse(const QString &path, QString *errorMessage) const
 {
@@ -20,17 +27,37 @@ MeshBuffer STLParser::parse(const QString &path, QString *errorMessage) const
         return {};
     }
 
-    QByteArray header = file.peek(512);
-    const bool headerLooksAscii = header.trimmed().startsWith("solid");
-    const bool containsNull = header.contains('\0');
+    const DecompressingDevice::Codec codec = DecompressingDevice::detect(file.peek(4));
+    if (codec == DecompressingDevice::Codec::None)
+        return parseDevice(file, errorMessage);
+    file.close();
 
-    file.seek(0);
-    if (headerLooksAscii && !containsNull) {
-        return parseAscii(file, errorMessage);
+    DecompressingDevice device(path, codec);
+    if (!device.open(QIODevice::ReadOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to open %1: %2").arg(path, device.errorString());
+        return {};
     }
+    MeshBuffer buffer = parseDevice(device, errorMessage);
+    const QString decompressionError = device.error();
+    if (!decompressionError.isEmpty()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to decompress %1: %2").arg(path, decompressionError);
+        return {};
+    }
+    return buffer;
+}
+
+MeshBuffer STLParser::parseDevice(QIODevice &device, QString *errorMessage) const
+{
+    // peek() leaves the read position alone, also on sequential devices.
+    const QByteArray header = device.peek(512);
+    const bool headerLooksAscii = header.trimmed().startsWith("solid");
+    const bool containsNull = header.contains('\0');
 
-    file.seek(0);
-    return parseBinary(file, errorMessage);
+    if (headerLooksAscii && !containsNull)
+        return parseAscii(device, errorMessage);
+    return parseBinary(device, errorMessage);
 }
 
 MeshBuffer STLParser::parseAscii(QIODevice &device, QString *errorMessage) const
@@ -90,65 +117,77 @@ MeshBuffer STLParser::parseBinary(QIODevice &device, QString *errorMessage) cons
         }
     }
 
-    if (!device.seek(80)) {
+    if (device.skip(80) != 80) {
         if (errorMessage)
             *errorMessage = QObject::tr("Invalid STL header.");
         return buffer;
     }
 
-    QDataStream stream(&device);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    quint32 triangleCount = 0;
-    stream >> triangleCount;
-    if (stream.status() != QDataStream::Ok) {
+    char countBytes[4];
+    if (device.read(countBytes, sizeof(countBytes)) != sizeof(countBytes)) {
         if (errorMessage)
             *errorMessage = QObject::tr("Unable to read triangle count.");
         return buffer;
     }
+    const quint32 triangleCount = qFromLittleEndian<quint32>(countBytes);
+    if (!device.isSequential() && device.size() < 84 + qint64(triangleCount) * kRecordSize) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unexpected end of STL file.");
+        return buffer;
+    }
 
-    buffer.positions.reserve(triangleCount * 3);
-    buffer.normals.reserve(triangleCount * 3);
-    buffer.indices.reserve(triangleCount * 3);
-
-    for (quint32 i = 0; i < triangleCount; ++i) {
-        float nx, ny, nz;
-        float ax, ay, az;
-        float bx, by, bz;
-        float cx, cy, cz;
-        quint16 attribute = 0;
-
-        stream >> nx >> ny >> nz;
-        stream >> ax >> ay >> az;
-        stream >> bx >> by >> bz;
-        stream >> cx >> cy >> cz;
-        stream >> attribute;
-
-        if (stream.status() != QDataStream::Ok) {
+    // A compressed stream has no size to check the header against, so only
+    // trust the triangle count as far as the data actually goes.
+    const qsizetype reserved = qsizetype(device.isSequential() ? qMin(triangleCount, kRecordsPerRead * 64) : triangleCount) * 3;
+    buffer.positions.reserve(reserved);
+    buffer.normals.reserve(reserved);
+    buffer.indices.reserve(reserved);
+    buffer.faceColors.reserve(reserved / 3);
+    bool anyFaceColor = false;
+
+    // Records are pulled in large blocks; on a decompressing device each
+    // read hands over whole inflated blocks instead of 50-byte pieces.
+    QByteArray chunk(qsizetype(kRecordsPerRead) * kRecordSize, Qt::Uninitialized);
+    for (quint64 first = 0; first < triangleCount; first += kRecordsPerRead) {
+        const quint32 count = static_cast<quint32>(qMin<quint64>(kRecordsPerRead, triangleCount - first));
+        const qint64 bytes = qint64(count) * kRecordSize;
+        if (device.read(chunk.data(), bytes) != bytes) {
             if (errorMessage)
                 *errorMessage = QObject::tr("Unexpected end of STL file.");
-            buffer.positions.clear();
-            buffer.normals.clear();
-            buffer.indices.clear();
-            return buffer;
+            return {};
         }
 
-        QVector3D normal(nx, ny, nz);
-        if (!normal.isNull())
-            normal.normalize();
-        const unsigned int baseIndex = buffer.positions.size();
-        const QVector3D vertices[3] = {
-            QVector3D(ax, ay, az),
-            QVector3D(bx, by, bz),
-            QVector3D(cx, cy, cz)};
-        for (int v = 0; v < 3; ++v) {
-            buffer.positions.append(vertices[v]);
-            buffer.normals.append(normal);
-            buffer.indices.append(baseIndex + v);
+        const qsizetype vertexCount = (qsizetype(first) + count) * 3;
+        buffer.positions.resize(vertexCount);
+        buffer.normals.resize(vertexCount);
+        buffer.indices.resize(vertexCount);
+        buffer.faceColors.resize(vertexCount / 3);
+        for (quint32 i = 0; i < count; ++i) {
+            const char *record = chunk.constData() + qsizetype(i) * kRecordSize;
+            float values[12];
+            for (int k = 0; k < 12; ++k)
+                values[k] = qFromLittleEndian<float>(record + k * 4);
+
+            QVector3D normal(values[0], values[1], values[2]);
+            if (!normal.isNull())
+                normal.normalize();
+            const qsizetype base = (qsizetype(first) + i) * 3;
+            for (int v = 0; v < 3; ++v) {
+                buffer.positions[base + v] = QVector3D(values[3 + v * 3], values[4 + v * 3], values[5 + v * 3]);
+                buffer.normals[base + v] = normal;
+                buffer.indices[base + v] = static_cast<unsigned int>(base + v);
+            }
+
+            // VisCAM/SolidView facet color: RGB555 with bit 15 as the
+            // "has color" flag.
+            const quint16 attribute = qFromLittleEndian<quint16>(record + 48);
+            buffer.faceColors[first + i] = attribute;
+            anyFaceColor = anyFaceColor || (attribute & 0x8000);
         }
-        Q_UNUSED(attribute);
     }
 
+    if (!anyFaceColor)
+        buffer.faceColors.clear();
     buffer.hasNormals = !buffer.normals.isEmpty();
     return buffer;
 }
@@ -2,6 +2,9 @@
 
 #include "MeshLoader.h"
 
+// ASCII and binary STL. gzip- and zstd-compressed files are recognised by
+// their magic bytes and read through a DecompressingDevice, so the parser
+// only ever consumes the stream front to back and never needs to seek.
 class STLParser
 {
 public:
@@ -9,6 +12,7 @@ public:
     MeshBuffer parse(const QString &path, QString *errorMessage) const;
 
 private:
+    MeshBuffer parseDevice(QIODevice &device, QString *errorMessage) const;
     MeshBuffer parseAscii(QIODevice &device, QString *errorMessage) const;
     MeshBuffer parseBinary(QIODevice &device, QString *errorMessage) const;
 };
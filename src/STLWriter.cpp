@@ -0,0 +1,214 @@
+#include "STLWriter.h"
+#include "Parallel.h"
+
+#include <QObject>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kTrianglesPerBatch = 1 << 20;
+constexpr qsizetype kTrianglesPerTask = 1 << 14;
+constexpr int kBinaryFacetSize = 50;
+// Worst case for one ASCII facet: 12 floats of at most 15 characters plus
+// the fixed keywords.
+constexpr int kAsciiFacetCapacity = 12 * 16 + 128;
+
+struct Facet
+{
+    QVector3D normal;
+    QVector3D vertices[3];
+};
+
+// Shortest representation that reads back to the same float; the caller
+// reserves room for the longest one.
+inline char *writeFloat(char *out, float value)
+{
+    return std::to_chars(out, out + 16, value).ptr;
+}
+
+inline char *writeLiteral(char *out, const char *text, size_t length)
+{
+    std::memcpy(out, text, length);
+    return out + length;
+}
+
+inline char *writeTriple(char *out, const QVector3D &v)
+{
+    out = writeFloat(out, v.x());
+    *out++ = ' ';
+    out = writeFloat(out, v.y());
+    *out++ = ' ';
+    out = writeFloat(out, v.z());
+    *out++ = '\n';
+    return out;
+}
+
+inline char *writeLittleEndian(char *out, float value)
+{
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint32>(bits, out);
+    return out + 4;
+}
+
+inline char *writeLittleEndian(char *out, quint16 value)
+{
+    qToLittleEndian<quint16>(value, out);
+    return out + 2;
+}
+} // namespace
+
+bool STLWriter::write(const QString &path,
+                      const MeshBuffer &buffer,
+                      const QMatrix4x4 &transform,
+                      Format format,
+                      QString *errorMessage,
+                      const ProgressFunction &progress) const
+{
+    const qsizetype triangleCount = buffer.indices.size() / 3;
+    if (triangleCount == 0 || buffer.indices.size() % 3 != 0) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("No geometry to export.");
+        return false;
+    }
+    if (format == Format::Binary && triangleCount > std::numeric_limits<quint32>::max()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Too many triangles for binary STL.");
+        return false;
+    }
+    const unsigned int vertexCount = static_cast<unsigned int>(buffer.positions.size());
+    for (unsigned int index : buffer.indices) {
+        if (index >= vertexCount) {
+            if (errorMessage)
+                *errorMessage = QObject::tr("Mesh contains out-of-range indices.");
+            return false;
+        }
+    }
+
+    // Plain 3x4 affine rows so the loop below stays a straight multiply-add
+    // the compiler can vectorize, instead of QMatrix4x4::map's projective path.
+    float m[3][4];
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 4; ++column)
+            m[row][column] = transform(row, column);
+    }
+    QVector<QVector3D> positions(buffer.positions.size());
+    Parallel::forRanges(Parallel::split(positions.size(), 1 << 16), [&](const Parallel::Range &range) {
+        const QVector3D *in = buffer.positions.constData();
+        QVector3D *out = positions.data();
+        for (qsizetype i = range.begin; i < range.end; ++i) {
+            const float x = in[i].x();
+            const float y = in[i].y();
+            const float z = in[i].z();
+            out[i] = QVector3D(m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3],
+                               m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3],
+                               m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3]);
+        }
+    });
+    // A mirroring transform turns the winding inside out; swap two corners
+    // so the facets stay counter-clockwise seen from outside.
+    const float determinant = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                              m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    const bool flipWinding = determinant < 0.0f;
+
+    const auto facet = [&](qsizetype triangle) {
+        const unsigned int *corner = buffer.indices.constData() + triangle * 3;
+        Facet f;
+        f.vertices[0] = positions.at(corner[0]);
+        f.vertices[1] = positions.at(corner[flipWinding ? 2 : 1]);
+        f.vertices[2] = positions.at(corner[flipWinding ? 1 : 2]);
+        f.normal = QVector3D::crossProduct(f.vertices[1] - f.vertices[0], f.vertices[2] - f.vertices[0]).normalized();
+        return f;
+    };
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to write file %1").arg(path);
+        return false;
+    }
+
+    bool ok = true;
+    if (format == Format::Binary) {
+        // The header must not start with "solid" or readers take it for ASCII.
+        QByteArray header("Binary STL exported by STL Viewer");
+        header.append(QByteArray(80 - header.size(), '\0'));
+        char count[4];
+        qToLittleEndian<quint32>(static_cast<quint32>(triangleCount), count);
+        ok = file.write(header) == header.size() && file.write(count, 4) == 4;
+    } else {
+        ok = file.write("solid mesh\n") == 11;
+    }
+
+    const int progressTotal = static_cast<int>((triangleCount + 1023) / 1024);
+    // Facet colors go back into the attribute word they were read from.
+    const bool hasFaceColors = buffer.faceColors.size() == triangleCount;
+    QByteArray binary;
+    for (qsizetype first = 0; ok && first < triangleCount; first += kTrianglesPerBatch) {
+        const qsizetype batchCount = qMin(kTrianglesPerBatch, triangleCount - first);
+        const QVector<Parallel::Range> ranges = Parallel::split(batchCount, kTrianglesPerTask);
+
+        if (format == Format::Binary) {
+            // Fixed-size records: every task fills its own slice of one buffer.
+            binary.resize(batchCount * kBinaryFacetSize);
+            Parallel::forRanges(ranges, [&](const Parallel::Range &range) {
+                char *out = binary.data() + range.begin * kBinaryFacetSize;
+                for (qsizetype i = range.begin; i < range.end; ++i) {
+                    const Facet f = facet(first + i);
+                    for (int axis = 0; axis < 3; ++axis)
+                        out = writeLittleEndian(out, f.normal[axis]);
+                    for (const QVector3D &v : f.vertices) {
+                        for (int axis = 0; axis < 3; ++axis)
+                            out = writeLittleEndian(out, v[axis]);
+                    }
+                    out = writeLittleEndian(out, hasFaceColors ? buffer.faceColors.at(first + i) : quint16(0));
+                }
+            });
+            ok = file.write(binary) == binary.size();
+        } else {
+            // Variable-length text: each task formats into its own buffer
+            // and the buffers are appended in order.
+            QVector<QByteArray> formatted(ranges.size());
+            Parallel::forRanges(ranges, [&](const Parallel::Range &range) {
+                QByteArray &text = formatted[range.index];
+                text.resize((range.end - range.begin) * kAsciiFacetCapacity);
+                char *out = text.data();
+                for (qsizetype i = range.begin; i < range.end; ++i) {
+                    const Facet f = facet(first + i);
+                    out = writeLiteral(out, "facet normal ", 13);
+                    out = writeTriple(out, f.normal);
+                    out = writeLiteral(out, "  outer loop\n", 13);
+                    for (const QVector3D &v : f.vertices) {
+                        out = writeLiteral(out, "    vertex ", 11);
+                        out = writeTriple(out, v);
+                    }
+                    out = writeLiteral(out, "  endloop\nendfacet\n", 19);
+                }
+                text.resize(out - text.data());
+            });
+            for (const QByteArray &text : formatted)
+                ok = ok && file.write(text) == text.size();
+        }
+
+        if (progress && !progress(static_cast<int>((first + batchCount + 1023) / 1024), progressTotal)) {
+            file.cancelWriting();
+            if (errorMessage)
+                *errorMessage = QObject::tr("Export cancelled.");
+            return false;
+        }
+    }
+
+    if (format == Format::Ascii)
+        ok = ok && file.write("endsolid mesh\n") == 14;
+    if (!ok || !file.commit()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to write %1").arg(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QMatrix4x4>
+
+#include <functional>
+
+// Writes an indexed triangle mesh as binary or ASCII STL with a model
+// transform baked into the coordinates. Vertices are transformed once in
+// parallel; facets are then formatted in batches across cores and appended
+// in order, so memory stays bounded however large the part is.
+class STLWriter
+{
+public:
+    enum class Format
+    {
+        Binary,
+        Ascii
+    };
+
+    using ProgressFunction = std::function<bool(int finished, int total)>;
+
+    STLWriter() = default;
+
+    bool write(const QString &path,
+               const MeshBuffer &buffer,
+               const QMatrix4x4 &transform,
+               Format format,
+               QString *errorMessage,
+               const ProgressFunction &progress = ProgressFunction()) const;
+};
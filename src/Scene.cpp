@@ -0,0 +1,144 @@
+#include "Scene.h"
+
+QMatrix4x4 ModelTransform::matrix() const
+{
+    QMatrix4x4 model;
+    model.translate(translation);
+    model.rotate(rotation.x(), 1.0f, 0.0f, 0.0f);
+    model.rotate(rotation.y(), 0.0f, 1.0f, 0.0f);
+    model.rotate(rotation.z(), 0.0f, 0.0f, 1.0f);
+    model.scale(scale);
+    return model;
+}
+
+Scene::Scene() = default;
+
+Scene::~Scene() = default;
+
+void Scene::clear()
+{
+    m_instances.clear();
+    m_resources.clear();
+}
+
+int Scene::addResource(const QString &path)
+{
+    auto resource = std::make_unique<SceneResource>();
+    resource->path = path;
+    m_resources.push_back(std::move(resource));
+    return static_cast<int>(m_resources.size()) - 1;
+}
+
+int Scene::addInstance(int resource, const ModelTransform &transform)
+{
+    if (resource < 0 || resource >= resourceCount())
+        return -1;
+
+    SceneInstance instance;
+    instance.resource = resource;
+    instance.transform = transform;
+    m_instances.append(instance);
+    m_resources.at(resource)->instancesDirty = true;
+    return m_instances.size() - 1;
+}
+
+int Scene::instanceCount(int resource) const
+{
+    int count = 0;
+    for (const SceneInstance &instance : m_instances) {
+        if (instance.resource == resource)
+            ++count;
+    }
+    return count;
+}
+
+void Scene::setInstanceTransform(int index, const ModelTransform &transform)
+{
+    if (index < 0 || index >= m_instances.size())
+        return;
+    m_instances[index].transform = transform;
+    m_resources.at(m_instances.at(index).resource)->instancesDirty = true;
+}
+
+quint64 Scene::triangleCount() const
+{
+    quint64 count = 0;
+    for (const SceneInstance &instance : m_instances)
+        count += m_resources.at(instance.resource)->mesh.triangleCount();
+    return count;
+}
+
+bool Scene::bounds(QVector3D *minBounds, QVector3D *maxBounds) const
+{
+    bool first = true;
+    QVector3D min;
+    QVector3D max;
+    for (const SceneInstance &instance : m_instances) {
+        const Mesh &mesh = m_resources.at(instance.resource)->mesh;
+        if (!mesh.isValid())
+            continue;
+        const QMatrix4x4 matrix = instance.transform.matrix();
+        for (int corner = 0; corner < 8; ++corner) {
+            const QVector3D local((corner & 1) ? mesh.maxBounds().x() : mesh.minBounds().x(),
+                                  (corner & 2) ? mesh.maxBounds().y() : mesh.minBounds().y(),
+                                  (corner & 4) ? mesh.maxBounds().z() : mesh.minBounds().z());
+            const QVector3D world = matrix.map(local);
+            if (first) {
+                min = world;
+                max = world;
+                first = false;
+                continue;
+            }
+            for (int axis = 0; axis < 3; ++axis) {
+                min[axis] = qMin(min[axis], world[axis]);
+                max[axis] = qMax(max[axis], world[axis]);
+            }
+        }
+    }
+    if (first)
+        return false;
+    if (minBounds)
+        *minBounds = min;
+    if (maxBounds)
+        *maxBounds = max;
+    return true;
+}
+
+void Scene::uploadInstances(QOpenGLFunctions_4_1_Core *gl)
+{
+    QVector<QVector<QMatrix4x4>> transforms(resourceCount());
+    bool anyDirty = false;
+    for (const auto &resource : m_resources)
+        anyDirty = anyDirty || resource->instancesDirty;
+    if (!anyDirty)
+        return;
+
+    for (const SceneInstance &instance : m_instances)
+        transforms[instance.resource].append(instance.transform.matrix());
+
+    for (int i = 0; i < resourceCount(); ++i) {
+        SceneResource &resource = *m_resources.at(i);
+        if (!resource.instancesDirty)
+            continue;
+        resource.mesh.setInstanceTransforms(gl, transforms.at(i));
+        resource.instancesDirty = false;
+    }
+}
+
+void Scene::draw(QOpenGLFunctions_4_1_Core *gl, const QMatrix4x4 *viewProjection) const
+{
+    for (int i = 0; i < resourceCount(); ++i) {
+        const SceneResource &resource = *m_resources.at(i);
+        if (resource.mesh.isValid() && instanceCount(i) > 0)
+            resource.mesh.draw(gl, viewProjection);
+    }
+}
+
+void Scene::drawFeatureEdges(QOpenGLFunctions_4_1_Core *gl) const
+{
+    for (int i = 0; i < resourceCount(); ++i) {
+        const SceneResource &resource = *m_resources.at(i);
+        if (resource.mesh.isValid() && instanceCount(i) > 0)
+            resource.mesh.drawFeatureEdges(gl);
+    }
+}
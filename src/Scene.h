@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Bvh.h"
+#include "MassProperties.h"
+#include "Mesh.h"
+#include "MeshDeviation.h"
+#include "NormalHistogram.h"
+#include "WallThickness.h"
+
+#include <QMatrix4x4>
+#include <QString>
+#include <QVector>
+#include <QVector3D>
+
+#include <memory>
+#include <vector>
+
+struct ModelTransform
+{
+    QVector3D translation = QVector3D(0, 0, 0);
+    QVector3D rotation = QVector3D(0, 0, 0);
+    QVector3D scale = QVector3D(1, 1, 1);
+
+    QMatrix4x4 matrix() const;
+};
+
+struct SceneResource
+{
+    QString path;
+    Mesh mesh;
+    MassProperties mass;
+    NormalHistogram normals;
+    Bvh bvh; // built on first use
+    WallThicknessField thickness;
+    DeviationField deviation;
+    float acmrBefore = 0.0f; // vertex cache misses per triangle, see MeshOptimizer
+    float acmrAfter = 0.0f;
+    bool instancesDirty = true;
+};
+
+struct SceneInstance
+{
+    int resource = -1;
+    ModelTransform transform;
+};
+
+class Scene
+{
+public:
+    Scene();
+    ~Scene();
+
+    void clear();
+    bool isEmpty() const { return m_instances.isEmpty(); }
+
+    int addResource(const QString &path);
+    int resourceCount() const { return static_cast<int>(m_resources.size()); }
+    SceneResource &resource(int index) { return *m_resources.at(index); }
+    const SceneResource &resource(int index) const { return *m_resources.at(index); }
+
+    int addInstance(int resource, const ModelTransform &transform = ModelTransform());
+    int instanceCount() const { return m_instances.size(); }
+    int instanceCount(int resource) const;
+    const SceneInstance &instance(int index) const { return m_instances.at(index); }
+    void setInstanceTransform(int index, const ModelTransform &transform);
+
+    quint64 triangleCount() const;
+    bool bounds(QVector3D *minBounds, QVector3D *maxBounds) const;
+
+    void uploadInstances(QOpenGLFunctions_4_1_Core *gl);
+    // See Mesh::draw for `viewProjection`.
+    void draw(QOpenGLFunctions_4_1_Core *gl, const QMatrix4x4 *viewProjection = nullptr) const;
+    void drawFeatureEdges(QOpenGLFunctions_4_1_Core *gl) const;
+
+private:
+    std::vector<std::unique_ptr<SceneResource>> m_resources;
+    QVector<SceneInstance> m_instances;
+};
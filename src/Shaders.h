@@ -0,0 +1,268 @@
+#pragma once
+
+namespace Shaders
+{
+inline constexpr const char *phongVertex = R"(
+    #version 410 core
+    layout(location = 0) in vec3 aPosition;
+    layout(location = 1) in vec3 aNormal;
+    layout(location = 2) in mat4 aInstanceModel;
+    layout(location = 6) in mat3 aInstanceNormal;
+    layout(location = 9) in float aScalar;
+    layout(location = 10) in vec4 aColor;
+    layout(location = 11) in int aFaceColors;
+    uniform mat4 uModel;
+    uniform mat4 uView;
+    uniform mat4 uProjection;
+    uniform mat3 uNormalMatrix;
+    uniform vec4 uClipPlanes[3];
+    out VertexData {
+        vec3 normal;
+        vec3 worldPos;
+        float scalar;
+        vec4 color;
+        flat int faceColors;
+        noperspective vec3 edgeDistance;
+    } vOut;
+    out float gl_ClipDistance[3];
+    void main() {
+        vec4 worldPos = uModel * aInstanceModel * vec4(aPosition, 1.0);
+        vOut.worldPos = worldPos.xyz;
+        vOut.scalar = aScalar;
+        vOut.color = aColor;
+        vOut.faceColors = aFaceColors;
+        vOut.normal = uNormalMatrix * aInstanceNormal * aNormal;
+        // Only the wireframe geometry shader fills in real edge distances.
+        vOut.edgeDistance = vec3(1.0e6);
+        for (int i = 0; i < 3; ++i)
+            gl_ClipDistance[i] = dot(worldPos, uClipPlanes[i]);
+        gl_Position = uProjection * uView * worldPos;
+    }
+)";
+
+// Wireframe in the same pass as the shading: every corner gets its distance
+// in pixels to the opposite edge, which interpolates linearly in screen
+// space, so the fragment shader knows how far it is from the nearest edge.
+inline constexpr const char *phongWireframeGeometry = R"(
+    #version 410 core
+    layout(triangles) in;
+    layout(triangle_strip, max_vertices = 3) out;
+    in VertexData {
+        vec3 normal;
+        vec3 worldPos;
+        float scalar;
+        vec4 color;
+        flat int faceColors;
+        noperspective vec3 edgeDistance;
+    } gIn[];
+    out VertexData {
+        vec3 normal;
+        vec3 worldPos;
+        float scalar;
+        vec4 color;
+        flat int faceColors;
+        noperspective vec3 edgeDistance;
+    } gOut;
+    in gl_PerVertex {
+        vec4 gl_Position;
+        float gl_ClipDistance[3];
+    } gl_in[];
+    out gl_PerVertex {
+        vec4 gl_Position;
+        float gl_ClipDistance[3];
+    };
+    uniform vec2 uViewportSize;
+    void main() {
+        vec3 heights = vec3(1.0e6);
+        // Corners behind the eye have no screen position; such triangles
+        // are drawn without edges rather than with garbage ones.
+        if (gl_in[0].gl_Position.w > 0.0 && gl_in[1].gl_Position.w > 0.0 && gl_in[2].gl_Position.w > 0.0) {
+            vec2 p0 = gl_in[0].gl_Position.xy / gl_in[0].gl_Position.w * 0.5 * uViewportSize;
+            vec2 p1 = gl_in[1].gl_Position.xy / gl_in[1].gl_Position.w * 0.5 * uViewportSize;
+            vec2 p2 = gl_in[2].gl_Position.xy / gl_in[2].gl_Position.w * 0.5 * uViewportSize;
+            vec2 e0 = p2 - p1;
+            vec2 e1 = p2 - p0;
+            vec2 e2 = p1 - p0;
+            float twiceArea = abs(e1.x * e2.y - e1.y * e2.x);
+            heights = twiceArea / max(vec3(length(e0), length(e1), length(e2)), vec3(1.0e-6));
+        }
+        for (int i = 0; i < 3; ++i) {
+            gOut.normal = gIn[i].normal;
+            gOut.worldPos = gIn[i].worldPos;
+            gOut.scalar = gIn[i].scalar;
+            gOut.color = gIn[i].color;
+            gOut.faceColors = gIn[i].faceColors;
+            gOut.edgeDistance = vec3(i == 0 ? heights.x : 0.0, i == 1 ? heights.y : 0.0, i == 2 ? heights.z : 0.0);
+            for (int j = 0; j < 3; ++j)
+                gl_ClipDistance[j] = gl_in[i].gl_ClipDistance[j];
+            gl_Position = gl_in[i].gl_Position;
+            // Facet colors are looked up by primitive, which the fragment
+            // stage now takes from here.
+            gl_PrimitiveID = gl_PrimitiveIDIn;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+)";
+
+inline constexpr const char *phongFragment = R"(
+    #version 410 core
+    in VertexData {
+        vec3 normal;
+        vec3 worldPos;
+        float scalar;
+        vec4 color;
+        flat int faceColors;
+        noperspective vec3 edgeDistance;
+    } fIn;
+    uniform usamplerBuffer uFaceColors;
+    uniform vec3 uLightDirection;
+    uniform vec3 uCameraPos;
+    uniform vec3 uBaseColor;
+    uniform int uUseFaceNormals;
+    uniform float uGamma;
+    uniform int uAnalysisMode;
+    uniform vec3 uBuildDirection;
+    uniform float uAnalysisThreshold;
+    uniform vec3 uRampColors[4];
+    uniform int uScalarMode;
+    uniform float uScalarThreshold;
+    uniform float uScalarMax;
+    uniform int uWireframe; // 0 off, 1 over the shading, 2 edges only
+    uniform vec3 uWireColor;
+    uniform float uWireWidth; // pixels
+    out vec4 fragColor;
+
+    // Ramp entries: 0 acceptable, 1 near the threshold, 2 beyond it,
+    // 3 draft towards the opposite mold half.
+    vec3 analysisColor(vec3 faceNormal) {
+        float threshold = max(uAnalysisThreshold, 0.01);
+        float along = degrees(asin(clamp(dot(faceNormal, uBuildDirection), -1.0, 1.0)));
+        if (uAnalysisMode == 1) {
+            float overhang = -along;
+            if (overhang >= threshold)
+                return uRampColors[2];
+            return mix(uRampColors[0], uRampColors[1], clamp(overhang / threshold, 0.0, 1.0));
+        }
+        if (along >= threshold)
+            return uRampColors[0];
+        if (along <= -threshold)
+            return uRampColors[3];
+        return mix(uRampColors[2], uRampColors[1], abs(along) / threshold);
+    }
+
+    // Wall thickness: below the threshold is critical, above it the ramp runs
+    // from warning through acceptable to the last entry at uScalarMax.
+    vec3 thicknessColor(float value) {
+        if (value < uScalarThreshold)
+            return uRampColors[2];
+        float t = clamp((value - uScalarThreshold) / max(uScalarMax - uScalarThreshold, 1e-6), 0.0, 1.0);
+        return t < 0.5 ? mix(uRampColors[1], uRampColors[0], t * 2.0) : mix(uRampColors[0], uRampColors[3], t * 2.0 - 1.0);
+    }
+
+    // Signed deviation: within the tolerance is acceptable, beyond it the
+    // color runs towards critical (outside) or the last entry (inside),
+    // saturating at uScalarMax.
+    vec3 deviationColor(float value) {
+        float magnitude = abs(value);
+        if (magnitude <= uScalarThreshold)
+            return uRampColors[0];
+        float t = clamp((magnitude - uScalarThreshold) / max(uScalarMax - uScalarThreshold, 1e-6), 0.0, 1.0);
+        return mix(uRampColors[1], value > 0.0 ? uRampColors[2] : uRampColors[3], t);
+    }
+
+    void main() {
+        // Edge coverage with a one pixel smooth falloff for anti-aliasing.
+        float edgeDistance = min(fIn.edgeDistance.x, min(fIn.edgeDistance.y, fIn.edgeDistance.z));
+        float wire = uWireframe != 0 ? 1.0 - smoothstep(uWireWidth * 0.5 - 0.5, uWireWidth * 0.5 + 0.5, edgeDistance) : 0.0;
+        if (uWireframe == 2) {
+            if (wire <= 0.0)
+                discard;
+            fragColor = vec4(uWireColor, wire);
+            return;
+        }
+
+        vec3 normal = normalize(fIn.normal);
+        vec3 faceNormal = normalize(cross(dFdx(fIn.worldPos), dFdy(fIn.worldPos)));
+        if (uUseFaceNormals == 1)
+            normal = faceNormal;
+        // Vertex colors are sRGB; lighting happens before the gamma curve.
+        vec3 baseColor = fIn.color.a > 0.0 ? pow(fIn.color.rgb, vec3(max(uGamma, 0.0001))) : uBaseColor;
+        // Facet colors: one RGB555 texel per triangle, bit 15 marks a color.
+        // faceColors is one past the draw call's first triangle.
+        if (fIn.faceColors != 0) {
+            uint word = texelFetch(uFaceColors, gl_PrimitiveID + fIn.faceColors - 1).r;
+            if ((word & 0x8000u) != 0u) {
+                vec3 rgb = vec3((word >> 10) & 31u, (word >> 5) & 31u, word & 31u) / 31.0;
+                baseColor = pow(rgb, vec3(max(uGamma, 0.0001)));
+            }
+        }
+        if (uAnalysisMode != 0)
+            baseColor = analysisColor(gl_FrontFacing ? faceNormal : -faceNormal);
+        if (uScalarMode == 1 && fIn.scalar >= 0.0)
+            baseColor = thicknessColor(fIn.scalar);
+        else if (uScalarMode == 2 && fIn.scalar > -1.0e29)
+            baseColor = deviationColor(fIn.scalar);
+        vec3 lightDir = normalize(-uLightDirection);
+        float diff = max(dot(normal, lightDir), 0.0);
+        vec3 viewDir = normalize(uCameraPos - fIn.worldPos);
+        vec3 reflectDir = reflect(-lightDir, normal);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+        vec3 color = baseColor * (0.15 + diff) + vec3(0.4) * spec;
+        color = pow(max(color, vec3(0.0)), vec3(1.0 / max(uGamma, 0.0001)));
+        fragColor = vec4(mix(color, uWireColor, wire), 1.0);
+    }
+)";
+
+inline constexpr const char *colorVertex = R"(
+    #version 410 core
+    layout(location = 0) in vec3 aPosition;
+    uniform mat4 uMvp;
+    void main() {
+        gl_Position = uMvp * vec4(aPosition, 1.0);
+    }
+)";
+
+inline constexpr const char *wireVertex = R"(
+    #version 410 core
+    layout(location = 0) in vec3 aPosition;
+    layout(location = 2) in mat4 aInstanceModel;
+    uniform mat4 uViewProjection;
+    uniform vec4 uClipPlanes[3];
+    out float gl_ClipDistance[3];
+    void main() {
+        vec4 worldPos = aInstanceModel * vec4(aPosition, 1.0);
+        for (int i = 0; i < 3; ++i)
+            gl_ClipDistance[i] = dot(worldPos, uClipPlanes[i]);
+        gl_Position = uViewProjection * worldPos;
+    }
+)";
+
+// Section cap: a quad spanning the clip plane, generated from gl_VertexID
+// so no vertex buffer is needed.
+inline constexpr const char *capVertex = R"(
+    #version 410 core
+    uniform mat4 uViewProjection;
+    uniform vec3 uCapOrigin;
+    uniform vec3 uCapU;
+    uniform vec3 uCapV;
+    uniform vec4 uClipPlanes[3];
+    out float gl_ClipDistance[3];
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+        vec4 worldPos = vec4(uCapOrigin + corner.x * uCapU + corner.y * uCapV, 1.0);
+        for (int i = 0; i < 3; ++i)
+            gl_ClipDistance[i] = dot(worldPos, uClipPlanes[i]);
+        gl_Position = uViewProjection * worldPos;
+    }
+)";
+
+inline constexpr const char *colorFragment = R"(
+    #version 410 core
+    uniform vec3 uColor;
+    out vec4 fragColor;
+    void main() {
+        fragColor = vec4(uColor, 1.0);
+    }
+)";
+} // namespace Shaders
@@ -0,0 +1,251 @@
+#include "ThumbnailRenderer.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "Shaders.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFuture>
+#include <QObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
+#include <QSet>
+#include <QSurfaceFormat>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace
+{
+constexpr float kGamma = 2.2f;
+
+struct ParsedMesh
+{
+    MeshBuffer buffer;
+    QString error;
+};
+
+struct PendingImage
+{
+    QString path;
+    QFuture<bool> saved;
+};
+} // namespace
+
+ThumbnailRenderer::ThumbnailRenderer() = default;
+
+ThumbnailRenderer::~ThumbnailRenderer()
+{
+    if (m_context && m_surface && m_context->makeCurrent(m_surface.get())) {
+        m_program.reset();
+        m_fbo.reset();
+        m_context->doneCurrent();
+    }
+}
+
+bool ThumbnailRenderer::initialize(QString *errorMessage)
+{
+    if (m_context)
+        return true;
+
+    QSurfaceFormat format;
+    format.setRenderableType(QSurfaceFormat::OpenGL);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setVersion(4, 1);
+    format.setDepthBufferSize(24);
+    format.setStencilBufferSize(8);
+
+    m_surface = std::make_unique<QOffscreenSurface>();
+    m_surface->setFormat(format);
+    m_surface->create();
+
+    m_context = std::make_unique<QOpenGLContext>();
+    m_context->setFormat(format);
+    if (!m_surface->isValid() || !m_context->create() || !m_context->makeCurrent(m_surface.get())) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Unable to create an offscreen OpenGL 4.1 context.");
+        m_context.reset();
+        return false;
+    }
+
+    if (!initializeOpenGLFunctions()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("OpenGL 4.1 core functions are unavailable.");
+        m_context->doneCurrent();
+        m_context.reset();
+        return false;
+    }
+
+    m_program = std::make_unique<QOpenGLShaderProgram>();
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, Shaders::phongVertex) ||
+        !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, Shaders::phongFragment) ||
+        !m_program->link()) {
+        if (errorMessage)
+            *errorMessage = QObject::tr("Failed to compile Phong shader: %1").arg(m_program->log());
+        m_program.reset();
+        m_context->doneCurrent();
+        m_context.reset();
+        return false;
+    }
+
+    m_context->doneCurrent();
+    return true;
+}
+
+bool ThumbnailRenderer::ensureFramebuffer(const QSize &size)
+{
+    if (m_fbo && m_fbo->size() == size)
+        return true;
+
+    QOpenGLFramebufferObjectFormat format;
+    format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    format.setSamples(4);
+    m_fbo = std::make_unique<QOpenGLFramebufferObject>(size, format);
+    return m_fbo->isValid();
+}
+
+QImage ThumbnailRenderer::render(const MeshBuffer &buffer, const QSize &size)
+{
+    if (!m_context || !m_program || buffer.positions.isEmpty() || buffer.indices.isEmpty() || size.isEmpty())
+        return QImage();
+    if (!m_context->makeCurrent(m_surface.get()))
+        return QImage();
+    if (!ensureFramebuffer(size)) {
+        m_context->doneCurrent();
+        return QImage();
+    }
+
+    Mesh mesh;
+    mesh.setData(buffer.positions, buffer.normals, buffer.indices, buffer.hasNormals);
+    mesh.setColors(buffer.colors);
+    mesh.setFaceColors(buffer.faceColors);
+    mesh.upload(this);
+
+    const QVector3D center = (mesh.minBounds() + mesh.maxBounds()) * 0.5f;
+    const float radius = qMax(mesh.size().length() * 0.5f, 0.001f);
+    Camera camera;
+    camera.setPerspective(45.0f, static_cast<float>(size.width()) / size.height(), radius * 0.05f, radius * 10.0f);
+    camera.focus(center, radius);
+
+    m_fbo->bind();
+    glViewport(0, 0, size.width(), size.height());
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glClearColor(0.1f, 0.12f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_program->bind();
+    m_program->setUniformValue("uModel", QMatrix4x4());
+    m_program->setUniformValue("uView", camera.viewMatrix());
+    m_program->setUniformValue("uProjection", camera.projectionMatrix());
+    m_program->setUniformValue("uNormalMatrix", QMatrix4x4().normalMatrix());
+    m_program->setUniformValue("uLightDirection", QVector3D(-0.4f, -1.0f, -0.6f).normalized());
+    m_program->setUniformValue("uCameraPos", camera.position());
+    m_program->setUniformValue("uBaseColor", QVector3D(0.7f, 0.72f, 0.75f));
+    m_program->setUniformValue("uFaceColors", Mesh::kFaceColorTextureUnit);
+    m_program->setUniformValue("uUseFaceNormals", 0);
+    m_program->setUniformValue("uGamma", kGamma);
+    mesh.draw(this);
+    m_program->release();
+    m_fbo->release();
+
+    const QImage image = m_fbo->toImage();
+    mesh.clear();
+    m_context->doneCurrent();
+    return image;
+}
+
+int ThumbnailRenderer::renderFiles(const QStringList &files,
+                                   const Options &options,
+                                   QStringList *errors,
+                                   const ProgressFunction &progress,
+                                   const InspectFunction &inspect)
+{
+    if (!m_context) {
+        QString message;
+        if (!initialize(&message)) {
+            if (errors)
+                errors->append(message);
+            return 0;
+        }
+    }
+    QDir().mkpath(options.outputDirectory);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.workerThreads > 0 ? options.workerThreads : qMax(1, QThread::idealThreadCount()));
+    const int lookahead = pool.maxThreadCount() * 2;
+
+    QList<QFuture<ParsedMesh>> parsing;
+    QList<PendingImage> encoding;
+    QSet<QString> usedNames;
+    int nextToParse = 0;
+    int rendered = 0;
+
+    auto scheduleParsing = [&]() {
+        while (nextToParse < files.size() && parsing.size() < lookahead) {
+            const QString path = files.at(nextToParse++);
+            parsing.append(QtConcurrent::run(&pool, [path, inspect]() {
+                ParsedMesh parsed;
+                QElapsedTimer timer;
+                timer.start();
+                MeshLoader loader;
+                parsed.buffer = loader.load(path, &parsed.error);
+                if (inspect)
+                    inspect(path, parsed.buffer, timer.nsecsElapsed() / 1.0e6, parsed.error);
+                return parsed;
+            }));
+        }
+    };
+
+    auto collectEncoded = [&](int keep) {
+        while (encoding.size() > keep) {
+            PendingImage pending = encoding.takeFirst();
+            if (!pending.saved.result() && errors)
+                errors->append(QObject::tr("%1: failed to write thumbnail").arg(pending.path));
+        }
+    };
+
+    for (int i = 0; i < files.size(); ++i) {
+        scheduleParsing();
+        QFuture<ParsedMesh> future = parsing.takeFirst();
+        ParsedMesh parsed = future.result();
+        scheduleParsing();
+
+        const QString &path = files.at(i);
+        if (parsed.buffer.positions.isEmpty() || parsed.buffer.indices.isEmpty()) {
+            if (errors)
+                errors->append(QObject::tr("%1: %2").arg(path, parsed.error.isEmpty() ? QObject::tr("no geometry") : parsed.error));
+        } else {
+            const QImage image = render(parsed.buffer, options.size);
+            parsed.buffer = MeshBuffer();
+            if (image.isNull()) {
+                if (errors)
+                    errors->append(QObject::tr("%1: rendering failed").arg(path));
+            } else {
+                QString name = QFileInfo(path).completeBaseName();
+                for (int suffix = 2; usedNames.contains(name); ++suffix)
+                    name = QStringLiteral("%1-%2").arg(QFileInfo(path).completeBaseName()).arg(suffix);
+                usedNames.insert(name);
+                const QString outputPath = QDir(options.outputDirectory).filePath(name + QStringLiteral(".png"));
+
+                PendingImage pending;
+                pending.path = outputPath;
+                pending.saved = QtConcurrent::run(&pool, [image, outputPath]() { return image.save(outputPath, "PNG"); });
+                encoding.append(pending);
+                ++rendered;
+            }
+        }
+
+        collectEncoded(lookahead);
+        if (progress && !progress(i + 1, files.size()))
+            break;
+    }
+
+    for (QFuture<ParsedMesh> &future : parsing)
+        future.waitForFinished();
+    collectEncoded(0);
+    return rendered;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <QImage>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QSize>
+#include <QStringList>
+
+#include <functional>
+#include <memory>
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+class QOpenGLShaderProgram;
+
+class ThumbnailRenderer : protected QOpenGLFunctions_4_1_Core
+{
+public:
+    struct Options
+    {
+        QSize size = QSize(256, 256);
+        QString outputDirectory;
+        int workerThreads = 0;
+    };
+
+    using ProgressFunction = std::function<bool(int done, int total)>;
+    using InspectFunction = std::function<void(const QString &path, const MeshBuffer &buffer, double loadMs, const QString &error)>;
+
+    ThumbnailRenderer();
+    ~ThumbnailRenderer();
+
+    bool initialize(QString *errorMessage);
+    QImage render(const MeshBuffer &buffer, const QSize &size);
+    int renderFiles(const QStringList &files,
+                    const Options &options,
+                    QStringList *errors,
+                    const ProgressFunction &progress = ProgressFunction(),
+                    const InspectFunction &inspect = InspectFunction());
+
+private:
+    bool ensureFramebuffer(const QSize &size);
+
+    std::unique_ptr<QOffscreenSurface> m_surface;
+    std::unique_ptr<QOpenGLContext> m_context;
+    std::unique_ptr<QOpenGLFramebufferObject> m_fbo;
+    std::unique_ptr<QOpenGLShaderProgram> m_program;
+};
@@ -0,0 +1,65 @@
+#include "WallThickness.h"
+#include "Parallel.h"
+
+#include <limits>
+
+namespace
+{
+constexpr qsizetype kBatchSize = 1 << 16;
+}
+
+bool WallThickness::compute(const Bvh &bvh,
+                            const QVector<QVector3D> &positions,
+                            const QVector<QVector3D> &normals,
+                            WallThicknessField *field,
+                            const ProgressFunction &progress)
+{
+    if (!field || bvh.isEmpty() || positions.isEmpty() || normals.size() != positions.size())
+        return false;
+
+    // Only back faces count (the inside of the opposite wall), and hits this
+    // close to the origin are the faces around the vertex itself.
+    const float epsilon = qMax((bvh.maxBounds() - bvh.minBounds()).length() * 1.0e-5f, 1.0e-6f);
+    const float maxDistance = std::numeric_limits<float>::max();
+
+    const qsizetype count = positions.size();
+    QVector<float> values(count);
+    float *data = values.data();
+
+    // Rays are cast in batches so the caller gets regular progress callbacks
+    // and can cancel between them.
+    for (qsizetype first = 0; first < count; first += kBatchSize) {
+        const qsizetype batchEnd = qMin(count, first + kBatchSize);
+        Parallel::forEach(
+            batchEnd - first,
+            [&](qsizetype offset) {
+                const qsizetype i = first + offset;
+                const QVector3D direction = -normals.at(i).normalized();
+                Bvh::Hit hit;
+                if (!direction.isNull() && bvh.intersect(positions.at(i), direction, epsilon, maxDistance, &hit, true))
+                    data[i] = hit.distance;
+                else
+                    data[i] = -1.0f;
+            },
+            1024);
+        if (progress && !progress(static_cast<int>((batchEnd + 1023) / 1024), static_cast<int>((count + 1023) / 1024)))
+            return false;
+    }
+
+    WallThicknessField result;
+    result.minimum = std::numeric_limits<float>::max();
+    result.maximum = 0.0f;
+    for (float value : values) {
+        if (value < 0.0f) {
+            ++result.missCount;
+            continue;
+        }
+        result.minimum = qMin(result.minimum, value);
+        result.maximum = qMax(result.maximum, value);
+    }
+    if (result.missCount == count)
+        result.minimum = 0.0f;
+    result.values = std::move(values);
+    *field = std::move(result);
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Bvh.h"
+
+#include <QVector>
+#include <QVector3D>
+
+#include <functional>
+
+struct WallThicknessField
+{
+    QVector<float> values; // per vertex; negative where the ray left the mesh
+    float minimum = 0.0f;
+    float maximum = 0.0f;
+    qsizetype missCount = 0;
+
+    bool isEmpty() const { return values.isEmpty(); }
+};
+
+// Local wall thickness: the distance from each vertex to the first surface
+// hit by a ray cast inwards along the negated vertex normal.
+class WallThickness
+{
+public:
+    using ProgressFunction = std::function<bool(int finished, int total)>;
+
+    // Returns false when `progress` cancels; `field` is left untouched then.
+    static bool compute(const Bvh &bvh,
+                        const QVector<QVector3D> &positions,
+                        const QVector<QVector3D> &normals,
+                        WallThicknessField *field,
+                        const ProgressFunction &progress = ProgressFunction());
+};
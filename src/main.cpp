@@ -1,10 +1,60 @@
+#include "BatchProcessor.h"
 #include "MainWindow.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QGuiApplication>
 #include <QSurfaceFormat>
 
+namespace
+{
+// Matches "--name" as well as QCommandLineParser's "--name=value" form.
+bool hasArgument(int argc, char *argv[], const char *name)
+{
+    const size_t length = qstrlen(name);
+    for (int i = 1; i < argc; ++i) {
+        if (qstrncmp(argv[i], name, length) == 0 && (argv[i][length] == '\0' || argv[i][length] == '='))
+            return true;
+    }
+    return false;
+}
+
+// Headless Linux boxes have no platform to open a GL surface on; anywhere
+// else the default platform is the one that has OpenGL.
+bool needsOffscreenPlatform()
+{
+#ifdef Q_OS_LINUX
+    return qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") && qEnvironmentVariableIsEmpty("DISPLAY") &&
+           qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY");
+#else
+    return false;
+#endif
+}
+
+int runBatch(QCoreApplication &app)
+{
+    QCoreApplication::setOrganizationName("OpenAI");
+    QCoreApplication::setOrganizationDomain("openai.com");
+    QCoreApplication::setApplicationName("STL Viewer");
+
+    BatchProcessor processor;
+    return processor.exec(app.arguments());
+}
+} // namespace
+
 int main(int argc, char *argv[])
 {
+    if (hasArgument(argc, argv, "--batch")) {
+        if (hasArgument(argc, argv, "--thumbnails")) {
+            if (needsOffscreenPlatform())
+                qputenv("QT_QPA_PLATFORM", "offscreen");
+            QGuiApplication app(argc, argv);
+            return runBatch(app);
+        }
+        QCoreApplication app(argc, argv);
+        return runBatch(app);
+    }
+
     QApplication app(argc, argv);
     QApplication::setOrganizationName("OpenAI");
     QApplication::setOrganizationDomain("openai.com");